@@ -0,0 +1,162 @@
+// Minimal Arduino API for building the library on a host (Linux, macOS) with g++ or clang++.
+// Only what the library uses is provided. millis() is the real steady clock, so std::threads can be tested.
+// See host_test.cpp for the build commands.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#ifndef ARDUINO
+#define ARDUINO 189
+#endif
+typedef bool boolean;
+typedef uint8_t byte;
+using std::max;
+using std::min;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define DEC 10
+#define HEX 16
+#define PROGMEM
+
+inline unsigned long millis()
+{
+  static const auto start = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+inline unsigned long micros() { return millis() * 1000; }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+inline void detachInterrupt(uint8_t) {}
+#define digitalPinToInterrupt(p) (p)
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+class String
+{
+public:
+  std::string s;
+  String() {}
+  String(const char *c) : s(c ? c : "") {}
+  String(const __FlashStringHelper *c) : s((const char *)c) {}
+  String(char c) : s(1, c) {}
+  explicit String(int v, unsigned char base = 10) { format(base == 16 ? "%x" : "%d", v); }
+  explicit String(unsigned int v, unsigned char base = 10) { format(base == 16 ? "%x" : "%u", v); }
+  explicit String(long v, unsigned char base = 10) { format(base == 16 ? "%lx" : "%ld", v); }
+  explicit String(unsigned long v, unsigned char base = 10) { format(base == 16 ? "%lx" : "%lu", v); }
+  explicit String(float v, unsigned char d = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", d, v); s = b; }
+  explicit String(double v, unsigned char d = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", d, v); s = b; }
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *o) { s += o; return *this; }
+  String &operator+=(char o) { s += o; return *this; }
+  bool concat(const String &o) { s += o.s; return true; }
+  bool concat(const char *o) { s += o; return true; }
+  bool concat(char o) { s += o; return true; }
+  char operator[](unsigned int i) const { return s[i]; }
+  char charAt(unsigned int i) const { return s[i]; }
+  int indexOf(char c, unsigned int from = 0) const { size_t p = s.find(c, from); return (p == std::string::npos) ? -1 : (int)p; }
+  int indexOf(const String &c, unsigned int from = 0) const { size_t p = s.find(c.s, from); return (p == std::string::npos) ? -1 : (int)p; }
+  String substring(unsigned int a) const { return String(s.substr(a).c_str()); }
+  String substring(unsigned int a, unsigned int b) const { return String(s.substr(a, b - a).c_str()); }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void toCharArray(char *b, unsigned int n) const { if (n == 0) return; strncpy(b, s.c_str(), n); b[n - 1] = '\0'; }
+  void getBytes(unsigned char *b, unsigned int n) const { toCharArray((char *)b, n); }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == o; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool startsWith(const String &o) const { return s.rfind(o.s, 0) == 0; }
+  bool endsWith(const String &o) const { return (s.size() >= o.s.size()) && (s.compare(s.size() - o.s.size(), o.s.size(), o.s) == 0); }
+  void remove(unsigned int i) { s.erase(i); }
+  void remove(unsigned int i, unsigned int n) { s.erase(i, n); }
+
+private:
+  template <typename T> void format(const char *fmt, T v) { char b[34]; snprintf(b, sizeof(b), fmt, v); s = b; }
+};
+inline String operator+(const String &a, const String &b) { String r(a); r += b; return r; }
+inline String operator+(const String &a, const char *b) { String r(a); r += b; return r; }
+inline String operator+(const char *a, const String &b) { String r(a); r += b; return r; }
+inline String operator+(const String &a, char b) { String r(a); r += b; return r; }
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *b, size_t n) { size_t i = 0; for (; i < n; i++) write(b[i]); return i; }
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+  size_t write(const char *str, size_t n) { return write((const uint8_t *)str, n); }
+  size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(const char str[]) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return number(v, base); }
+  size_t print(int v, int base = DEC) { return number(v, base); }
+  size_t print(unsigned int v, int base = DEC) { return number(v, base); }
+  size_t print(long v, int base = DEC) { return number(v, base); }
+  size_t print(unsigned long v, int base = DEC) { return number(v, base); }
+  size_t print(long long v, int base = DEC) { return number(v, base); }
+  size_t print(unsigned long long v, int base = DEC) { return number((long long)v, base); }
+  size_t print(double v, int digits = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", digits, v); return write(b); }
+  size_t println(void) { return write("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int format) { size_t n = print(v, format); return n + println(); }
+  virtual void flush() {}
+
+private:
+  size_t number(long long v, int base) { char b[40]; snprintf(b, sizeof(b), (base == HEX) ? "%llx" : "%lld", v); return write(b); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(char *b, size_t n) { size_t i = 0; while (i < n) { int c = read(); if (c < 0) break; b[i++] = (char)c; } return i; }
+  size_t readBytes(uint8_t *b, size_t n) { return readBytes((char *)b, n); }
+  void setTimeout(unsigned long) {}
+  bool find(const char *) { return false; }
+  bool find(char) { return false; }
+};
+
+// Serial is a sink for the debug output. Tests derive a simulated module from HardwareSerial
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+  operator bool() { return true; }
+};
+inline HardwareSerial Serial;
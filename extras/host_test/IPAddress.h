@@ -0,0 +1,29 @@
+// Minimal IPAddress for host builds. See host_test.cpp
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class IPAddress
+{
+public:
+  IPAddress() : _a{0, 0, 0, 0} {}
+  IPAddress(uint8_t w, uint8_t x, uint8_t y, uint8_t z) : _a{w, x, y, z} {}
+  IPAddress(uint32_t v) { memcpy(_a, &v, 4); }
+  uint8_t operator[](int i) const { return _a[i]; }
+  uint8_t &operator[](int i) { return _a[i]; }
+  operator uint32_t() const { uint32_t v; memcpy(&v, _a, 4); return v; }
+  bool operator==(const IPAddress &o) const { return memcmp(_a, o._a, 4) == 0; }
+  bool fromString(const char *s)
+  {
+    unsigned int a, b, c, d;
+    if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4)
+      return false;
+    _a[0] = a; _a[1] = b; _a[2] = c; _a[3] = d;
+    return true;
+  }
+
+private:
+  uint8_t _a[4];
+};
@@ -0,0 +1,280 @@
+// Host test for the library. It does not need a module or an Arduino board: the module is simulated.
+// Arduino.h and IPAddress.h in this folder provide the parts of the Arduino API that the library uses.
+//
+// Build and run from the library folder:
+//   g++ -std=gnu++17 -fpermissive -DARDUINO=189 -DSARA_R5_THREAD_SAFE -fsanitize=thread -g -Iextras/host_test -Isrc \
+//       extras/host_test/host_test.cpp src/SparkFun_u-blox_SARA-R5_Arduino_Library.cpp -lpthread -o host_test
+//   ./host_test
+//
+// -fpermissive is needed because the URC parsers store strstr(const char *, ...) in a char *. The Arduino toolchains
+// accept that, but the C++ overloads in glibc return const char *.
+//
+// Without -DSARA_R5_THREAD_SAFE only the single-threaded tests are run.
+// The program prints the result of each test and returns non-zero if any test fails.
+
+#include "SparkFun_u-blox_SARA-R5_Arduino_Library.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char *name)
+{
+  printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+  if (!ok)
+    failures++;
+}
+
+// A simulated module. Each command line gets its response: +TEST<x> is echoed back as +TEST: <x>,
+// +USORD returns five bytes, everything else is answered with OK.
+// One response in four is preceded by a +UUSORD URC, like a module receiving socket data.
+class SimulatedModule : public HardwareSerial
+{
+public:
+  std::atomic<int> urcsSent{0};
+
+  int available() override
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return (int)_rx.size();
+  }
+  int read() override
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_rx.empty())
+      return -1;
+    char c = _rx.front();
+    _rx.pop_front();
+    return (unsigned char)c;
+  }
+  int peek() override
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _rx.empty() ? -1 : (unsigned char)_rx.front();
+  }
+  size_t write(uint8_t c) override
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _line += (char)c;
+    if (c == '\n')
+    {
+      respond(_line);
+      _line.clear();
+    }
+    return 1;
+  }
+  using Print::write;
+
+private:
+  std::mutex _mutex;
+  std::deque<char> _rx;
+  std::string _line;
+  unsigned int _seed = 1;
+
+  void respond(const std::string &line)
+  {
+    std::string response = "\r\n";
+    size_t test = line.find("+TEST");
+    if (test != std::string::npos)
+      response += "+TEST: " + line.substr(test + 5, line.find('\r') - test - 5) + "\r\n\r\nOK\r\n";
+    else if (line.find("+USORD=") != std::string::npos)
+      response += "+USORD: 0,5,\"hello\"\r\n\r\nOK\r\n";
+    else
+      response += "OK\r\n";
+
+    _seed = (_seed * 1103515245) + 12345;
+    if (((_seed >> 16) & 3) == 0)
+    {
+      response = "\r\n+UUSORD: 0,5\r\n" + response;
+      urcsSent++;
+    }
+    _rx.insert(_rx.end(), response.begin(), response.end());
+  }
+};
+
+// begin() sends the full initialization sequence. The tests only need the buffers and the serial port
+class TestSARA : public SARA_R5
+{
+public:
+  void fakeBegin(HardwareSerial &port)
+  {
+    _saraRXBuffer = new char[_RXBuffSize]();
+    _pruneBuffer = new char[_RXBuffSize]();
+    _saraResponseBacklog = new char[_RXBuffSize]();
+    _hardSerial = &port;
+    for (int i = 0; i < SARA_R5_NUM_SOCKETS; i++)
+      _lastSocketProtocol[i] = SARA_R5_TCP;
+  }
+};
+
+// Push, pop and overflow accounting, including the wrap-around of the free-running indexes
+static void testEventQueue(void)
+{
+  SARA_R5_Event_Queue queue;
+  SARA_R5_event event;
+  bool ok = true;
+
+  memset(&event, 0, sizeof(event));
+  event.type = SARA_R5_EVENT_SOCKET_DATA;
+  for (int i = 0; i < SARA_R5_EVENT_QUEUE_SIZE; i++)
+  {
+    event.socketData.socket = i;
+    ok &= queue.push(event);
+  }
+  check(ok && (queue.count() == SARA_R5_EVENT_QUEUE_SIZE), "event queue holds SARA_R5_EVENT_QUEUE_SIZE events");
+
+  event.socketData.socket = -1;
+  check(!queue.push(event) && (queue.dropped() == 1) && (queue.count() == SARA_R5_EVENT_QUEUE_SIZE),
+        "event queue drops (and counts) an event when full");
+  check(queue.highWater() == SARA_R5_EVENT_QUEUE_SIZE, "event queue high-water mark");
+
+  ok = true;
+  for (int i = 0; i < SARA_R5_EVENT_QUEUE_SIZE; i++)
+    ok &= queue.pop(event) && (event.socketData.socket == i);
+  check(ok && !queue.pop(event) && (queue.count() == 0), "event queue pops in order and is then empty");
+
+  // Run the indexes round several times with a varying fill level
+  ok = true;
+  int pushed = 0;
+  int popped = 0;
+  for (int i = 0; i < 2000; i++)
+  {
+    event.socketData.socket = pushed;
+    if (queue.push(event))
+      pushed++;
+    if ((i % 3) != 0)
+    {
+      if (queue.pop(event))
+      {
+        ok &= (event.socketData.socket == popped);
+        popped++;
+      }
+    }
+  }
+  while (queue.pop(event))
+  {
+    ok &= (event.socketData.socket == popped);
+    popped++;
+  }
+  check(ok && (pushed == popped) && (queue.count() == 0), "event queue keeps its order across index wrap-around");
+
+  queue.reset();
+  check((queue.count() == 0) && (queue.dropped() == 0) && (queue.highWater() == 0), "event queue reset");
+}
+
+#ifdef SARA_R5_THREAD_SAFE
+static std::atomic<int> socketReads{0};
+static void socketReadCallback(int socket, String data)
+{
+  (void)socket;
+  if (data == "hello")
+    socketReads++;
+}
+
+// Four threads send commands while the RX task polls. Each thread must get its own response,
+// and every URC must be processed exactly once
+static void testThreadedCommands(void)
+{
+  SimulatedModule module;
+  TestSARA sara;
+  sara.fakeBegin(module);
+  sara.setSocketReadCallback(socketReadCallback);
+
+  check(sara.startRxTask(1), "startRxTask");
+
+  const int numThreads = 4;
+  const int numCommands = 200;
+  std::atomic<int> good{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++)
+  {
+    threads.emplace_back([&, t]
+    {
+      for (int i = 0; i < numCommands; i++)
+      {
+        char command[32];
+        char expected[40];
+        char response[128] = {0};
+        snprintf(command, sizeof(command), "+TEST%d_%d", t, i);
+        snprintf(expected, sizeof(expected), "+TEST: %d_%d", t, i);
+        if ((sara.sendCustomCommandWithResponse(command, "OK", response, 1000) == SARA_R5_ERROR_SUCCESS)
+            && (strstr(response, expected) != nullptr))
+          good++;
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  // Let the RX task process the last URCs
+  unsigned long start = millis();
+  while ((socketReads < module.urcsSent) && ((millis() - start) < 1000))
+    delay(5);
+  sara.stopRxTask();
+
+  printf("  %d of %d responses correct, %d of %d socket reads\n", (int)good, numThreads * numCommands, (int)socketReads, (int)module.urcsSent);
+  check(good == numThreads * numCommands, "threaded commands each get their own response");
+  check(socketReads == module.urcsSent, "threaded URCs are each processed once");
+  check(!sara.rxTaskRunning(), "stopRxTask");
+}
+
+// The RX task produces socket data events while another thread consumes them without the library lock
+static void testThreadedEventQueue(void)
+{
+  SimulatedModule module;
+  TestSARA sara;
+  sara.fakeBegin(module);
+  sara.enableEventQueue(true);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> events{0};
+  std::thread consumer([&]
+  {
+    SARA_R5_event event;
+    while (!done)
+    {
+      if (sara.readEvent(event))
+      {
+        if ((event.type == SARA_R5_EVENT_SOCKET_DATA) && (event.socketData.socket == 0) && (event.socketData.length == 5))
+          events++;
+      }
+      else
+        yield();
+    }
+    while (sara.readEvent(event))
+      events++;
+  });
+
+  sara.startRxTask(1);
+  for (int i = 0; i < 400; i++)
+    sara.sendCustomCommandWithResponse("+TEST", "OK", nullptr, 1000);
+
+  unsigned long start = millis();
+  while (((events + (int)sara.getEventsDropped()) < module.urcsSent) && ((millis() - start) < 1000))
+    delay(5);
+  sara.stopRxTask();
+  done = true;
+  consumer.join();
+
+  printf("  %d of %d events received, %u dropped, high-water %u\n", (int)events, (int)module.urcsSent,
+         (unsigned int)sara.getEventsDropped(), (unsigned int)sara.getEventQueueHighWater());
+  check((events + (int)sara.getEventsDropped()) == module.urcsSent, "threaded event queue: every event is received or counted as dropped");
+}
+#endif
+
+int main()
+{
+  testEventQueue();
+
+#ifdef SARA_R5_THREAD_SAFE
+  testThreadedCommands();
+  testThreadedEventQueue();
+#endif
+
+  printf("%s\n", (failures == 0) ? "All tests passed" : "Some tests FAILED");
+  return (failures == 0) ? 0 : 1;
+}
@@ -39,13 +39,40 @@ SARA_R5::SARA_R5(int powerPin, int resetPin, uint8_t maxInitTries)
   _mqttCommandRequestCallback = nullptr;
   _registrationCallback = nullptr;
   _epsRegistrationCallback = nullptr;
+  _ftpCommandRequestCallback = nullptr;
   _debugAtPort = nullptr;
   _debugPort = nullptr;
   _printDebug = false;
   _lastRemoteIP = {0, 0, 0, 0};
   _lastLocalIP = {0, 0, 0, 0};
   for (int i = 0; i < SARA_R5_NUM_SOCKETS; i++)
+  {
     _lastSocketProtocol[i] = 0; // Set to zero initially. Will be set to TCP/UDP by socketOpen etc.
+    _socketConnectTime[i] = 0;
+    _socketSecure[i] = false;
+  }
+  _rtcmFramer = nullptr;
+  _rtcmFramingSocket = -1;
+  _rtcmFrameCallback = nullptr;
+  _rtcmFrameCallbackContext = nullptr;
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  clearStats();
+#endif
+#ifdef SARA_R5_HEAP_TRACKING
+  memset(_heapTags, 0, sizeof(_heapTags));
+#endif
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN;
+  _numLocationRequests = 0;
+  _legacyLocationRequests = 0;
+  _newSMSCallback = nullptr;
+  _newSMSCallbackContext = nullptr;
+  _numNewSMS = 0;
+  _newSMSRetries = 0;
+  _cmtPending = false;
+  resetNetworkState();
+  memset(_managedSockets, 0, sizeof(_managedSockets));
+  clearDNSCache();
+  _nextLocationRequestID = 0;
   _autoTimeZoneForBegin = true;
   _bufferedPollReentrant = false;
   _pollReentrant = false;
@@ -56,6 +83,10 @@ SARA_R5::SARA_R5(int powerPin, int resetPin, uint8_t maxInitTries)
 }
 
 SARA_R5::~SARA_R5(void) {
+  disableRingIndicator();
+#ifdef SARA_R5_THREAD_SAFE
+  stopRxTask(); // Before the buffers are deleted
+#endif
   if (nullptr != _saraRXBuffer) {
     delete[] _saraRXBuffer;
     _saraRXBuffer = nullptr;
@@ -68,6 +99,11 @@ SARA_R5::~SARA_R5(void) {
     delete[] _saraResponseBacklog;
     _saraResponseBacklog = nullptr;
   }
+  if (nullptr != _rtcmFramer) {
+    delete _rtcmFramer;
+    _rtcmFramer = nullptr;
+  }
+  disableAtTrace();
 }
 
 #ifdef SARA_R5_SOFTWARE_SERIAL_ENABLED
@@ -78,7 +114,7 @@ bool SARA_R5::begin(SoftwareSerial &softSerial, unsigned long baud)
     _saraRXBuffer = new char[_RXBuffSize];
     if (nullptr == _saraRXBuffer)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _saraRXBuffer!"));
       return false;
     }
@@ -90,7 +126,7 @@ bool SARA_R5::begin(SoftwareSerial &softSerial, unsigned long baud)
     _pruneBuffer = new char[_RXBuffSize];
     if (nullptr == _pruneBuffer)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _pruneBuffer!"));
       return false;
     }
@@ -102,7 +138,7 @@ bool SARA_R5::begin(SoftwareSerial &softSerial, unsigned long baud)
     _saraResponseBacklog = new char[_RXBuffSize];
     if (nullptr == _saraResponseBacklog)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _saraResponseBacklog!"));
       return false;
     }
@@ -129,7 +165,7 @@ bool SARA_R5::begin(HardwareSerial &hardSerial, unsigned long baud)
     _saraRXBuffer = new char[_RXBuffSize];
     if (nullptr == _saraRXBuffer)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _saraRXBuffer!"));
       return false;
     }
@@ -141,7 +177,7 @@ bool SARA_R5::begin(HardwareSerial &hardSerial, unsigned long baud)
     _pruneBuffer = new char[_RXBuffSize];
     if (nullptr == _pruneBuffer)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _pruneBuffer!"));
       return false;
     }
@@ -153,7 +189,7 @@ bool SARA_R5::begin(HardwareSerial &hardSerial, unsigned long baud)
     _saraResponseBacklog = new char[_RXBuffSize];
     if (nullptr == _saraResponseBacklog)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
         _debugPort->println(F("begin: not enough memory for _saraResponseBacklog!"));
       return false;
     }
@@ -188,12 +224,567 @@ void SARA_R5::enableAtDebugging(Print &debugPort)
   _printAtDebug = true;
 }
 
+bool SARA_R5::enableAtTrace(size_t size)
+{
+  disableAtTrace();
+  if (size < SARA_R5_AT_TRACE_MIN_SIZE)
+    size = SARA_R5_AT_TRACE_MIN_SIZE;
+  _atTrace = new uint8_t[size];
+  if (nullptr == _atTrace)
+    return false;
+  _atTraceSize = size;
+  _atTraceDropped = 0;
+  clearAtTrace();
+  return true;
+}
+
+void SARA_R5::disableAtTrace(void)
+{
+  if (nullptr != _atTrace)
+  {
+    delete[] _atTrace;
+    _atTrace = nullptr;
+  }
+  _atTraceSize = 0;
+  clearAtTrace();
+}
+
+void SARA_R5::clearAtTrace(void)
+{
+  _atTraceHead = 0;
+  _atTraceTail = 0;
+  _atTraceUsed = 0;
+  _atTraceOpen = false;
+}
+
+size_t SARA_R5::dumpAtTrace(Print &out, bool clear)
+{
+  size_t records = 0;
+  size_t used = 0;
+  size_t pos = _atTraceTail;
+
+  if (nullptr == _atTrace)
+    return 0;
+
+  while (used < _atTraceUsed)
+  {
+    uint8_t header = _atTrace[pos];
+    uint8_t length = header & SARA_R5_AT_TRACE_MAX_RECORD_DATA;
+    unsigned long stamp = 0;
+    for (int i = 0; i < 4; i++)
+      stamp |= ((unsigned long)_atTrace[(pos + 1 + i) % _atTraceSize]) << (8 * i);
+
+    out.print(stamp);
+    out.print(((header & SARA_R5_AT_TRACE_RX) != 0) ? F(" < ") : F(" > "));
+    for (uint8_t i = 0; i < length; i++)
+    {
+      char c = (char)_atTrace[(pos + SARA_R5_AT_TRACE_HEADER_LENGTH + i) % _atTraceSize];
+      if (c == '\r')
+        out.print(F("\\r"));
+      else if (c == '\n')
+        out.print(F("\\n"));
+      else if (c == '\\')
+        out.print(F("\\\\"));
+      else if ((c >= ' ') && (c <= '~'))
+        out.write(c);
+      else
+      {
+        out.print(F("\\x"));
+        if ((uint8_t)c < 0x10)
+          out.write('0');
+        out.print((uint8_t)c, HEX);
+      }
+    }
+    out.println();
+
+    pos = (pos + SARA_R5_AT_TRACE_HEADER_LENGTH + length) % _atTraceSize;
+    used += SARA_R5_AT_TRACE_HEADER_LENGTH + length;
+    records++;
+  }
+
+  if (clear)
+    clearAtTrace();
+  return records;
+}
+
+size_t SARA_R5::readAtTrace(uint8_t *dest, size_t size)
+{
+  size_t copied = 0;
+
+  if ((nullptr == _atTrace) || (nullptr == dest))
+    return 0;
+
+  _atTraceOpen = false; // Don't add to a record which has been read
+
+  while (_atTraceUsed > 0)
+  {
+    size_t recordLength = SARA_R5_AT_TRACE_HEADER_LENGTH + (_atTrace[_atTraceTail] & SARA_R5_AT_TRACE_MAX_RECORD_DATA);
+    if ((copied + recordLength) > size)
+      break;
+    for (size_t i = 0; i < recordLength; i++)
+    {
+      dest[copied++] = _atTrace[_atTraceTail];
+      _atTraceTail = (_atTraceTail + 1) % _atTraceSize;
+    }
+    _atTraceUsed -= recordLength;
+  }
+
+  return copied;
+}
+
+void SARA_R5::traceAt(bool rx, const uint8_t *data, size_t length)
+{
+  unsigned long now = millis();
+
+  while (length > 0)
+  {
+    uint8_t header = _atTrace[_atTraceLast];
+    if ((!_atTraceOpen) || (((header & SARA_R5_AT_TRACE_RX) != 0) != rx) ||
+        ((header & SARA_R5_AT_TRACE_MAX_RECORD_DATA) == SARA_R5_AT_TRACE_MAX_RECORD_DATA) ||
+        ((now - _atTraceLastMillis) >= SARA_R5_AT_TRACE_COALESCE))
+    {
+      // Start a new record
+      while ((_atTraceSize - _atTraceUsed) < (SARA_R5_AT_TRACE_HEADER_LENGTH + 1))
+        traceDropOldest();
+      _atTraceLast = _atTraceHead;
+      _atTrace[_atTraceHead] = rx ? SARA_R5_AT_TRACE_RX : 0;
+      for (int i = 1; i < SARA_R5_AT_TRACE_HEADER_LENGTH; i++)
+        _atTrace[(_atTraceHead + i) % _atTraceSize] = (uint8_t)(now >> (8 * (i - 1)));
+      _atTraceHead = (_atTraceHead + SARA_R5_AT_TRACE_HEADER_LENGTH) % _atTraceSize;
+      _atTraceUsed += SARA_R5_AT_TRACE_HEADER_LENGTH;
+      _atTraceLastMillis = now;
+      _atTraceOpen = true;
+    }
+    else
+    {
+      // The ring is at least twice the longest record, so this never discards the newest record
+      while (_atTraceUsed == _atTraceSize)
+        traceDropOldest();
+    }
+    _atTrace[_atTraceHead] = *data++;
+    _atTraceHead = (_atTraceHead + 1) % _atTraceSize;
+    _atTraceUsed++;
+    _atTrace[_atTraceLast]++; // The length is in the low bits of the header
+    length--;
+  }
+}
+
+void SARA_R5::traceDropOldest(void)
+{
+  size_t recordLength = SARA_R5_AT_TRACE_HEADER_LENGTH + (_atTrace[_atTraceTail] & SARA_R5_AT_TRACE_MAX_RECORD_DATA);
+  _atTraceTail = (_atTraceTail + recordLength) % _atTraceSize;
+  _atTraceUsed -= recordLength;
+  _atTraceDropped++;
+  if (_atTraceUsed == 0)
+    _atTraceOpen = false;
+}
+
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+const SARA_R5_command_stats *SARA_R5::getStats(uint8_t index)
+{
+  if (index >= _numCommandStats)
+    return nullptr;
+  return &_commandStats[index];
+}
+
+void SARA_R5::clearStats(void)
+{
+  memset(_commandStats, 0, sizeof(_commandStats));
+  _numCommandStats = 0;
+}
+
+void SARA_R5::dumpStats(Print &out)
+{
+  out.println(F("Command: count errors timeouts mean(ms) max(ms) | latency histogram: <1ms 1ms 2-3ms 4-7ms ..."));
+  for (uint8_t i = 0; i < _numCommandStats; i++)
+  {
+    const SARA_R5_command_stats *entry = &_commandStats[i];
+    if (strcmp(entry->prefix, "*") != 0)
+      out.print(F("AT"));
+    out.print(entry->prefix);
+    out.print(F(": "));
+    out.print(entry->count);
+    out.print(F(" "));
+    out.print(entry->errors);
+    out.print(F(" "));
+    out.print(entry->timeouts);
+    out.print(F(" "));
+    out.print((entry->count > 0) ? (entry->totalMillis / entry->count) : 0);
+    out.print(F(" "));
+    out.print(entry->maxMillis);
+    out.print(F(" |"));
+    for (uint8_t b = 0; b < SARA_R5_COMMAND_STATS_BUCKETS; b++)
+    {
+      out.print(F(" "));
+      out.print(entry->histogram[b]);
+    }
+    out.println();
+  }
+}
+
+void SARA_R5::recordCommandStats(bool dataPhase, unsigned long elapsed, SARA_R5_error_t result)
+{
+  char prefix[SARA_R5_COMMAND_STATS_PREFIX_LENGTH];
+  SARA_R5_command_stats *entry = nullptr;
+  uint8_t bucket = 0;
+
+  strcpy(prefix, _statsPrefix);
+  if (dataPhase)
+    strcat(prefix, ">");
+
+  for (uint8_t i = 0; i < _numCommandStats; i++)
+  {
+    if (strcmp(_commandStats[i].prefix, prefix) == 0)
+    {
+      entry = &_commandStats[i];
+      break;
+    }
+  }
+  if (entry == nullptr)
+  {
+    if (_numCommandStats < (SARA_R5_COMMAND_STATS_SIZE - 1))
+    {
+      entry = &_commandStats[_numCommandStats++];
+      strcpy(entry->prefix, prefix);
+    }
+    else // The table is full. Use the last entry for everything else
+    {
+      entry = &_commandStats[SARA_R5_COMMAND_STATS_SIZE - 1];
+      strcpy(entry->prefix, "*");
+      _numCommandStats = SARA_R5_COMMAND_STATS_SIZE;
+    }
+  }
+
+  entry->count++;
+  if (result == SARA_R5_ERROR_ERROR)
+    entry->errors++;
+  else if (result == SARA_R5_ERROR_NO_RESPONSE)
+    entry->timeouts++;
+  entry->totalMillis += elapsed;
+  if (elapsed > entry->maxMillis)
+    entry->maxMillis = elapsed;
+
+  while ((elapsed > 0) && (bucket < (SARA_R5_COMMAND_STATS_BUCKETS - 1)))
+  {
+    bucket++;
+    elapsed >>= 1;
+  }
+  if (entry->histogram[bucket] < 0xFFFF)
+    entry->histogram[bucket]++;
+}
+#endif
+
+void SARA_R5::enableEventQueue(bool enable)
+{
+  _eventQueue.reset();
+  _eventQueueEnabled = enable;
+}
+
+bool SARA_R5::readEvent(SARA_R5_event &event)
+{
+  return _eventQueue.pop(event);
+}
+
+void SARA_R5::queueEvent(SARA_R5_event &event)
+{
+  event.millis = millis();
+  if (!_eventQueue.push(event))
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("queueEvent: event queue full. Event discarded"));
+  }
+}
+
+bool SARA_R5::isInternalSocket(int socket)
+{
+  if (socket < 0)
+    return false;
+  return (socket == _sntpSocket) || ((socket == _rtcmFramingSocket) && (_rtcmFramer != nullptr));
+}
+
+uint8_t SARA_R5::dispatchEvents(uint8_t maxEvents)
+{
+  SARA_R5_event event;
+  uint8_t dispatched = 0;
+
+  while ((dispatched < maxEvents) && _eventQueue.pop(event))
+  {
+    dispatched++;
+
+    switch (event.type)
+    {
+    case SARA_R5_EVENT_SOCKET_DATA:
+      if (event.socketData.udp)
+        parseSocketReadIndicationUDP(event.socketData.socket, event.socketData.length);
+      else
+        parseSocketReadIndication(event.socketData.socket, event.socketData.length);
+      break;
+    case SARA_R5_EVENT_SOCKET_LISTEN:
+    {
+      IPAddress localIP(event.socketListen.localIP[0], event.socketListen.localIP[1], event.socketListen.localIP[2], event.socketListen.localIP[3]);
+      IPAddress remoteIP(event.socketListen.remoteIP[0], event.socketListen.remoteIP[1], event.socketListen.remoteIP[2], event.socketListen.remoteIP[3]);
+      parseSocketListenIndication(event.socketListen.listenSocket, localIP, event.socketListen.listenPort,
+                                  event.socketListen.socket, remoteIP, event.socketListen.port);
+    }
+    break;
+    case SARA_R5_EVENT_SOCKET_CLOSED:
+      callSocketCloseCallback(event.socketClosed.socket);
+      break;
+    case SARA_R5_EVENT_SIM_STATE:
+      callSIMstateReportCallback(event.simState.state);
+      break;
+    case SARA_R5_EVENT_PSD_ACTION:
+      callPSDActionCallback(event.psdAction.result,
+                            IPAddress(event.psdAction.ip[0], event.psdAction.ip[1], event.psdAction.ip[2], event.psdAction.ip[3]));
+      break;
+    case SARA_R5_EVENT_HTTP_RESULT:
+      callHTTPCommandCallback(event.http.profile, event.http.command, event.http.result);
+      break;
+    case SARA_R5_EVENT_MQTT_RESULT:
+      callMQTTCommandCallback(event.result.command, event.result.result);
+      break;
+    case SARA_R5_EVENT_FTP_RESULT:
+      callFTPCommandCallback(event.result.command, event.result.result);
+      break;
+    case SARA_R5_EVENT_PING:
+      callPingCallback(event.ping.retry, event.ping.size, String(event.ping.host),
+                       IPAddress(event.ping.ip[0], event.ping.ip[1], event.ping.ip[2], event.ping.ip[3]),
+                       event.ping.ttl, event.ping.rtt);
+      break;
+    case SARA_R5_EVENT_REGISTRATION:
+      callRegistrationCallback(event.registration.status, event.registration.lac, (unsigned int)event.registration.ci, event.registration.act);
+      break;
+    case SARA_R5_EVENT_EPS_REGISTRATION:
+      callEpsRegistrationCallback(event.registration.status, event.registration.lac, (unsigned int)event.registration.ci, event.registration.act);
+      break;
+    }
+  }
+
+  return dispatched;
+}
+
+void SARA_R5::setBacklogOverflowCallback(void (*overflowCallback)(size_t dropped, void *context), void *context)
+{
+  SARA_R5_LOCK();
+
+  _backlogOverflowCallback = overflowCallback;
+  _backlogOverflowCallbackContext = context;
+}
+
+void SARA_R5::resetBacklogStats(void)
+{
+  SARA_R5_LOCK();
+
+  _backlogOverflows = 0;
+  _backlogBytesDropped = 0;
+  _backlogHighWater = _saraResponseBacklogLength;
+  _backlogDroppedPending = 0;
+}
+
+// Called when characters are discarded because the backlog is full. An overflow is counted once, until it has been reported
+void SARA_R5::backlogOverflow(size_t dropped)
+{
+  if (_backlogDroppedPending == 0)
+    _backlogOverflows++;
+  _backlogDroppedPending += dropped;
+  _backlogBytesDropped += dropped;
+  updateBacklogHighWater();
+}
+
+void SARA_R5::processBacklogOverflow(void)
+{
+  if (_backlogDroppedPending == 0)
+    return;
+
+  size_t dropped = _backlogDroppedPending;
+  _backlogDroppedPending = 0;
+
+  if (SARA_R5_LOG_ERROR_ENABLED)
+  {
+    _debugPort->print(F("processBacklogOverflow: backlog overflow! Bytes dropped: "));
+    _debugPort->println((unsigned long)dropped);
+  }
+
+  if (_backlogOverflowCallback != nullptr)
+    _backlogOverflowCallback(dropped, _backlogOverflowCallbackContext);
+}
+
+SARA_R5_error_t SARA_R5::recoverFromOverflow(void)
+{
+  SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
+
+  for (int socket = 0; socket < SARA_R5_NUM_SOCKETS; socket++)
+  {
+    if (_lastSocketProtocol[socket] == 0) // Never opened
+      continue;
+
+    int length = 0;
+    bool udp = (_lastSocketProtocol[socket] == SARA_R5_UDP);
+    // Closed sockets return an error. Skip them
+    if ((udp ? socketReadAvailableUDP(socket, &length) : socketReadAvailable(socket, &length)) != SARA_R5_ERROR_SUCCESS)
+      continue;
+    if (length <= 0)
+      continue;
+
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+    {
+      _debugPort->print(F("recoverFromOverflow: socket "));
+      _debugPort->print(socket);
+      _debugPort->print(F(" has "));
+      _debugPort->print(length);
+      _debugPort->println(F(" bytes waiting"));
+    }
+
+    // Process the data as if the +UUSORD / +UUSORF had been received
+    SARA_R5_error_t result = udp ? parseSocketReadIndicationUDP(socket, length) : parseSocketReadIndication(socket, length);
+    if (result != SARA_R5_ERROR_SUCCESS)
+      err = result;
+  }
+
+  return err;
+}
+
+#ifdef SARA_R5_THREAD_SAFE
+#ifdef SARA_R5_THREAD_FREERTOS
+SARA_R5_Mutex::SARA_R5_Mutex(void)
+{
+  _handle = xSemaphoreCreateRecursiveMutex();
+}
+
+SARA_R5_Mutex::~SARA_R5_Mutex(void)
+{
+  if (_handle != nullptr)
+    vSemaphoreDelete(_handle);
+}
+
+void SARA_R5_Mutex::lock(void)
+{
+  if (_handle != nullptr)
+    xSemaphoreTakeRecursive(_handle, portMAX_DELAY);
+}
+
+void SARA_R5_Mutex::unlock(void)
+{
+  if (_handle != nullptr)
+    xSemaphoreGiveRecursive(_handle);
+}
+
+void SARA_R5::rxTask(void *parameter)
+{
+  SARA_R5 *sara = (SARA_R5 *)parameter;
+  TickType_t ticks = pdMS_TO_TICKS(sara->_rxTaskInterval);
+  if (ticks == 0)
+    ticks = 1; // Always give the other tasks a chance to take the mutex
+
+  while (!sara->_rxTaskStop)
+  {
+    sara->bufferedPoll();
+    vTaskDelay(ticks);
+  }
+
+  sara->_rxTaskHandle = nullptr; // Tell stopRxTask we have finished
+  vTaskDelete(nullptr);
+}
+
+bool SARA_R5::startRxTask(unsigned long intervalMillis)
+{
+  if ((_saraRXBuffer == nullptr) || (_rxTaskHandle != nullptr))
+    return false;
+
+  _rxTaskInterval = intervalMillis;
+  _rxTaskStop = false;
+  TaskHandle_t handle;
+  if (xTaskCreate(rxTask, "SARA_R5_RX", SARA_R5_RX_TASK_STACK_SIZE, this, SARA_R5_RX_TASK_PRIORITY, &handle) != pdPASS)
+    return false;
+  _rxTaskHandle = handle;
+  return true;
+}
+
+void SARA_R5::stopRxTask(void)
+{
+  if (_rxTaskHandle == nullptr)
+    return;
+
+  _rxTaskStop = true;
+
+  if (xTaskGetCurrentTaskHandle() == _rxTaskHandle)
+    return; // Called from a callback. The task will exit when the callback returns
+
+  while (_rxTaskHandle != nullptr)
+    delay(1);
+}
+
+bool SARA_R5::rxTaskRunning(void)
+{
+  return (_rxTaskHandle != nullptr);
+}
+#else
+SARA_R5_Mutex::SARA_R5_Mutex(void)
+{
+}
+
+SARA_R5_Mutex::~SARA_R5_Mutex(void)
+{
+}
+
+void SARA_R5_Mutex::lock(void)
+{
+  _mutex.lock();
+}
+
+void SARA_R5_Mutex::unlock(void)
+{
+  _mutex.unlock();
+}
+
+void SARA_R5::rxTask(void)
+{
+  while (!_rxTaskStop)
+  {
+    bufferedPoll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(_rxTaskInterval > 0 ? _rxTaskInterval : 1));
+  }
+}
+
+bool SARA_R5::startRxTask(unsigned long intervalMillis)
+{
+  if ((_saraRXBuffer == nullptr) || _rxThread.joinable())
+    return false;
+
+  _rxTaskInterval = intervalMillis;
+  _rxTaskStop = false;
+  _rxThread = std::thread(&SARA_R5::rxTask, this);
+  return true;
+}
+
+void SARA_R5::stopRxTask(void)
+{
+  if (!_rxThread.joinable())
+    return;
+
+  _rxTaskStop = true;
+
+  if (std::this_thread::get_id() == _rxThread.get_id())
+    _rxThread.detach(); // Called from a callback. The thread will exit when the callback returns
+  else
+    _rxThread.join();
+}
+
+bool SARA_R5::rxTaskRunning(void)
+{
+  return _rxThread.joinable();
+}
+#endif
+#endif
+
 // This function was originally written by Matthew Menze for the LTE Shield (SARA-R4) library
 // See: https://github.com/sparkfun/SparkFun_LTE_Shield_Arduino_Library/pull/8
 // It does the same job as ::poll but also processed any 'old' data stored in the backlog first
 // It also has a built-in timeout - which ::poll does not
 bool SARA_R5::bufferedPoll(void)
 {
+  SARA_R5_LOCK(); // Before the reentry check - another task could be polling
+
   if (_bufferedPollReentrant == true) // Check for reentry (i.e. bufferedPoll has been called from inside a callback)
     return false;
 
@@ -204,15 +795,17 @@ bool SARA_R5::bufferedPoll(void)
   bool handled = false;
   unsigned long timeIn = millis();
   char *event;
-  int backlogLen = _saraResponseBacklogLength;
+  int backlogLen = _operatorScanActive ? 0 : _saraResponseBacklogLength; // URCs received during an operator scan wait until it is complete
 
   memset(_saraRXBuffer, 0, _RXBuffSize); // Clear _saraRXBuffer
 
+  updateBacklogHighWater();
+
   // Does the backlog contain any data? If it does, copy it into _saraRXBuffer and then clear the backlog
-  if (_saraResponseBacklogLength > 0)
+  if (backlogLen > 0)
   {
     //The backlog also logs reads from other tasks like transmitting.
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       _debugPort->print(F("bufferedPoll: backlog found! backlogLen is "));
       _debugPort->println(_saraResponseBacklogLength);
@@ -233,7 +826,8 @@ bool SARA_R5::bufferedPoll(void)
     // Be aware that if a long message is being received, the code below will timeout after _rxWindowMillis = 2 millis.
     // At 115200 baud, hwAvailable takes ~120 * 10 / 115200 = 10.4 millis before it indicates that data is being received.
 
-    while (((millis() - timeIn) < _rxWindowMillis) && (avail < _RXBuffSize))
+    // If an operator scan is in progress, the serial data is read by processOperatorScan instead
+    while ((!_operatorScanActive) && ((millis() - timeIn) < _rxWindowMillis) && (avail < (_RXBuffSize - 1))) // Leave room for the NULL
     {
       if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is NULL
       {
@@ -265,12 +859,12 @@ bool SARA_R5::bufferedPoll(void)
     event = strtok_r(_saraRXBuffer, "\r\n", &preservedEvent); // Look for an 'event' (_saraRXBuffer contains something ending in \r\n)
 
     if (event != nullptr)
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
         _debugPort->println(F("bufferedPoll: event(s) found! ===>"));
 
     while (event != nullptr) // Keep going until all events have been processed
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
       {
         _debugPort->print(F("bufferedPoll: start of event: "));
         _debugPort->println(event);
@@ -279,14 +873,14 @@ bool SARA_R5::bufferedPoll(void)
       //Process the event
       bool latestHandled = processURCEvent((const char *)event);
       if (latestHandled) {
-        if ((true == _printAtDebug) && (nullptr != event)) {
+        if (SARA_R5_LOG_AT_ENABLED && (nullptr != event)) {
           _debugAtPort->print(event);
         }
         handled = true; // handled will be true if latestHandled has ever been true
       }
-      if ((_saraResponseBacklogLength > 0) && ((avail + _saraResponseBacklogLength) < _RXBuffSize)) // Has any new data been added to the backlog?
+      if ((_saraResponseBacklogLength > 0) && (!_operatorScanActive) && ((avail + _saraResponseBacklogLength) < _RXBuffSize)) // Has any new data been added to the backlog?
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
         {
           _debugPort->println(F("bufferedPoll: new backlog added!"));
         }
@@ -299,15 +893,17 @@ bool SARA_R5::bufferedPoll(void)
       //Walk through any remaining events
       event = strtok_r(nullptr, "\r\n", &preservedEvent);
 
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
         _debugPort->println(F("bufferedPoll: end of event")); //Just to denote end of processing event.
 
       if (event == nullptr)
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("bufferedPoll: <=== end of event(s)!"));
     }
   }
 
+  processAsyncTasks(); // Send any queued requests, check for timeouts etc.
+
   _bufferedPollReentrant = false;
 
   return handled;
@@ -316,6 +912,20 @@ bool SARA_R5::bufferedPoll(void)
 // Parse incoming URC's - the associated parse functions pass the data to the user via the callbacks (if defined)
 bool SARA_R5::processURCEvent(const char *event)
 {
+  if (_cmtPending) // The previous event was a +CMT header. This event is the message
+  {
+    _cmtPending = false;
+
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+      _debugPort->println(F("processReadEvent: CMT message"));
+
+    if (_newSMSCallback != nullptr)
+    {
+      _newSMSCallback(-1, _cmtFrom, _cmtDateTime, event, strlen(event), _newSMSCallbackContext);
+    }
+
+    return true;
+  }
   { // URC: +UUSORD (Read Socket Data)
     int socket, length;
     char *searchPtr = strstr(event, SARA_R5_READ_SOCKET_URC);
@@ -326,7 +936,7 @@ bool SARA_R5::processURCEvent(const char *event)
       int ret = sscanf(searchPtr, "%d,%d", &socket, &length);
       if (ret == 2)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: read socket data"));
         // From the SARA_R5 AT Commands Manual:
         // "For the UDP socket type the URC +UUSORD: <socket>,<length> notifies that a UDP packet has been received,
@@ -335,9 +945,18 @@ bool SARA_R5::processURCEvent(const char *event)
         // So we need to check if this is a TCP socket or a UDP socket:
         //  If UDP, we call parseSocketReadIndicationUDP.
         //  Otherwise, we call parseSocketReadIndication.
-        if (_lastSocketProtocol[socket] == SARA_R5_UDP)
+        if (_eventQueueEnabled && !isInternalSocket(socket))
         {
-          if (_printDebug == true)
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_SOCKET_DATA;
+          queued.socketData.socket = socket;
+          queued.socketData.length = length;
+          queued.socketData.udp = (_lastSocketProtocol[socket] == SARA_R5_UDP);
+          queueEvent(queued);
+        }
+        else if (_lastSocketProtocol[socket] == SARA_R5_UDP)
+        {
+          if (SARA_R5_LOG_DEBUG_ENABLED)
             _debugPort->println(F("processReadEvent: received +UUSORD but socket is UDP. Calling parseSocketReadIndicationUDP"));
           parseSocketReadIndicationUDP(socket, length);
         }
@@ -357,9 +976,19 @@ bool SARA_R5::processURCEvent(const char *event)
       int ret = sscanf(searchPtr, "%d,%d", &socket, &length);
       if (ret == 2)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: UDP receive"));
-        parseSocketReadIndicationUDP(socket, length);
+        if (_eventQueueEnabled && !isInternalSocket(socket))
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_SOCKET_DATA;
+          queued.socketData.socket = socket;
+          queued.socketData.length = length;
+          queued.socketData.udp = true;
+          queueEvent(queued);
+        }
+        else
+          parseSocketReadIndicationUDP(socket, length);
         return true;
       }
     }
@@ -395,11 +1024,27 @@ bool SARA_R5::processURCEvent(const char *event)
       }
       if (ret >= 5)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: socket listen"));
-        parseSocketListenIndication(listenSocket, localIP, listenPort, socket, remoteIP, port);
-        return true;
-      }
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_SOCKET_LISTEN;
+          queued.socketListen.listenSocket = listenSocket;
+          queued.socketListen.listenPort = listenPort;
+          queued.socketListen.socket = socket;
+          queued.socketListen.port = port;
+          for (int i = 0; i <= 3; i++)
+          {
+            queued.socketListen.localIP[i] = localIP[i];
+            queued.socketListen.remoteIP[i] = remoteIP[i];
+          }
+          queueEvent(queued);
+        }
+        else
+          parseSocketListenIndication(listenSocket, localIP, listenPort, socket, remoteIP, port);
+        return true;
+      }
     }
   }
   { // URC: +UUSOCL (Close Socket)
@@ -412,13 +1057,21 @@ bool SARA_R5::processURCEvent(const char *event)
       int ret = sscanf(searchPtr, "%d", &socket);
       if (ret == 1)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: socket close"));
         if ((socket >= 0) && (socket <= 6))
         {
-          if (_socketCloseCallback != nullptr)
+          managedSocketClosed(socket);
+          if (_eventQueueEnabled)
           {
-            _socketCloseCallback(socket);
+            SARA_R5_event queued;
+            queued.type = SARA_R5_EVENT_SOCKET_CLOSED;
+            queued.socketClosed.socket = socket;
+            queueEvent(queued);
+          }
+          else
+          {
+            callSocketCloseCallback(socket);
           }
         }
         return true;
@@ -459,7 +1112,7 @@ bool SARA_R5::processURCEvent(const char *event)
       if (scanNum >= 13)
       {
         // Found a Location string!
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
         {
           _debugPort->println(F("processReadEvent: location"));
         }
@@ -479,7 +1132,7 @@ bool SARA_R5::processURCEvent(const char *event)
           spd.cog = (float)cogU;
         }
 
-        // if (_printDebug == true)
+        // if (SARA_R5_LOG_DEBUG_ENABLED)
         // {
         //   _debugPort->print(F("processReadEvent: location:  lat: "));
         //   _debugPort->print(gps.lat, 7);
@@ -493,10 +1146,14 @@ bool SARA_R5::processURCEvent(const char *event)
         //   _debugPort->println(spd.cog, 2);
         // }
 
-        if (_gpsRequestCallback != nullptr)
-        {
-          _gpsRequestCallback(clck, gps, spd, uncertainty);
-        }
+        callGpsRequestCallback(clck, gps, spd, uncertainty);
+
+        // processLocationRequests does not send an async request while a gpsRequest is outstanding,
+        // so if the head request is active this +UULOC is for it. Otherwise it was for gpsRequest
+        if ((_numLocationRequests > 0) && (_locationRequests[0].active))
+          completeLocationRequest(SARA_R5_ERROR_SUCCESS, &clck, &gps, &spd, uncertainty);
+        else if (_legacyLocationRequests > 0)
+          _legacyLocationRequests--;
 
         return true;
       }
@@ -516,14 +1173,21 @@ bool SARA_R5::processURCEvent(const char *event)
 
       if (scanNum == 1)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: SIM status"));
 
         state = (SARA_R5_sim_states_t)stateStore;
 
-        if (_simStateReportCallback != nullptr)
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_SIM_STATE;
+          queued.simState.state = state;
+          queueEvent(queued);
+        }
+        else
         {
-          _simStateReportCallback(state);
+          callSIMstateReportCallback(state);
         }
 
         return true;
@@ -544,9 +1208,13 @@ bool SARA_R5::processURCEvent(const char *event)
       scanNum = sscanf(searchPtr, "%d,\"%d.%d.%d.%d\"",
                         &result, &remoteIPstore[0], &remoteIPstore[1], &remoteIPstore[2], &remoteIPstore[3]);
 
+      // The connection manager only needs the result. It is processed in processConnectionManager
+      if ((scanNum >= 1) && (_connectionState == SARA_R5_CONNECTION_ACTIVATING))
+        _connectionActivationResult = result;
+
       if (scanNum == 5)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: packet switched data action"));
 
         for (int i = 0; i <= 3; i++)
@@ -554,15 +1222,43 @@ bool SARA_R5::processURCEvent(const char *event)
           remoteIP[i] = (uint8_t)remoteIPstore[i];
         }
 
-        if (_psdActionRequestCallback != nullptr)
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_PSD_ACTION;
+          queued.psdAction.result = result;
+          for (int i = 0; i <= 3; i++)
+            queued.psdAction.ip[i] = remoteIP[i];
+          queueEvent(queued);
+        }
+        else
         {
-          _psdActionRequestCallback(result, remoteIP);
+          callPSDActionCallback(result, remoteIP);
         }
 
         return true;
       }
     }
   }
+  { // URC: +UUPSDD (PSD profile deactivated by the network)
+    int profile;
+    const char *searchPtr = strstr(event, SARA_R5_MESSAGE_PDP_DEACTIVATED_URC);
+    if (searchPtr != nullptr)
+    {
+      searchPtr += strlen(SARA_R5_MESSAGE_PDP_DEACTIVATED_URC); // Move searchPtr to first character - probably a space
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      if (sscanf(searchPtr, "%d", &profile) == 1)
+      {
+        if (SARA_R5_LOG_DEBUG_ENABLED)
+          _debugPort->println(F("processReadEvent: packet switched data deactivated"));
+
+        if ((profile == _connectionProfile) && (_connectionState == SARA_R5_CONNECTION_CONNECTED))
+          _connectionLost = true; // Re-attach from processConnectionManager
+
+        return true;
+      }
+    }
+  }
   { // URC: +UUHTTPCR (HTTP Command Result)
     int profile, command, result;
     int scanNum;
@@ -576,14 +1272,23 @@ bool SARA_R5::processURCEvent(const char *event)
 
       if (scanNum == 3)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: HTTP command result"));
 
         if ((profile >= 0) && (profile < SARA_R5_NUM_HTTP_PROFILES))
         {
-          if (_httpCommandRequestCallback != nullptr)
+          if (_eventQueueEnabled)
+          {
+            SARA_R5_event queued;
+            queued.type = SARA_R5_EVENT_HTTP_RESULT;
+            queued.http.profile = profile;
+            queued.http.command = command;
+            queued.http.result = result;
+            queueEvent(queued);
+          }
+          else
           {
-            _httpCommandRequestCallback(profile, command, result);
+            callHTTPCommandCallback(profile, command, result);
           }
         }
 
@@ -615,14 +1320,22 @@ bool SARA_R5::processURCEvent(const char *event)
       }
       if ((scanNum == 2) || (scanNum == 4))
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
         {
           _debugPort->println(F("processReadEvent: MQTT command result"));
         }
 
-        if (_mqttCommandRequestCallback != nullptr)
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_MQTT_RESULT;
+          queued.result.command = command;
+          queued.result.result = result;
+          queueEvent(queued);
+        }
+        else
         {
-          _mqttCommandRequestCallback(command, result);
+          callMQTTCommandCallback(command, result);
         }
 
         return true;
@@ -643,9 +1356,18 @@ bool SARA_R5::processURCEvent(const char *event)
       }
 
       scanNum = sscanf(searchPtr, "%d,%d", &ftpCmd, &ftpResult);
-      if (scanNum == 2 && _ftpCommandRequestCallback != nullptr)
+      if ((scanNum == 2) && _eventQueueEnabled)
+      {
+        SARA_R5_event queued;
+        queued.type = SARA_R5_EVENT_FTP_RESULT;
+        queued.result.command = ftpCmd;
+        queued.result.result = ftpResult;
+        queueEvent(queued);
+        return true;
+      }
+      if (scanNum == 2)
       {
-        _ftpCommandRequestCallback(ftpCmd, ftpResult);
+        callFTPCommandCallback(ftpCmd, ftpResult);
         return true;
       }
     }
@@ -669,7 +1391,7 @@ bool SARA_R5::processURCEvent(const char *event)
 
       if (scanNum == 2)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
         {
           _debugPort->println(F("processReadEvent: ping"));
         }
@@ -692,64 +1414,178 @@ bool SARA_R5::processURCEvent(const char *event)
             remoteIP[i] = (uint8_t)remoteIPstore[i];
           }
 
-          if (scanNum == 6) // Make sure we extracted enough data
+          if ((scanNum == 6) && _eventQueueEnabled)
           {
-            if (_pingRequestCallback != nullptr)
-            {
-              _pingRequestCallback(retry, p_size, remote_host, remoteIP, ttl, rtt);
-            }
+            SARA_R5_event queued;
+            queued.type = SARA_R5_EVENT_PING;
+            queued.ping.retry = retry;
+            queued.ping.size = p_size;
+            strncpy(queued.ping.host, remote_host.c_str(), SARA_R5_EVENT_HOST_LENGTH - 1);
+            queued.ping.host[SARA_R5_EVENT_HOST_LENGTH - 1] = '\0';
+            for (int i = 0; i <= 3; i++)
+              queued.ping.ip[i] = remoteIP[i];
+            queued.ping.ttl = ttl;
+            queued.ping.rtt = rtt;
+            queueEvent(queued);
+          }
+          else if (scanNum == 6) // Make sure we extracted enough data
+          {
+            callPingCallback(retry, p_size, remote_host, remoteIP, ttl, rtt);
           }
         }
         return true;
       }
     }
   }
-  { // URC: +CREG
-    int status = 0;
-    unsigned int lac = 0, ci = 0, Act = 0;
-    char *searchPtr = strstr(event, SARA_R5_REGISTRATION_STATUS_URC);
+  { // URC: +CREG (query responses end up here too, via the backlog. They update the network state only)
+    SARA_R5_registration_status_t status;
+    unsigned int lac = 0;
+    unsigned long ci = 0;
+    int Act = 0;
+    bool queryResponse = false;
+    const char *searchPtr = strstr(event, SARA_R5_REGISTRATION_STATUS_URC);
     if (searchPtr != nullptr)
     {
       searchPtr += strlen(SARA_R5_REGISTRATION_STATUS_URC); // Move searchPtr to first character - probably a space
-      while (*searchPtr == ' ') searchPtr++; // skip spaces
-      int scanNum = sscanf(searchPtr, "%d,\"%4x\",\"%4x\",%d", &status, &lac, &ci, &Act);
-      if (scanNum == 4)
+      int scanNum = parseRegistrationStatus(searchPtr, false, &queryResponse, &status, &lac, &ci, &Act);
+      if ((scanNum == 4) && (!queryResponse))
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: CREG"));
 
-        if (_registrationCallback != nullptr)
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_REGISTRATION;
+          queued.registration.status = status;
+          queued.registration.lac = lac;
+          queued.registration.ci = ci;
+          queued.registration.act = Act;
+          queueEvent(queued);
+        }
+        else
         {
-          _registrationCallback((SARA_R5_registration_status_t)status, lac, ci, Act);
+          callRegistrationCallback(status, lac, (unsigned int)ci, Act);
         }
 
         return true;
       }
+      if (scanNum >= 1)
+        return true;
     }
   }
   { // URC: +CEREG
-    int status = 0;
-    unsigned int tac = 0, ci = 0, Act = 0;
-    char *searchPtr = strstr(event, SARA_R5_EPSREGISTRATION_STATUS_URC);
+    SARA_R5_registration_status_t status;
+    unsigned int tac = 0;
+    unsigned long ci = 0;
+    int Act = 0;
+    bool queryResponse = false;
+    const char *searchPtr = strstr(event, SARA_R5_EPSREGISTRATION_STATUS_URC);
     if (searchPtr != nullptr)
     {
       searchPtr += strlen(SARA_R5_EPSREGISTRATION_STATUS_URC); // Move searchPtr to first character - probably a space
-      while (*searchPtr == ' ') searchPtr++; // skip spaces
-      int scanNum = sscanf(searchPtr, "%d,\"%4x\",\"%4x\",%d", &status, &tac, &ci, &Act);
-      if (scanNum == 4)
+      int scanNum = parseRegistrationStatus(searchPtr, true, &queryResponse, &status, &tac, &ci, &Act);
+      if ((scanNum == 4) && (!queryResponse))
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
           _debugPort->println(F("processReadEvent: CEREG"));
 
-        if (_epsRegistrationCallback != nullptr)
+        if (_eventQueueEnabled)
+        {
+          SARA_R5_event queued;
+          queued.type = SARA_R5_EVENT_EPS_REGISTRATION;
+          queued.registration.status = status;
+          queued.registration.lac = tac;
+          queued.registration.ci = ci;
+          queued.registration.act = Act;
+          queueEvent(queued);
+        }
+        else
+        {
+          callEpsRegistrationCallback(status, tac, (unsigned int)ci, Act);
+        }
+
+        return true;
+      }
+      if (scanNum >= 1)
+        return true;
+    }
+  }
+  { // URC: +UUGIND (Assisted GNSS indication) - only sent while the GNSS is on
+    const char *searchPtr = strstr(event, SARA_R5_GNSS_ASSISTED_IND_URC);
+    if (searchPtr != nullptr)
+    {
+      if (SARA_R5_LOG_DEBUG_ENABLED)
+        _debugPort->println(F("processReadEvent: UUGIND"));
+
+      _gnssPowerState = SARA_R5_GNSS_POWER_ON;
+
+      return true;
+    }
+  }
+  { // URC: +CMTI (New message stored)
+    int index = 0;
+    const char *searchPtr = strstr(event, SARA_R5_NEW_MESSAGE_STORED_URC);
+    if (searchPtr != nullptr)
+    {
+      searchPtr += strlen(SARA_R5_NEW_MESSAGE_STORED_URC); // Move searchPtr to first character - probably a space
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      int scanNum = sscanf(searchPtr, "\"%*[^\"]\",%d", &index); // +CMTI: <mem>,<index>
+      if (scanNum == 1)
+      {
+        if (SARA_R5_LOG_DEBUG_ENABLED)
+          _debugPort->println(F("processReadEvent: CMTI"));
+
+        if (_numNewSMS < SARA_R5_NEW_SMS_QUEUE_SIZE)
+        {
+          _newSMSIndexes[(_newSMSHead + _numNewSMS) % SARA_R5_NEW_SMS_QUEUE_SIZE] = index;
+          _numNewSMS++;
+        }
+        else if (SARA_R5_LOG_ERROR_ENABLED)
         {
-          _epsRegistrationCallback((SARA_R5_registration_status_t)status, tac, ci, Act);
+          _debugPort->println(F("processReadEvent: CMTI queue is full! The message will remain in storage"));
         }
 
         return true;
       }
     }
   }
+  { // URC: +CMT (New message routed directly) - the message follows on the next line
+    const char *searchPtr = strstr(event, SARA_R5_NEW_MESSAGE_URC);
+    if (searchPtr != nullptr)
+    {
+      char header[64];
+      char *fields[3] = {nullptr, nullptr, nullptr};
+
+      searchPtr += strlen(SARA_R5_NEW_MESSAGE_URC); // Move searchPtr to first character - probably a space
+      strncpy(header, searchPtr, sizeof(header) - 1);
+      header[sizeof(header) - 1] = '\0';
+
+      _cmtFrom[0] = '\0';
+      _cmtDateTime[0] = '\0';
+      if (_smsMessageFormat == SARA_R5_MESSAGE_FORMAT_TEXT) // +CMT: <oa>,[<alpha>],<scts>. In PDU mode: +CMT: [<alpha>],<length>
+      {
+        int numFields = splitFields(header, fields, 3);
+        if (numFields >= 1)
+        {
+          strncpy(_cmtFrom, fields[0], sizeof(_cmtFrom) - 1);
+          _cmtFrom[sizeof(_cmtFrom) - 1] = '\0';
+        }
+        if (numFields >= 3)
+        {
+          strncpy(_cmtDateTime, fields[2], sizeof(_cmtDateTime) - 1);
+          _cmtDateTime[sizeof(_cmtDateTime) - 1] = '\0';
+        }
+      }
+
+      if (SARA_R5_LOG_DEBUG_ENABLED)
+        _debugPort->println(F("processReadEvent: CMT"));
+
+      _cmtPending = true;
+
+      return true;
+    }
+  }
   // NOTE: When adding new URC messages, remember to update pruneBacklog too!
 
   return false;
@@ -760,6 +1596,8 @@ bool SARA_R5::processURCEvent(const char *event)
 // ::bufferedPoll is the new improved version. It processes any data in the backlog and includes a timeout.
 bool SARA_R5::poll(void)
 {
+  SARA_R5_LOCK(); // Before the reentry check - another task could be polling
+
   if (_pollReentrant == true) // Check for reentry (i.e. poll has been called from inside a callback)
     return false;
 
@@ -786,12 +1624,12 @@ bool SARA_R5::poll(void)
 
     // Now search for all supported URC's
     handled = processURCEvent(_saraRXBuffer);
-    if (handled && (true == _printAtDebug)) {
+    if (handled && SARA_R5_LOG_AT_ENABLED) {
       _debugAtPort->write(_saraRXBuffer, avail);
     }
     if ((handled == false) && (strlen(_saraRXBuffer) > 2))
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
       {
         _debugPort->print(F("poll: "));
         _debugPort->println(_saraRXBuffer);
@@ -810,87 +1648,331 @@ bool SARA_R5::poll(void)
 void SARA_R5::setSocketListenCallback(void (*socketListenCallback)(int, IPAddress, unsigned int, int, IPAddress, unsigned int))
 {
   _socketListenCallback = socketListenCallback;
+  _socketListenContextCallback = nullptr;
 }
 
 void SARA_R5::setSocketReadCallback(void (*socketReadCallback)(int, String))
 {
   _socketReadCallback = socketReadCallback;
+  _socketReadContextCallback = nullptr;
 }
 
 void SARA_R5::setSocketReadCallbackPlus(void (*socketReadCallbackPlus)(int, const char *, int, IPAddress, int)) // socket, data, length, remoteAddress, remotePort
 {
   _socketReadCallbackPlus = socketReadCallbackPlus;
+  _socketReadPlusContextCallback = nullptr;
 }
 
 void SARA_R5::setSocketCloseCallback(void (*socketCloseCallback)(int))
 {
   _socketCloseCallback = socketCloseCallback;
+  _socketCloseContextCallback = nullptr;
 }
 
 void SARA_R5::setGpsReadCallback(void (*gpsRequestCallback)(ClockData time,
                                                             PositionData gps, SpeedData spd, unsigned long uncertainty))
 {
   _gpsRequestCallback = gpsRequestCallback;
+  _gpsRequestContextCallback = nullptr;
 }
 
 void SARA_R5::setSIMstateReportCallback(void (*simStateReportCallback)(SARA_R5_sim_states_t state))
 {
   _simStateReportCallback = simStateReportCallback;
+  _simStateReportContextCallback = nullptr;
 }
 
 void SARA_R5::setPSDActionCallback(void (*psdActionRequestCallback)(int result, IPAddress ip))
 {
   _psdActionRequestCallback = psdActionRequestCallback;
+  _psdActionRequestContextCallback = nullptr;
 }
 
 void SARA_R5::setPingCallback(void (*pingRequestCallback)(int retry, int p_size, String remote_hostname, IPAddress ip, int ttl, long rtt))
 {
   _pingRequestCallback = pingRequestCallback;
+  _pingRequestContextCallback = nullptr;
 }
 
 void SARA_R5::setHTTPCommandCallback(void (*httpCommandRequestCallback)(int profile, int command, int result))
 {
   _httpCommandRequestCallback = httpCommandRequestCallback;
+  _httpCommandRequestContextCallback = nullptr;
 }
 
 void SARA_R5::setMQTTCommandCallback(void (*mqttCommandRequestCallback)(int command, int result))
 {
   _mqttCommandRequestCallback = mqttCommandRequestCallback;
+  _mqttCommandRequestContextCallback = nullptr;
 }
 
 void SARA_R5::setFTPCommandCallback(void (*ftpCommandRequestCallback)(int command, int result))
 {
-    _ftpCommandRequestCallback = ftpCommandRequestCallback;
+  _ftpCommandRequestCallback = ftpCommandRequestCallback;
+  _ftpCommandRequestContextCallback = nullptr;
+}
+
+void SARA_R5::setNewSMSCallback(void (*newSMSCallback)(int index, const char *from, const char *dateTime, const char *message, size_t length, void *context),
+                                void *context, bool deleteAfterRead)
+{
+  SARA_R5_LOCK();
+
+  _newSMSCallback = newSMSCallback;
+  _newSMSCallbackContext = context;
+  _newSMSDeleteAfterRead = deleteAfterRead;
+}
+
+void SARA_R5::setRTCMFrameCallback(void (*rtcmFrameCallback)(const uint8_t *frame, uint16_t length, void *context), void *context)
+{
+  SARA_R5_LOCK();
+
+  _rtcmFrameCallback = rtcmFrameCallback;
+  _rtcmFrameCallbackContext = context;
+  if (_rtcmFramer != nullptr)
+    _rtcmFramer->setFrameCallback(rtcmFrameCallback, context);
 }
 
 SARA_R5_error_t SARA_R5::setRegistrationCallback(void (*registrationCallback)(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act))
 {
   _registrationCallback = registrationCallback;
+  _registrationContextCallback = nullptr;
 
-  char *command = sara_r5_calloc_char(strlen(SARA_R5_REGISTRATION_STATUS) + 3);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d", SARA_R5_REGISTRATION_STATUS, 2/*enable URC with location*/);
-  SARA_R5_error_t err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
-  return err;
+  return enableRegistrationURC(false);
 }
 
 SARA_R5_error_t SARA_R5::setEpsRegistrationCallback(void (*registrationCallback)(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act))
 {
   _epsRegistrationCallback = registrationCallback;
+  _epsRegistrationContextCallback = nullptr;
+
+  return enableRegistrationURC(true);
+}
 
-  char *command = sara_r5_calloc_char(strlen(SARA_R5_EPSREGISTRATION_STATUS) + 3);
+SARA_R5_error_t SARA_R5::enableRegistrationURC(bool eps)
+{
+  const char *registrationStatus = eps ? SARA_R5_EPSREGISTRATION_STATUS : SARA_R5_REGISTRATION_STATUS;
+  char *command = sara_r5_calloc_char(strlen(registrationStatus) + 3);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d", SARA_R5_EPSREGISTRATION_STATUS, 2/*enable URC with location*/);
+  sprintf(command, "%s=%d", registrationStatus, 2/*enable URC with location*/);
   SARA_R5_error_t err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
+void SARA_R5::setSocketListenCallback(void (*socketListenCallback)(int listenSocket, IPAddress localIP, unsigned int listenPort, int socket, IPAddress remoteIP, unsigned int port, void *context), void *context)
+{
+  _socketListenCallback = nullptr;
+  _socketListenContextCallback = socketListenCallback;
+  _socketListenCallbackContext = context;
+}
+
+void SARA_R5::setSocketReadCallback(void (*socketReadCallback)(int socket, String data, void *context), void *context)
+{
+  _socketReadCallback = nullptr;
+  _socketReadContextCallback = socketReadCallback;
+  _socketReadCallbackContext = context;
+}
+
+void SARA_R5::setSocketReadCallbackPlus(void (*socketReadCallbackPlus)(int socket, const char *data, int length, IPAddress remoteAddress, int remotePort, void *context), void *context)
+{
+  _socketReadCallbackPlus = nullptr;
+  _socketReadPlusContextCallback = socketReadCallbackPlus;
+  _socketReadPlusCallbackContext = context;
+}
+
+void SARA_R5::setSocketCloseCallback(void (*socketCloseCallback)(int socket, void *context), void *context)
+{
+  _socketCloseCallback = nullptr;
+  _socketCloseContextCallback = socketCloseCallback;
+  _socketCloseCallbackContext = context;
+}
+
+void SARA_R5::setGpsReadCallback(void (*gpsRequestCallback)(ClockData time, PositionData gps, SpeedData spd, unsigned long uncertainty, void *context), void *context)
+{
+  _gpsRequestCallback = nullptr;
+  _gpsRequestContextCallback = gpsRequestCallback;
+  _gpsRequestCallbackContext = context;
+}
+
+void SARA_R5::setSIMstateReportCallback(void (*simStateReportCallback)(SARA_R5_sim_states_t state, void *context), void *context)
+{
+  _simStateReportCallback = nullptr;
+  _simStateReportContextCallback = simStateReportCallback;
+  _simStateReportCallbackContext = context;
+}
+
+void SARA_R5::setPSDActionCallback(void (*psdActionRequestCallback)(int result, IPAddress ip, void *context), void *context)
+{
+  _psdActionRequestCallback = nullptr;
+  _psdActionRequestContextCallback = psdActionRequestCallback;
+  _psdActionRequestCallbackContext = context;
+}
+
+void SARA_R5::setPingCallback(void (*pingRequestCallback)(int retry, int p_size, String remote_hostname, IPAddress ip, int ttl, long rtt, void *context), void *context)
+{
+  _pingRequestCallback = nullptr;
+  _pingRequestContextCallback = pingRequestCallback;
+  _pingRequestCallbackContext = context;
+}
+
+void SARA_R5::setHTTPCommandCallback(void (*httpCommandRequestCallback)(int profile, int command, int result, void *context), void *context)
+{
+  _httpCommandRequestCallback = nullptr;
+  _httpCommandRequestContextCallback = httpCommandRequestCallback;
+  _httpCommandRequestCallbackContext = context;
+}
+
+void SARA_R5::setMQTTCommandCallback(void (*mqttCommandRequestCallback)(int command, int result, void *context), void *context)
+{
+  _mqttCommandRequestCallback = nullptr;
+  _mqttCommandRequestContextCallback = mqttCommandRequestCallback;
+  _mqttCommandRequestCallbackContext = context;
+}
+
+void SARA_R5::setFTPCommandCallback(void (*ftpCommandRequestCallback)(int command, int result, void *context), void *context)
+{
+  _ftpCommandRequestCallback = nullptr;
+  _ftpCommandRequestContextCallback = ftpCommandRequestCallback;
+  _ftpCommandRequestCallbackContext = context;
+}
+
+SARA_R5_error_t SARA_R5::setRegistrationCallback(void (*registrationCallback)(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act, void *context), void *context)
+{
+  _registrationCallback = nullptr;
+  _registrationContextCallback = registrationCallback;
+  _registrationCallbackContext = context;
+
+  return enableRegistrationURC(false);
+}
+
+SARA_R5_error_t SARA_R5::setEpsRegistrationCallback(void (*epsRegistrationCallback)(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act, void *context), void *context)
+{
+  _epsRegistrationCallback = nullptr;
+  _epsRegistrationContextCallback = epsRegistrationCallback;
+  _epsRegistrationCallbackContext = context;
+
+  return enableRegistrationURC(true);
+}
+
+void SARA_R5::callSocketListenCallback(int listenSocket, IPAddress localIP, unsigned int listenPort, int socket, IPAddress remoteIP, unsigned int port)
+{
+  if (_socketListenCallback != nullptr)
+    _socketListenCallback(listenSocket, localIP, listenPort, socket, remoteIP, port);
+  else if (_socketListenContextCallback != nullptr)
+    _socketListenContextCallback(listenSocket, localIP, listenPort, socket, remoteIP, port, _socketListenCallbackContext);
+}
+
+bool SARA_R5::socketReadCallbackSet(void)
+{
+  return ((_socketReadCallback != nullptr) || (_socketReadContextCallback != nullptr)
+          || (_socketReadCallbackPlus != nullptr) || (_socketReadPlusContextCallback != nullptr));
+}
+
+// Both the String and the Plus callbacks are called, if set
+void SARA_R5::callSocketReadCallbacks(int socket, const char *data, int length, IPAddress remoteAddress, int remotePort)
+{
+  if ((_socketReadCallback != nullptr) || (_socketReadContextCallback != nullptr))
+  {
+    String dataAsString = ""; // Create an empty string
+    // Important Note: some implementations of concat, like the one on ESP32, are binary-compatible.
+    // But some, like SAMD, are not. They use strlen or strcpy internally - which don't like \0's.
+    // The only true binary-compatible solution is to use socketReadCallbackPlus...
+    for (int i = 0; i < length; i++) // Copy the data into the String in a binary-compatible way
+      dataAsString.concat(data[i]);
+    if (_socketReadCallback != nullptr)
+      _socketReadCallback(socket, dataAsString);
+    else
+      _socketReadContextCallback(socket, dataAsString, _socketReadCallbackContext);
+  }
+
+  if (_socketReadCallbackPlus != nullptr)
+    _socketReadCallbackPlus(socket, data, length, remoteAddress, remotePort);
+  else if (_socketReadPlusContextCallback != nullptr)
+    _socketReadPlusContextCallback(socket, data, length, remoteAddress, remotePort, _socketReadPlusCallbackContext);
+}
+
+void SARA_R5::callSocketCloseCallback(int socket)
+{
+  if (_socketCloseCallback != nullptr)
+    _socketCloseCallback(socket);
+  else if (_socketCloseContextCallback != nullptr)
+    _socketCloseContextCallback(socket, _socketCloseCallbackContext);
+}
+
+void SARA_R5::callGpsRequestCallback(ClockData time, PositionData gps, SpeedData spd, unsigned long uncertainty)
+{
+  if (_gpsRequestCallback != nullptr)
+    _gpsRequestCallback(time, gps, spd, uncertainty);
+  else if (_gpsRequestContextCallback != nullptr)
+    _gpsRequestContextCallback(time, gps, spd, uncertainty, _gpsRequestCallbackContext);
+}
+
+void SARA_R5::callSIMstateReportCallback(SARA_R5_sim_states_t state)
+{
+  if (_simStateReportCallback != nullptr)
+    _simStateReportCallback(state);
+  else if (_simStateReportContextCallback != nullptr)
+    _simStateReportContextCallback(state, _simStateReportCallbackContext);
+}
+
+void SARA_R5::callPSDActionCallback(int result, IPAddress ip)
+{
+  if (_psdActionRequestCallback != nullptr)
+    _psdActionRequestCallback(result, ip);
+  else if (_psdActionRequestContextCallback != nullptr)
+    _psdActionRequestContextCallback(result, ip, _psdActionRequestCallbackContext);
+}
+
+void SARA_R5::callPingCallback(int retry, int p_size, String remote_hostname, IPAddress ip, int ttl, long rtt)
+{
+  if (_pingRequestCallback != nullptr)
+    _pingRequestCallback(retry, p_size, remote_hostname, ip, ttl, rtt);
+  else if (_pingRequestContextCallback != nullptr)
+    _pingRequestContextCallback(retry, p_size, remote_hostname, ip, ttl, rtt, _pingRequestCallbackContext);
+}
+
+void SARA_R5::callHTTPCommandCallback(int profile, int command, int result)
+{
+  if (_httpCommandRequestCallback != nullptr)
+    _httpCommandRequestCallback(profile, command, result);
+  else if (_httpCommandRequestContextCallback != nullptr)
+    _httpCommandRequestContextCallback(profile, command, result, _httpCommandRequestCallbackContext);
+}
+
+void SARA_R5::callMQTTCommandCallback(int command, int result)
+{
+  if (_mqttCommandRequestCallback != nullptr)
+    _mqttCommandRequestCallback(command, result);
+  else if (_mqttCommandRequestContextCallback != nullptr)
+    _mqttCommandRequestContextCallback(command, result, _mqttCommandRequestCallbackContext);
+}
+
+void SARA_R5::callFTPCommandCallback(int command, int result)
+{
+  if (_ftpCommandRequestCallback != nullptr)
+    _ftpCommandRequestCallback(command, result);
+  else if (_ftpCommandRequestContextCallback != nullptr)
+    _ftpCommandRequestContextCallback(command, result, _ftpCommandRequestCallbackContext);
+}
+
+void SARA_R5::callRegistrationCallback(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act)
+{
+  if (_registrationCallback != nullptr)
+    _registrationCallback(status, lac, ci, Act);
+  else if (_registrationContextCallback != nullptr)
+    _registrationContextCallback(status, lac, ci, Act, _registrationCallbackContext);
+}
+
+void SARA_R5::callEpsRegistrationCallback(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act)
+{
+  if (_epsRegistrationCallback != nullptr)
+    _epsRegistrationCallback(status, tac, ci, Act);
+  else if (_epsRegistrationContextCallback != nullptr)
+    _epsRegistrationContextCallback(status, tac, ci, Act, _epsRegistrationCallbackContext);
+}
+
 size_t SARA_R5::write(uint8_t c)
 {
   return hwWrite(c);
@@ -927,7 +2009,7 @@ SARA_R5_error_t SARA_R5::enableEcho(bool enable)
   sprintf(command, "%s%d", SARA_R5_COMMAND_ECHO, enable ? 1 : 0);
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -948,7 +2030,7 @@ String SARA_R5::getManufacturerID(void)
       memset(idResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -969,7 +2051,7 @@ String SARA_R5::getModelID(void)
       memset(idResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -990,7 +2072,7 @@ String SARA_R5::getFirmwareVersion(void)
       memset(idResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -1011,7 +2093,7 @@ String SARA_R5::getSerialNo(void)
       memset(idResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -1032,7 +2114,7 @@ String SARA_R5::getIMEI(void)
       memset(imeiResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(imeiResponse);
 }
 
@@ -1053,7 +2135,7 @@ String SARA_R5::getIMSI(void)
       memset(imsiResponse, 0, 16);
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(imsiResponse);
 }
 
@@ -1080,7 +2162,7 @@ String SARA_R5::getCCID(void)
       }
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(ccidResponse);
 }
 
@@ -1107,7 +2189,7 @@ String SARA_R5::getSubscriberNo(void)
       }
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -1134,7 +2216,7 @@ String SARA_R5::getCapabilities(void)
       }
     }
   }
-  free(response);
+  sara_r5_free(response);
   return String(idResponse);
 }
 
@@ -1176,7 +2258,7 @@ String SARA_R5::clock(void)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return "";
   }
 
@@ -1184,8 +2266,8 @@ String SARA_R5::clock(void)
                                 response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return "";
   }
 
@@ -1193,24 +2275,24 @@ String SARA_R5::clock(void)
   clockBegin = strchr(response, '\"'); // Find first quote
   if (clockBegin == nullptr)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return "";
   }
   clockBegin += 1;                     // Increment pointer to begin at first number
   clockEnd = strchr(clockBegin, '\"'); // Find last quote
   if (clockEnd == nullptr)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return "";
   }
   *(clockEnd) = '\0'; // Set last quote to null char -- end string
 
   String clock = String(clockBegin); // Extract the clock as a String _before_ freeing response
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return (clock);
 }
@@ -1225,6 +2307,7 @@ SARA_R5_error_t SARA_R5::clock(uint8_t *y, uint8_t *mo, uint8_t *d,
   int scanNum = 0;
 
   int iy, imo, id, ih, imin, is, itz;
+  unsigned long sentMillis = millis();
 
   command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_CLOCK) + 2);
   if (command == nullptr)
@@ -1234,7 +2317,7 @@ SARA_R5_error_t SARA_R5::clock(uint8_t *y, uint8_t *mo, uint8_t *d,
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1264,16 +2347,131 @@ SARA_R5_error_t SARA_R5::clock(uint8_t *y, uint8_t *mo, uint8_t *d,
         *tz = 0 - itz;
       else
         *tz = itz;
+
+      // Update the clock model. +CCLK is local time - TZ is in quarter hours. The seconds are truncated: add half a second
+      unsigned long latency = millis() - sentMillis;
+      int32_t epoch = (int32_t)dateToEpoch(2000 + iy, imo, id, ih, imin, is) - ((int32_t)(*tz) * 15 * 60);
+      syncClockModel(((uint64_t)epoch * 1000) + 500, 500 + latency, millis());
     }
     else
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
+SARA_R5_error_t SARA_R5::syncClock(void)
+{
+  SARA_R5_LOCK();
+
+  uint8_t y, mo, d, h, min, s;
+  int8_t tz;
+  return clock(&y, &mo, &d, &h, &min, &s, &tz); // clock updates the model
+}
+
+void SARA_R5::setClockEpoch(uint32_t epochSeconds, uint16_t milliseconds, uint16_t accuracyMillis)
+{
+  SARA_R5_LOCK();
+
+  syncClockModel(((uint64_t)epochSeconds * 1000) + milliseconds, accuracyMillis, millis());
+}
+
+void SARA_R5::setClockResyncInterval(unsigned long intervalMillis)
+{
+  SARA_R5_LOCK();
+
+  _clockResyncInterval = intervalMillis;
+  _clockResyncAttempted = false;
+}
+
+uint32_t SARA_R5::getEpoch(void)
+{
+  SARA_R5_LOCK();
+
+  return (uint32_t)(getEpochMillis() / 1000);
+}
+
+uint64_t SARA_R5::getEpochMillis(void)
+{
+  SARA_R5_LOCK();
+
+  if (!_clockValid)
+    return 0;
+
+  unsigned long elapsed = millis() - _clockBaseMillis;
+  int64_t correction = ((int64_t)elapsed * _clockDriftPPM) / 1000000;
+  return _clockBaseEpochMillis + elapsed + correction;
+}
+
+// Days from civil: see http://howardhinnant.github.io/date_algorithms.html
+uint32_t SARA_R5::dateToEpoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+  int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int32_t days = era * 146097 + (int32_t)doe - 719468;
+  return ((uint32_t)days * 86400) + ((uint32_t)hour * 3600) + ((uint32_t)minute * 60) + second;
+}
+
+void SARA_R5::syncClockModel(uint64_t epochMillis, uint16_t accuracyMillis, unsigned long atMillis)
+{
+  if (!_clockAnchorValid)
+  {
+    setClockAnchor(epochMillis, accuracyMillis, atMillis);
+  }
+  else
+  {
+    // Estimate the millis() drift from the raw (uncorrected) time elapsed since the anchor, if the uncertainty is low enough.
+    // The anchor is not moved by each sync, so the uncertainty falls as the elapsed time grows
+    unsigned long elapsed = atMillis - _clockAnchorMillis;
+    int64_t error = (int64_t)(epochMillis - _clockAnchorEpochMillis) - (int64_t)elapsed;
+    int64_t maxError = (((int64_t)elapsed * SARA_R5_CLOCK_MAX_DRIFT_PPM) / 1000000) + accuracyMillis + _clockAnchorAccuracy;
+    bool stepped = (error > maxError) || (error < -maxError);
+    if ((!stepped) && (elapsed > 0) && ((((uint64_t)accuracyMillis + _clockAnchorAccuracy) * 1000000) / elapsed <= SARA_R5_CLOCK_DRIFT_UNCERTAINTY))
+    {
+      int32_t ppm = (int32_t)((error * 1000000) / (int64_t)elapsed);
+      if ((ppm <= SARA_R5_CLOCK_MAX_DRIFT_PPM) && (ppm >= -SARA_R5_CLOCK_MAX_DRIFT_PPM))
+      {
+        _clockDriftPPM = ppm;
+        _clockDriftValid = true;
+      }
+    }
+
+    if (stepped)
+      setClockAnchor(epochMillis, accuracyMillis, atMillis); // The clock was set to a different time. Measure from here
+    else if (elapsed >= SARA_R5_CLOCK_ANCHOR_MAX_AGE)
+      setClockAnchor(epochMillis, accuracyMillis, atMillis); // Keep the estimate, but start again before millis() wraps
+    else if ((!_clockDriftValid) && (((uint32_t)accuracyMillis * 2) < _clockAnchorAccuracy))
+      setClockAnchor(epochMillis, accuracyMillis, atMillis); // A much better sync (e.g. NTP after +CCLK) gives an estimate sooner
+  }
+
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+  {
+    _debugPort->print(F("syncClockModel: accuracy "));
+    _debugPort->print(accuracyMillis);
+    _debugPort->print(F(" ms, drift "));
+    _debugPort->print(_clockDriftPPM);
+    _debugPort->println(F(" ppm"));
+  }
+
+  _clockBaseEpochMillis = epochMillis;
+  _clockBaseMillis = atMillis;
+  _clockAccuracy = accuracyMillis;
+  _clockValid = true;
+}
+
+void SARA_R5::setClockAnchor(uint64_t epochMillis, uint16_t accuracyMillis, unsigned long atMillis)
+{
+  _clockAnchorEpochMillis = epochMillis;
+  _clockAnchorMillis = atMillis;
+  _clockAnchorAccuracy = accuracyMillis;
+  _clockAnchorValid = true;
+}
+
 SARA_R5_error_t SARA_R5::setClock(uint8_t y, uint8_t mo, uint8_t d,
                                   uint8_t h, uint8_t min, uint8_t s, int8_t tz)
 {
@@ -1327,7 +2525,7 @@ SARA_R5_error_t SARA_R5::setClock(String theTime)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1351,7 +2549,7 @@ SARA_R5_error_t SARA_R5::setUtimeMode(SARA_R5_utime_mode_t mode, SARA_R5_utime_s
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_10_SEC_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1372,7 +2570,7 @@ SARA_R5_error_t SARA_R5::getUtimeMode(SARA_R5_utime_mode_t *mode, SARA_R5_utime_
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1406,8 +2604,8 @@ SARA_R5_error_t SARA_R5::getUtimeMode(SARA_R5_utime_mode_t *mode, SARA_R5_utime_
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -1423,7 +2621,7 @@ SARA_R5_error_t SARA_R5::setUtimeIndication(SARA_R5_utime_urc_configuration_t co
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1443,7 +2641,7 @@ SARA_R5_error_t SARA_R5::getUtimeIndication(SARA_R5_utime_urc_configuration_t *c
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1470,8 +2668,8 @@ SARA_R5_error_t SARA_R5::getUtimeIndication(SARA_R5_utime_urc_configuration_t *c
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -1491,7 +2689,7 @@ SARA_R5_error_t SARA_R5::setUtimeConfiguration(int32_t offsetNanoseconds, int32_
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1512,7 +2710,7 @@ SARA_R5_error_t SARA_R5::getUtimeConfiguration(int32_t *offsetNanoseconds, int32
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1543,8 +2741,8 @@ SARA_R5_error_t SARA_R5::getUtimeConfiguration(int32_t *offsetNanoseconds, int32
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -1560,7 +2758,7 @@ SARA_R5_error_t SARA_R5::autoTimeZone(bool enable)
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1579,7 +2777,7 @@ int8_t SARA_R5::rssi(void)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1588,8 +2786,8 @@ int8_t SARA_R5::rssi(void)
                                 minimumResponseAllocation, AT_COMMAND);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return -1;
   }
 
@@ -1605,10 +2803,15 @@ int8_t SARA_R5::rssi(void)
   {
     rssi = -1;
   }
-
-  free(command);
-  free(response);
-  return rssi;
+  else
+  {
+    _networkState.rssi = rssi;
+    _networkState.rssiMillis = millis();
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+  return rssi;
 }
 
 SARA_R5_error_t SARA_R5::getExtSignalQuality(signal_quality& signal_quality)
@@ -1628,7 +2831,7 @@ SARA_R5_error_t SARA_R5::getExtSignalQuality(signal_quality& signal_quality)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1637,8 +2840,8 @@ SARA_R5_error_t SARA_R5::getExtSignalQuality(signal_quality& signal_quality)
                                 minimumResponseAllocation, AT_COMMAND);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return SARA_R5_ERROR_ERROR;
   }
 
@@ -1657,10 +2860,12 @@ SARA_R5_error_t SARA_R5::getExtSignalQuality(signal_quality& signal_quality)
   if (scanned == 6)
   {
     err = SARA_R5_ERROR_SUCCESS;
+    _networkState.signal = signal_quality;
+    _networkState.signalMillis = millis();
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -1679,7 +2884,7 @@ SARA_R5_registration_status_t SARA_R5::registration(bool eps)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_REGISTRATION_INVALID;
   }
 
@@ -1688,8 +2893,8 @@ SARA_R5_registration_status_t SARA_R5::registration(bool eps)
                                 minimumResponseAllocation, AT_COMMAND);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return SARA_R5_REGISTRATION_INVALID;
   }
 
@@ -1701,15 +2906,153 @@ SARA_R5_registration_status_t SARA_R5::registration(bool eps)
     searchPtr += eps ? strlen(SARA_R5_EPSREGISTRATION_STATUS_URC) : strlen(SARA_R5_REGISTRATION_STATUS_URC); //  Move searchPtr to first char
     while (*searchPtr == ' ') searchPtr++; // skip spaces
 	  scanned = sscanf(searchPtr, "%*d,%d", &status);
+
+    bool queryResponse;
+    SARA_R5_registration_status_t stat;
+    unsigned int area;
+    unsigned long ci;
+    int act;
+    parseRegistrationStatus(searchPtr, eps, &queryResponse, &stat, &area, &ci, &act); // Update the network state
   }
   if (scanned != 1)
     status = SARA_R5_REGISTRATION_INVALID;
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return (SARA_R5_registration_status_t)status;
 }
 
+int SARA_R5::parseRegistrationStatus(const char *ptr, bool eps, bool *queryResponse, SARA_R5_registration_status_t *status,
+                                     unsigned int *area, unsigned long *ci, int *act)
+{
+  int n, stat;
+
+  while (*ptr == ' ') ptr++; // skip spaces
+
+  // Query responses start with <n>,<stat>. URCs start with <stat> and the next field (if any) is quoted
+  *queryResponse = (sscanf(ptr, "%d,%d", &n, &stat) == 2);
+  if (*queryResponse)
+  {
+    ptr = strchr(ptr, ',') + 1;
+  }
+
+  stat = SARA_R5_REGISTRATION_INVALID;
+  *area = 0;
+  *ci = 0;
+  *act = -1;
+  int scanNum = sscanf(ptr, "%d,\"%x\",\"%lx\",%d", &stat, area, ci, act);
+  *status = (SARA_R5_registration_status_t)stat;
+  if (scanNum < 1)
+    return 0;
+
+  if (eps)
+  {
+    _networkState.epsStatus = *status;
+    _networkState.tac = *area;
+    _networkState.epsCi = *ci;
+    _networkState.epsAct = *act;
+    _networkState.epsStatusMillis = millis();
+  }
+  else
+  {
+    _networkState.status = *status;
+    _networkState.lac = *area;
+    _networkState.ci = *ci;
+    _networkState.act = *act;
+    _networkState.statusMillis = millis();
+  }
+  return scanNum;
+}
+
+void SARA_R5::resetNetworkState(void)
+{
+  memset(&_networkState, 0, sizeof(_networkState));
+  _networkState.status = SARA_R5_REGISTRATION_INVALID;
+  _networkState.act = -1;
+  _networkState.epsStatus = SARA_R5_REGISTRATION_INVALID;
+  _networkState.epsAct = -1;
+  _networkState.rssi = 99;
+  _networkStateRefreshed = false;
+}
+
+SARA_R5_error_t SARA_R5::setNetworkStateRefresh(unsigned long refreshInterval, bool registrationURCs)
+{
+  SARA_R5_LOCK();
+
+  SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
+
+  _networkStateRefreshInterval = refreshInterval;
+  _networkStateRefreshed = false; // Refresh on the next bufferedPoll
+
+  if (registrationURCs)
+    err = enableRegistrationURCs();
+
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::enableRegistrationURCs(void)
+{
+  SARA_R5_error_t err = enableRegistrationURC(false);
+  if (err == SARA_R5_ERROR_SUCCESS)
+    err = enableRegistrationURC(true);
+
+  // Read the current state. The URCs will keep it up to date
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    registration(false);
+    registration(true);
+  }
+
+  return err;
+}
+
+bool SARA_R5::isRegistered(void)
+{
+  SARA_R5_LOCK();
+
+  return ((_networkState.status == SARA_R5_REGISTRATION_HOME) || (_networkState.status == SARA_R5_REGISTRATION_ROAMING)
+          || (_networkState.epsStatus == SARA_R5_REGISTRATION_HOME) || (_networkState.epsStatus == SARA_R5_REGISTRATION_ROAMING));
+}
+
+void SARA_R5::setSignalHistoryInterval(unsigned long intervalMillis)
+{
+  SARA_R5_LOCK();
+
+  _signalHistoryInterval = intervalMillis;
+  _signalHistorySampled = false; // Sample on the next bufferedPoll
+}
+
+void SARA_R5::clearSignalHistory(void)
+{
+  SARA_R5_LOCK();
+
+  _signalRSRP.reset();
+  _signalRSRQ.reset();
+  _signalMillisNext = 0;
+}
+
+bool SARA_R5::getSignalSample(uint8_t age, SARA_R5_signal_sample &sample)
+{
+  SARA_R5_LOCK();
+
+  if (age >= _signalRSRP.count())
+    return false;
+
+  sample.rsrp = _signalRSRP.get(age);
+  sample.rsrq = _signalRSRQ.get(age);
+  sample.millis = _signalMillis[(_signalMillisNext + SARA_R5_SIGNAL_HISTORY_SIZE - 1 - age) % SARA_R5_SIGNAL_HISTORY_SIZE];
+  return true;
+}
+
+bool SARA_R5::getSignalStats(SARA_R5_signal_metric_t metric, SARA_R5_signal_stats &stats)
+{
+  SARA_R5_LOCK();
+
+  if (metric == SARA_R5_SIGNAL_RSRQ)
+    return _signalRSRQ.getStats(stats);
+  return _signalRSRP.getStats(stats);
+}
+
 bool SARA_R5::setNetworkProfile(mobile_network_operator_t mno, bool autoReset, bool urcNotification)
 {
   mobile_network_operator_t currentMno;
@@ -1774,7 +3117,7 @@ SARA_R5_error_t SARA_R5::setAPN(String apn, uint8_t cid, SARA_R5_pdp_type pdpTyp
   switch (pdpType)
   {
   case PDP_TYPE_INVALID:
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_UNEXPECTED_PARAM;
     break;
   case PDP_TYPE_IP:
@@ -1790,20 +3133,20 @@ SARA_R5_error_t SARA_R5::setAPN(String apn, uint8_t cid, SARA_R5_pdp_type pdpTyp
     memcpy(pdpStr, "IPV6", 4);
     break;
   default:
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_UNEXPECTED_PARAM;
     break;
   }
   if (apn == nullptr)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
       _debugPort->println(F("setAPN: nullptr"));
     sprintf(command, "%s=%d,\"%s\",\"\"", SARA_R5_MESSAGE_PDP_DEF,
             cid, pdpStr);
   }
   else
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       _debugPort->print(F("setAPN: "));
       _debugPort->println(apn);
@@ -1815,7 +3158,7 @@ SARA_R5_error_t SARA_R5::setAPN(String apn, uint8_t cid, SARA_R5_pdp_type pdpTyp
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
 
   return err;
 }
@@ -1838,7 +3181,7 @@ SARA_R5_error_t SARA_R5::getAPN(int cid, String *apn, IPAddress *ip, SARA_R5_pdp
   response = sara_r5_calloc_char(1024);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -1899,8 +3242,8 @@ SARA_R5_error_t SARA_R5::getAPN(int cid, String *apn, IPAddress *ip, SARA_R5_pdp
     err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -1917,7 +3260,7 @@ SARA_R5_error_t SARA_R5::getSimStatus(String* code)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
@@ -1942,8 +3285,8 @@ SARA_R5_error_t SARA_R5::getSimStatus(String* code)
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -1958,7 +3301,7 @@ SARA_R5_error_t SARA_R5::setSimPin(String pin)
   sprintf(command, "%s=\"%s\"", SARA_R5_COMMAND_SIMPIN, pin.c_str());
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1974,7 +3317,7 @@ SARA_R5_error_t SARA_R5::setSIMstateReportingMode(int mode)
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -1994,7 +3337,7 @@ SARA_R5_error_t SARA_R5::getSIMstateReportingMode(int *mode)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -2019,8 +3362,8 @@ SARA_R5_error_t SARA_R5::getSIMstateReportingMode(int *mode)
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -2061,91 +3404,241 @@ SARA_R5_error_t SARA_R5::enterPPP(uint8_t cid, char dialing_type_char,
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_CONNECT, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
+// Used by getOperators to collect the results of the operator scan
+struct SARA_R5_get_operators_context
+{
+  struct operator_stats *opRet;
+  int maxOps;
+  uint8_t opsSeen;
+};
+
 uint8_t SARA_R5::getOperators(struct operator_stats *opRet, int maxOps)
 {
-  SARA_R5_error_t err;
+  SARA_R5_LOCK(); // The RX task must not read the scan response at the same time
+
+  SARA_R5_get_operators_context context;
+  context.opRet = opRet;
+  context.maxOps = maxOps;
+  context.opsSeen = 0;
+
+  // The operators are parsed as they arrive, so the number of operators is not limited by a response buffer
+  if (startOperatorScan(getOperatorsCallback, &context) != SARA_R5_ERROR_SUCCESS)
+    return 0;
+
+  while (_operatorScanActive)
+  {
+    processOperatorScan();
+    yield();
+  }
+
+  return context.opsSeen;
+}
+
+void SARA_R5::getOperatorsCallback(const SARA_R5_operator *oper, uint8_t count, SARA_R5_error_t result, void *context)
+{
+  (void)count;
+  (void)result;
+  SARA_R5_get_operators_context *ctx = (SARA_R5_get_operators_context *)context;
+  if ((oper == nullptr) || (ctx->opsSeen >= ctx->maxOps))
+    return;
+
+  struct operator_stats *op = &ctx->opRet[ctx->opsSeen++];
+  op->stat = oper->stat;
+  op->longOp = (String)(oper->longOp);
+  op->shortOp = (String)(oper->shortOp);
+  op->numOp = oper->numOp;
+  op->act = oper->act;
+}
+
+SARA_R5_error_t SARA_R5::startOperatorScan(void (*operatorCallback)(const SARA_R5_operator *oper, uint8_t count, SARA_R5_error_t result, void *context),
+                                           void *context)
+{
+  SARA_R5_LOCK();
+
   char *command;
-  char *response;
-  uint8_t opsSeen = 0;
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY;
 
   command = sara_r5_calloc_char(strlen(SARA_R5_OPERATOR_SELECTION) + 3);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   sprintf(command, "%s=?", SARA_R5_OPERATOR_SELECTION);
 
-  int responseSize = (maxOps + 1) * 48;
-  response = sara_r5_calloc_char(responseSize);
-  if (response == nullptr)
-  {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  }
+  sendCommand(command, true); // Any pending URCs are copied into the backlog
+  sara_r5_free(command);
+
+  _operatorScanCallback = operatorCallback;
+  _operatorScanCallbackContext = context;
+  _operatorScanActive = true;
+  _operatorScanCancelled = false;
+  _operatorScanInList = false;
+  _operatorScanInTuple = false;
+  _operatorScanInQuotes = false;
+  _operatorScanLineLength = 0;
+  _operatorScanCount = 0;
+  _operatorScanStart = millis();
+  _operatorScanTimeout = SARA_R5_3_MIN_TIMEOUT; // AT+COPS maximum response time is 3 minutes (180000 ms)
 
-  // AT+COPS maximum response time is 3 minutes (180000 ms)
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
-                                SARA_R5_3_MIN_TIMEOUT, responseSize);
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+SARA_R5_error_t SARA_R5::cancelOperatorScan(void)
+{
+  SARA_R5_LOCK(); // The RX task must not read the scan response at the same time
 
-  // Sample responses:
-  // +COPS: (3,"Verizon Wireless","VzW","311480",8),,(0,1,2,3,4),(0,1,2)
-  // +COPS: (1,"313 100","313 100","313100",8),(2,"AT&T","AT&T","310410",8),(3,"311 480","311 480","311480",8),,(0,1,2,3,4),(0,1,2)
+  if (!_operatorScanActive)
+    return SARA_R5_ERROR_INVALID;
+
+  if (SARA_R5_LOG_ERROR_ENABLED)
+    _debugPort->println(F("cancelOperatorScan: aborting +COPS=?"));
 
-  if (_printDebug == true)
+  // +COPS=? is aborted by any character. Wait for the final result code
+  _operatorScanCancelled = true;
+  hwPrint("\r");
+  _operatorScanStart = millis();
+  _operatorScanTimeout = SARA_R5_STANDARD_RESPONSE_TIMEOUT;
+
+  while (_operatorScanActive)
   {
-    _debugPort->print(F("getOperators: Response: {"));
-    _debugPort->print(response);
-    _debugPort->println(F("}"));
+    processOperatorScan();
+    yield();
   }
 
-  if (err == SARA_R5_ERROR_SUCCESS)
-  {
-    char *opBegin;
-    char *opEnd;
-    int op = 0;
-    int stat;
-    char longOp[26];
-    char shortOp[11];
-    int act;
-    unsigned long numOp;
+  return SARA_R5_ERROR_SUCCESS;
+}
 
-    opBegin = response;
+// Sample responses:
+// +COPS: (3,"Verizon Wireless","VzW","311480",8),,(0,1,2,3,4),(0,1,2)
+// +COPS: (1,"313 100","313 100","313100",8),(2,"AT&T","AT&T","310410",8),(3,"311 480","311 480","311480",8),,(0,1,2,3,4),(0,1,2)
+void SARA_R5::processOperatorScan(void)
+{
+  while ((_operatorScanActive) && (hwAvailable() > 0))
+  {
+    char c = readChar();
 
-    for (; op < maxOps; op++)
+    if (_operatorScanInList) // In the +COPS: line
     {
-      opBegin = strchr(opBegin, '(');
-      if (opBegin == nullptr)
-        break;
-      opEnd = strchr(opBegin, ')');
-      if (opEnd == nullptr)
-        break;
-
-      int sscanRead = sscanf(opBegin, "(%d,\"%[^\"]\",\"%[^\"]\",\"%lu\",%d)%*s",
-                             &stat, longOp, shortOp, &numOp, &act);
-      if (sscanRead == 5)
+      if ((c == '\r') || (c == '\n'))
+      {
+        _operatorScanInList = false;
+        _operatorScanLineLength = 0;
+      }
+      else if (!_operatorScanInTuple)
+      {
+        if (c == '(')
+        {
+          _operatorScanInTuple = true;
+          _operatorScanInQuotes = false;
+          _operatorScanLineLength = 0;
+        }
+      }
+      else if ((c == ')') && (!_operatorScanInQuotes))
       {
-        opRet[op].stat = stat;
-        opRet[op].longOp = (String)(longOp);
-        opRet[op].shortOp = (String)(shortOp);
-        opRet[op].numOp = numOp;
-        opRet[op].act = act;
-        opsSeen += 1;
+        _operatorScanInTuple = false;
+        _operatorScanLine[_operatorScanLineLength] = '\0';
+        processOperatorTuple();
       }
-      // TODO: Search for other possible patterns here
       else
       {
-        break; // Break out if pattern doesn't match.
+        if (c == '\"')
+          _operatorScanInQuotes = !_operatorScanInQuotes;
+        if (_operatorScanLineLength < (SARA_R5_OPERATOR_SCAN_LINE_LENGTH - 1))
+          _operatorScanLine[_operatorScanLineLength++] = c;
+      }
+      continue;
+    }
+
+    if ((c == '\r') || (c == '\n'))
+    {
+      if (_operatorScanLineLength > 0)
+      {
+        _operatorScanLine[_operatorScanLineLength] = '\0';
+        _operatorScanLineLength = 0;
+        processOperatorScanLine();
       }
-      opBegin = opEnd + 1; // Move opBegin to beginning of next value
+      continue;
+    }
+
+    if (_operatorScanLineLength < (SARA_R5_OPERATOR_SCAN_LINE_LENGTH - 1))
+      _operatorScanLine[_operatorScanLineLength++] = c;
+
+    if ((_operatorScanLineLength == strlen(SARA_R5_OPERATOR_SELECTION) + 1)
+        && (strncmp(_operatorScanLine, SARA_R5_OPERATOR_SELECTION, strlen(SARA_R5_OPERATOR_SELECTION)) == 0)
+        && (_operatorScanLine[_operatorScanLineLength - 1] == ':'))
+    {
+      _operatorScanInList = true; // "+COPS:" - the operators follow
+      _operatorScanInTuple = false;
+      _operatorScanLineLength = 0;
     }
   }
 
-  free(command);
-  free(response);
+  if ((_operatorScanActive) && ((millis() - _operatorScanStart) >= _operatorScanTimeout))
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("processOperatorScan: timeout"));
+    completeOperatorScan(SARA_R5_ERROR_TIMEOUT);
+  }
+}
+
+// A complete line which is not the +COPS: line: the final result code, the echo or a URC
+void SARA_R5::processOperatorScanLine(void)
+{
+  if (strcmp(_operatorScanLine, "OK") == 0)
+    completeOperatorScan(SARA_R5_ERROR_SUCCESS);
+  else if ((strstr(_operatorScanLine, "ERROR") != nullptr) || (strcmp(_operatorScanLine, "ABORTED") == 0))
+    completeOperatorScan(SARA_R5_ERROR_ERROR);
+  else if (strncmp(_operatorScanLine, "AT", 2) != 0) // Ignore the echo
+    appendToBacklog(_operatorScanLine, strlen(_operatorScanLine)); // A URC. Its handler may need to send commands, so bufferedPoll processes it after the scan
+}
+
+// _operatorScanLine holds the text between ( and )
+void SARA_R5::processOperatorTuple(void)
+{
+  char *fields[5];
+  SARA_R5_operator oper;
+
+  // The supported modes and formats follow the operators, but they are not quoted
+  if (strchr(_operatorScanLine, '\"') == nullptr)
+    return;
+
+  int numFields = splitFields(_operatorScanLine, fields, 5);
+  if (numFields < 4)
+    return;
+
+  memset(&oper, 0, sizeof(oper));
+  oper.stat = (uint8_t)atoi(fields[0]);
+  strncpy(oper.longOp, fields[1], sizeof(oper.longOp) - 1);
+  strncpy(oper.shortOp, fields[2], sizeof(oper.shortOp) - 1);
+  oper.numOp = strtoul(fields[3], nullptr, 10);
+  oper.mncDigits = (strlen(fields[3]) > 5) ? 3 : 2;
+  if (numFields == 5)
+    oper.act = (uint8_t)atoi(fields[4]);
+
+  _operatorScanCount++;
+
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+  {
+    _debugPort->print(F("processOperatorTuple: "));
+    _debugPort->print(oper.longOp);
+    _debugPort->print(F(" "));
+    _debugPort->println(oper.numOp);
+  }
+
+  if ((_operatorScanCallback != nullptr) && (!_operatorScanCancelled))
+    _operatorScanCallback(&oper, _operatorScanCount, SARA_R5_ERROR_SUCCESS, _operatorScanCallbackContext);
+}
+
+void SARA_R5::completeOperatorScan(SARA_R5_error_t result)
+{
+  _operatorScanActive = false; // Clear this first - the callback could start a new scan
 
-  return opsSeen;
+  if ((_operatorScanCallback != nullptr) && (!_operatorScanCancelled))
+    _operatorScanCallback(nullptr, _operatorScanCount, result, _operatorScanCallbackContext);
 }
 
 SARA_R5_error_t SARA_R5::registerOperator(struct operator_stats oper)
@@ -2162,7 +3655,7 @@ SARA_R5_error_t SARA_R5::registerOperator(struct operator_stats oper)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_3_MIN_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -2180,7 +3673,7 @@ SARA_R5_error_t SARA_R5::automaticOperatorSelection()
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_3_MIN_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -2200,7 +3693,7 @@ SARA_R5_error_t SARA_R5::getOperator(String *oper)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -2236,7 +3729,7 @@ SARA_R5_error_t SARA_R5::getOperator(String *oper)
             oper->concat(*(searchPtr));
           }
         }
-        if (_printDebug == true)
+        if (SARA_R5_LOG_DEBUG_ENABLED)
         {
           _debugPort->print(F("getOperator: "));
           _debugPort->println(*oper);
@@ -2245,8 +3738,8 @@ SARA_R5_error_t SARA_R5::getOperator(String *oper)
     }
   }
 
-  free(response);
-  free(command);
+  sara_r5_free(response);
+  sara_r5_free(command);
   return err;
 }
 
@@ -2263,7 +3756,7 @@ SARA_R5_error_t SARA_R5::deregisterOperator(void)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_3_MIN_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -2280,13 +3773,20 @@ SARA_R5_error_t SARA_R5::setSMSMessageFormat(SARA_R5_message_format_t textMode)
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  if (err == SARA_R5_ERROR_SUCCESS)
+    _smsMessageFormat = textMode;
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
 SARA_R5_error_t SARA_R5::sendSMS(String number, String message)
 {
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
   char *command;
   char *messageCStr;
   char *numberCStr;
@@ -2304,8 +3804,8 @@ SARA_R5_error_t SARA_R5::sendSMS(String number, String message)
 
     err = sendCommandWithResponse(command, ">", nullptr,
                                   SARA_R5_3_MIN_TIMEOUT);
-    free(command);
-    free(numberCStr);
+    sara_r5_free(command);
+    sara_r5_free(numberCStr);
     if (err != SARA_R5_ERROR_SUCCESS)
       return err;
 
@@ -2321,17 +3821,76 @@ SARA_R5_error_t SARA_R5::sendSMS(String number, String message)
     err = sendCommandWithResponse(messageCStr, SARA_R5_RESPONSE_OK_OR_ERROR,
                                   nullptr, SARA_R5_3_MIN_TIMEOUT, minimumResponseAllocation, NOT_AT_COMMAND);
 
-    free(messageCStr);
+    sara_r5_free(messageCStr);
   }
   else
   {
-    free(numberCStr);
+    sara_r5_free(numberCStr);
     err = SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
   return err;
 }
 
+SARA_R5_error_t SARA_R5::sendSMSPDU(const char *destination, const uint8_t *data, size_t length,
+                                    SARA_R5_sms_encoding_t encoding, bool statusReport)
+{
+  char *command;
+  char *pduHex;
+  SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
+
+  uint8_t numSegments = SARA_R5_SMS_PDU::segmentsNeeded(data, length, encoding);
+  if (numSegments == 0)
+    return SARA_R5_ERROR_INVALID;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_SEND_TEXT) + 8);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  pduHex = sara_r5_calloc_char(SARA_R5_SMS_MAX_PDU_HEX_LENGTH + 1); // + CTRL+Z
+  if (pduHex == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  bool restoreTextMode = (_smsMessageFormat == SARA_R5_MESSAGE_FORMAT_TEXT);
+  if (restoreTextMode)
+    err = setSMSMessageFormat(SARA_R5_MESSAGE_FORMAT_PDU);
+
+  _smsConcatReference++;
+
+  for (uint8_t segment = 1; (segment <= numSegments) && (err == SARA_R5_ERROR_SUCCESS); segment++)
+  {
+    int tpduLength = SARA_R5_SMS_PDU::encodeSubmit(pduHex, SARA_R5_SMS_MAX_PDU_HEX_LENGTH, destination, data, length,
+                                                   encoding, segment, _smsConcatReference, statusReport);
+    if (tpduLength < 0)
+    {
+      err = SARA_R5_ERROR_INVALID;
+      break;
+    }
+
+    sprintf(command, "%s=%d", SARA_R5_SEND_TEXT, tpduLength);
+    err = sendCommandWithResponse(command, ">", nullptr,
+                                  SARA_R5_3_MIN_TIMEOUT);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      break;
+
+    size_t hexLength = strlen(pduHex);
+    pduHex[hexLength] = ASCII_CTRL_Z;
+    pduHex[hexLength + 1] = '\0';
+
+    err = sendCommandWithResponse(pduHex, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                  nullptr, SARA_R5_3_MIN_TIMEOUT, minimumResponseAllocation, NOT_AT_COMMAND);
+  }
+
+  if (restoreTextMode)
+    setSMSMessageFormat(SARA_R5_MESSAGE_FORMAT_TEXT);
+
+  sara_r5_free(command);
+  sara_r5_free(pduHex);
+  return err;
+}
+
 SARA_R5_error_t SARA_R5::getPreferredMessageStorage(int *used, int *total, String memory)
 {
   SARA_R5_error_t err;
@@ -2348,7 +3907,7 @@ SARA_R5_error_t SARA_R5::getPreferredMessageStorage(int *used, int *total, Strin
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -2357,8 +3916,8 @@ SARA_R5_error_t SARA_R5::getPreferredMessageStorage(int *used, int *total, Strin
 
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
@@ -2372,7 +3931,7 @@ SARA_R5_error_t SARA_R5::getPreferredMessageStorage(int *used, int *total, Strin
   }
   if (scanned == 2)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       _debugPort->print(F("getPreferredMessageStorage: memory1 (read and delete): "));
       _debugPort->print(memory);
@@ -2389,8 +3948,8 @@ SARA_R5_error_t SARA_R5::getPreferredMessageStorage(int *used, int *total, Strin
     err = SARA_R5_ERROR_INVALID;
   }
 
-  free(response);
-  free(command);
+  sara_r5_free(response);
+  sara_r5_free(command);
   return err;
 }
 
@@ -2408,7 +3967,7 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
   response = sara_r5_calloc_char(1024);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -2433,8 +3992,8 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
       }
       if ((*searchPtr == '\0') || (pointer == 12))
       {
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
       // Search to the next quote
@@ -2447,8 +4006,8 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
       }
       if ((*searchPtr == '\0') || (pointer == 24))
       {
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
       // Skip two commas
@@ -2464,8 +4023,8 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
       }
       if ((*searchPtr == '\0') || (pointer == 24))
       {
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
       // Search to the next new line
@@ -2478,8 +4037,8 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
       }
       if ((*searchPtr == '\0') || (pointer == 512))
       {
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
     }
@@ -2493,633 +4052,994 @@ SARA_R5_error_t SARA_R5::readSMSmessage(int location, String *unread, String *fr
     err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
 
-SARA_R5_error_t SARA_R5::deleteSMSmessage(int location, int deleteFlag)
+SARA_R5_error_t SARA_R5::setNewSMSIndication(SARA_R5_new_sms_indication_t indication)
 {
-  char *command;
   SARA_R5_error_t err;
+  char *command;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_DELETE_MESSAGE) + 12);
+  command = sara_r5_calloc_char(strlen(SARA_R5_NEW_MESSAGE_IND) + 8);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  if (deleteFlag == 0)
-    sprintf(command, "%s=%d", SARA_R5_DELETE_MESSAGE, location);
-  else
-    sprintf(command, "%s=%d,%d", SARA_R5_DELETE_MESSAGE, location, deleteFlag);
+  sprintf(command, "%s=2,%d", SARA_R5_NEW_MESSAGE_IND, (int)indication); // <mode> 2: buffer the indications while the UART is busy
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_55_SECS_TIMEOUT);
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
-SARA_R5_error_t SARA_R5::setBaud(unsigned long baud)
+int SARA_R5::splitFields(char *str, char **fields, int maxFields)
 {
-  SARA_R5_error_t err;
-  char *command;
-  int b = 0;
+  int numFields = 0;
+  char *ptr = str;
 
-  // Error check -- ensure supported baud
-  for (; b < NUM_SUPPORTED_BAUD; b++)
+  while (*ptr == ' ') ptr++; // skip spaces
+  while ((*ptr != '\0') && (numFields < maxFields))
   {
-    if (SARA_R5_SUPPORTED_BAUD[b] == baud)
+    if (*ptr == '\"')
     {
-      break;
+      fields[numFields++] = ++ptr;
+      while ((*ptr != '\"') && (*ptr != '\0')) ptr++;
+      if (*ptr == '\"')
+        *ptr++ = '\0';
+      while ((*ptr != ',') && (*ptr != '\0')) ptr++;
     }
+    else
+    {
+      fields[numFields++] = ptr;
+      while ((*ptr != ',') && (*ptr != '\0')) ptr++;
+    }
+    if (*ptr == ',')
+      *ptr++ = '\0';
   }
-  if (b >= NUM_SUPPORTED_BAUD)
-  {
-    return SARA_R5_ERROR_UNEXPECTED_PARAM;
-  }
-
-  // Construct command
-  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_BAUD) + 7 + 12);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%lu", SARA_R5_COMMAND_BAUD, baud);
-
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                nullptr, SARA_R5_SET_BAUD_TIMEOUT);
-
-  free(command);
-
-  return err;
+  return numFields;
 }
 
-SARA_R5_error_t SARA_R5::setFlowControl(SARA_R5_flow_control_t value)
+SARA_R5_error_t SARA_R5::listSMS(SARA_R5_sms_status_t filter,
+                                 void (*smsCallback)(int index, SARA_R5_sms_status_t status, const char *from, const char *dateTime,
+                                                     const char *message, size_t length, void *context),
+                                 void *context)
 {
-  SARA_R5_error_t err;
-  char *command;
-
-  command = sara_r5_calloc_char(strlen(SARA_R5_FLOW_CONTROL) + 16);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s%d", SARA_R5_FLOW_CONTROL, value);
-
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-
-  free(command);
+  SARA_R5_LOCK();
 
-  return err;
-}
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
 
-SARA_R5_error_t SARA_R5::setGpioMode(SARA_R5_gpio_t gpio,
-                                     SARA_R5_gpio_mode_t mode, int value)
-{
-  SARA_R5_error_t err;
+  SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
   char *command;
+  char *header;
+  char *message;
+  size_t messageLength = 0;
+  const size_t maxMessageLength = SARA_R5_SMS_LIST_MESSAGE_LENGTH - SARA_R5_SMS_LIST_HEADER_LENGTH - 1; // Always leave room to read the next header
+  bool haveHeader = false;
+  bool finished = false;
+  const char *statusNames[] = {"REC UNREAD", "REC READ", "STO UNSENT", "STO SENT", "ALL"};
+
+  if ((filter < SARA_R5_SMS_STATUS_REC_UNREAD) || (filter > SARA_R5_SMS_STATUS_ALL))
+    return SARA_R5_ERROR_INVALID;
 
-  // Example command: AT+UGPIOC=16,2
-  // Example command: AT+UGPIOC=23,0,1
-  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_GPIO) + 16);
+  command = sara_r5_calloc_char(strlen(SARA_R5_LIST_MESSAGES) + 16);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  if (mode == GPIO_OUTPUT)
-    sprintf(command, "%s=%d,%d,%d", SARA_R5_COMMAND_GPIO, gpio, mode, value);
+  if (_smsMessageFormat == SARA_R5_MESSAGE_FORMAT_TEXT)
+    sprintf(command, "%s=\"%s\"", SARA_R5_LIST_MESSAGES, statusNames[filter]);
   else
-    sprintf(command, "%s=%d,%d", SARA_R5_COMMAND_GPIO, gpio, mode);
+    sprintf(command, "%s=%d", SARA_R5_LIST_MESSAGES, (int)filter);
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                nullptr, SARA_R5_10_SEC_TIMEOUT);
+  header = sara_r5_calloc_char(SARA_R5_SMS_LIST_HEADER_LENGTH);
+  if (header == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+  message = sara_r5_calloc_char(SARA_R5_SMS_LIST_MESSAGE_LENGTH);
+  if (message == nullptr)
+  {
+    sara_r5_free(command);
+    sara_r5_free(header);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
 
-  free(command);
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+  {
+    _debugPort->print(F("listSMS: Command: "));
+    _debugPort->println(String(command));
+  }
 
-  return err;
-}
+  sendCommand(command, true);
 
-SARA_R5::SARA_R5_gpio_mode_t SARA_R5::getGpioMode(SARA_R5_gpio_t gpio)
-{
-  SARA_R5_error_t err;
-  char *command;
-  char *response;
-  char gpioChar[4];
-  char *gpioStart;
-  int gpioMode;
+  // The response is:
+  // +CMGL: <index>,<stat>,<oa/da>,[<alpha>],[<scts>][,<tooa/toda>,<length>]<CR><LF><data><CR><LF>   (text mode - repeated for each message)
+  // +CMGL: <index>,<stat>,[<alpha>],<length><CR><LF><pdu><CR><LF>                                  (PDU mode)
+  // OK
+  // Each line is read into message, directly after the message text received so far.
+  // The line after a header is always the start of the body - even if it reads "OK" or "+CMGL:".
+  // If the header contains <length>, lines are added to the body until that many characters have been read.
+  // Only then are headers and final result codes accepted. Other lines are URCs and go to the backlog.
+  // Without <length> (text mode, +CSDH=0) a message may continue over several lines: any line which
+  // does not look like a header, result code or URC is added to the body.
+  int index = 0;
+  int status = SARA_R5_SMS_STATUS_ALL;
+  const char *from = "";
+  const char *dateTime = "";
+  bool bodyPending = false;
+  long bodyRemaining = -1; // -1: <length> unknown
+  bool textMode = (_smsMessageFormat == SARA_R5_MESSAGE_FORMAT_TEXT);
+
+  while (!finished)
+  {
+    size_t offset = (messageLength > 0) ? messageLength + 1 : 0; // Leave room for a '\n' between data lines
+    size_t lineLength;
+    char *line = &message[offset];
+
+    err = readResponseLine(line, SARA_R5_SMS_LIST_MESSAGE_LENGTH - offset, &lineLength, SARA_R5_10_SEC_TIMEOUT);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      break;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_GPIO) + 2);
-  if (command == nullptr)
-    return GPIO_MODE_INVALID;
-  sprintf(command, "%s?", SARA_R5_COMMAND_GPIO);
+    bool isHeader = (strncmp(line, "+CMGL:", 6) == 0);
+    bool isOK = (strcmp(line, "OK") == 0);
+    bool isError = ((strcmp(line, "ERROR") == 0) || (strncmp(line, "+CMS ERROR", 10) == 0) || (strncmp(line, "+CME ERROR", 10) == 0));
+    bool isURC = ((line[0] == '+') && (strchr(line, ':') != nullptr));
+    bool isBody = bodyPending ||
+                  (haveHeader && (bodyRemaining < 0) && (lineLength > 0) && (!isHeader) && (!isOK) && (!isError) && (!isURC));
 
-  response = sara_r5_calloc_char(minimumResponseAllocation);
-  if (response == nullptr)
-  {
-    free(command);
-    return GPIO_MODE_INVALID;
-  }
+    if (isBody)
+    {
+      if (bodyRemaining >= 0)
+      {
+        if (offset > 0)
+          bodyRemaining -= 2; // The <CR><LF> between the lines is part of the message
+        bodyRemaining -= lineLength;
+        if ((lineLength + 1) >= (SARA_R5_SMS_LIST_MESSAGE_LENGTH - offset))
+          bodyRemaining = 0; // The line was truncated. Its true length is unknown
+      }
+      bodyPending = (bodyRemaining > 0);
+      if ((offset > 0) || (lineLength > 0))
+      {
+        if (offset > 0)
+          message[messageLength] = '\n';
+        messageLength = offset + lineLength;
+        if (messageLength > maxMessageLength)
+          messageLength = maxMessageLength;
+      }
+      continue;
+    }
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+    if ((!isHeader) && (!isOK) && (!isError))
+    {
+      if (lineLength > 0)
+      {
+        // Not part of the +CMGL response. Could be a URC. Add it to the backlog for bufferedPoll
+        appendToBacklog(line, lineLength);
+      }
+      continue;
+    }
 
-  if (err != SARA_R5_ERROR_SUCCESS)
-  {
-    free(command);
-    free(response);
-    return GPIO_MODE_INVALID;
-  }
+    if (haveHeader) // The previous message is complete
+    {
+      // Trim any trailing empty lines
+      while ((messageLength > 0) && (message[messageLength - 1] == '\n'))
+        messageLength--;
+      message[messageLength] = '\0';
 
-  sprintf(gpioChar, "%d", gpio);          // Convert GPIO to char array
-  gpioStart = strstr(response, gpioChar); // Find first occurence of GPIO in response
+      if (smsCallback != nullptr)
+        smsCallback(index, (SARA_R5_sms_status_t)status, from, dateTime,
+                    (messageLength > 0) ? message : "", messageLength, context);
+    }
 
-  free(command);
-  free(response);
+    haveHeader = false;
+    messageLength = 0;
+    if (isHeader)
+    {
+      strncpy(header, line, SARA_R5_SMS_LIST_HEADER_LENGTH - 1);
+      header[SARA_R5_SMS_LIST_HEADER_LENGTH - 1] = '\0';
 
-  if (gpioStart == nullptr)
-    return GPIO_MODE_INVALID; // If not found return invalid
-  sscanf(gpioStart, "%*d,%d\r\n", &gpioMode);
+      char *fields[7] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+      int numFields = splitFields(header + 6, fields, 7); // Skip "+CMGL:"
 
-  return (SARA_R5_gpio_mode_t)gpioMode;
+      if (numFields >= 2)
+      {
+        haveHeader = true;
+        index = atoi(fields[0]);
+        status = SARA_R5_SMS_STATUS_ALL;
+        if ((*fields[1] >= '0') && (*fields[1] <= '9')) // PDU mode
+        {
+          status = atoi(fields[1]);
+        }
+        else
+        {
+          for (int i = SARA_R5_SMS_STATUS_REC_UNREAD; i < SARA_R5_SMS_STATUS_ALL; i++)
+          {
+            if (strcmp(fields[1], statusNames[i]) == 0)
+              status = i;
+          }
+        }
+        from = (textMode && (fields[2] != nullptr)) ? fields[2] : "";
+        dateTime = (textMode && (fields[4] != nullptr)) ? fields[4] : "";
+
+        bodyRemaining = -1;
+        if ((!textMode) && (numFields >= 3)) // PDU mode: <length> (TPDU octets) is the last field. The hex PDU also includes the SMSC
+          bodyRemaining = atol(fields[numFields - 1]) * 2;
+        else if (textMode && (numFields >= 7)) // +CSDH=1
+          bodyRemaining = atol(fields[6]);
+        bodyPending = true; // The first body line is always read
+      }
+      else
+      {
+        if (SARA_R5_LOG_ERROR_ENABLED)
+          _debugPort->println(F("listSMS: could not parse header"));
+        bodyPending = true; // Skip its body
+        bodyRemaining = -1;
+      }
+    }
+    else
+    {
+      if (isError)
+        err = SARA_R5_ERROR_ERROR;
+      finished = true;
+    }
+  }
+
+  pruneBacklog(); // Keep only the URCs
+
+  sara_r5_free(command);
+  sara_r5_free(header);
+  sara_r5_free(message);
+  return err;
 }
 
-int SARA_R5::socketOpen(SARA_R5_socket_protocol_t protocol, unsigned int localPort)
+SARA_R5_error_t SARA_R5::readSMSmessagePDU(int location, char *pduHex, size_t pduHexSize, int *status)
 {
   SARA_R5_error_t err;
   char *command;
   char *response;
-  int sockId = -1;
-  char *responseStart;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_CREATE_SOCKET) + 10);
+  if ((pduHex == nullptr) || (pduHexSize == 0))
+    return SARA_R5_ERROR_INVALID;
+  pduHex[0] = '\0';
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_READ_TEXT_MESSAGE) + 8);
   if (command == nullptr)
-    return -1;
-  if (localPort == 0)
-    sprintf(command, "%s=%d", SARA_R5_CREATE_SOCKET, (int)protocol);
-  else
-    sprintf(command, "%s=%d,%d", SARA_R5_CREATE_SOCKET, (int)protocol, localPort);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d", SARA_R5_READ_TEXT_MESSAGE, location);
 
-  response = sara_r5_calloc_char(minimumResponseAllocation);
+  response = sara_r5_calloc_char(1024);
   if (response == nullptr)
   {
-    if (_printDebug == true)
-      _debugPort->println(F("socketOpen: Fail: nullptr response"));
-    free(command);
-    return -1;
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
-                                response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
+                                SARA_R5_10_SEC_TIMEOUT, 1024);
 
-  if (err != SARA_R5_ERROR_SUCCESS)
+  if (err == SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    // Response is: +CMGR: <stat>,[<alpha>],<length><CR><LF><pdu>
+    char *searchPtr = strstr(response, "+CMGR:");
+    if (searchPtr != nullptr)
     {
-      _debugPort->print(F("socketOpen: Fail: Error: "));
-      _debugPort->print(err);
-      _debugPort->print(F("  Response: {"));
-      _debugPort->print(response);
-      _debugPort->println(F("}"));
+      searchPtr += strlen("+CMGR:"); //  Move searchPtr to first char
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      if (status != nullptr)
+        *status = atoi(searchPtr);
+      searchPtr = strchr(searchPtr, '\n');
     }
-    free(command);
-    free(response);
-    return -1;
-  }
-
-  responseStart = strstr(response, "+USOCR:");
-  if (responseStart == nullptr)
-  {
-    if (_printDebug == true)
+    if (searchPtr != nullptr)
     {
-      _debugPort->print(F("socketOpen: Failure: {"));
-      _debugPort->print(response);
-      _debugPort->println(F("}"));
+      size_t i = 0;
+      searchPtr++;
+      while ((*searchPtr != '\r') && (*searchPtr != '\n') && (*searchPtr != '\0') && ((i + 1) < pduHexSize))
+        pduHex[i++] = *searchPtr++;
+      pduHex[i] = '\0';
+      if (i == 0)
+        err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+    }
+    else
+    {
+      err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
-    free(command);
-    free(response);
-    return -1;
   }
 
-  responseStart += strlen("+USOCR:"); //  Move searchPtr to first char
-  while (*responseStart == ' ') responseStart++; // skip spaces
-  sscanf(responseStart, "%d", &sockId);
-  _lastSocketProtocol[sockId] = (int)protocol;
+  sara_r5_free(command);
+  sara_r5_free(response);
+  return err;
+}
 
-  free(command);
-  free(response);
+SARA_R5_error_t SARA_R5::deleteSMSmessage(int location, int deleteFlag)
+{
+  char *command;
+  SARA_R5_error_t err;
 
-  return sockId;
+  command = sara_r5_calloc_char(strlen(SARA_R5_DELETE_MESSAGE) + 12);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  if (deleteFlag == 0)
+    sprintf(command, "%s=%d", SARA_R5_DELETE_MESSAGE, location);
+  else
+    sprintf(command, "%s=%d,%d", SARA_R5_DELETE_MESSAGE, location, deleteFlag);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_55_SECS_TIMEOUT);
+
+  sara_r5_free(command);
+  return err;
 }
 
-SARA_R5_error_t SARA_R5::socketClose(int socket, unsigned long timeout)
+SARA_R5_error_t SARA_R5::setBaud(unsigned long baud)
 {
   SARA_R5_error_t err;
   char *command;
-  char *response;
+  int b = 0;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_CLOSE_SOCKET) + 10);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  response = sara_r5_calloc_char(minimumResponseAllocation);
-  if (response == nullptr)
+  // Error check -- ensure supported baud
+  for (; b < NUM_SUPPORTED_BAUD; b++)
   {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+    if (SARA_R5_SUPPORTED_BAUD[b] == baud)
+    {
+      break;
+    }
   }
-  // if timeout is short, close asynchronously and don't wait for socket closure (we will get the URC later)
-  // this will make sure the AT command parser is not confused during init()
-  const char* format = (SARA_R5_STANDARD_RESPONSE_TIMEOUT == timeout) ? "%s=%d,1" : "%s=%d";
-  sprintf(command, format, SARA_R5_CLOSE_SOCKET, socket);
-
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response, timeout);
-
-  if ((err != SARA_R5_ERROR_SUCCESS) && (_printDebug == true))
+  if (b >= NUM_SUPPORTED_BAUD)
   {
-    _debugPort->print(F("socketClose: Error: "));
-    _debugPort->println(socketGetLastError());
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
   }
 
-  free(command);
-  free(response);
+  // Construct command
+  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_BAUD) + 7 + 12);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%lu", SARA_R5_COMMAND_BAUD, baud);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                nullptr, SARA_R5_SET_BAUD_TIMEOUT);
+
+  sara_r5_free(command);
 
   return err;
 }
 
-SARA_R5_error_t SARA_R5::socketConnect(int socket, const char *address,
-                                       unsigned int port)
+SARA_R5_error_t SARA_R5::setFlowControl(SARA_R5_flow_control_t value)
 {
   SARA_R5_error_t err;
   char *command;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_CONNECT_SOCKET) + strlen(address) + 11);
+  command = sara_r5_calloc_char(strlen(SARA_R5_FLOW_CONTROL) + 16);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d,\"%s\",%d", SARA_R5_CONNECT_SOCKET, socket, address, port);
+  sprintf(command, "%s%d", SARA_R5_FLOW_CONTROL, value);
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_IP_CONNECT_TIMEOUT);
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
 
   return err;
 }
 
-SARA_R5_error_t SARA_R5::socketConnect(int socket, IPAddress address,
-                                       unsigned int port)
+SARA_R5_error_t SARA_R5::setUartPowerSaving(SARA_R5_upsv_mode_t mode, uint16_t timeout, int dtrPin)
 {
-  char *charAddress = sara_r5_calloc_char(16);
-  if (charAddress == nullptr)
+  SARA_R5_LOCK();
+
+  SARA_R5_error_t err;
+  char *command;
+
+  if ((mode == SARA_R5_UPSV_DTR) && (dtrPin < 0))
+    return SARA_R5_ERROR_INVALID;
+
+  if (dtrPin >= 0)
+  {
+    _dtrPin = dtrPin;
+    pinMode(_dtrPin, OUTPUT);
+    digitalWrite(_dtrPin, LOW); // ON - keep the module awake while the mode is changed
+    _dtrAsserted = true;
+  }
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_UART_POWER_SAVING) + 16);
+  if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  memset(charAddress, 0, 16);
-  sprintf(charAddress, "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+  if (mode == SARA_R5_UPSV_TIMEOUT)
+    sprintf(command, "%s=%d,%u", SARA_R5_UART_POWER_SAVING, mode, timeout);
+  else
+    sprintf(command, "%s=%d", SARA_R5_UART_POWER_SAVING, mode);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  sara_r5_free(command);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    _upsvMode = mode;
+    _upsvSleepMillis = ((unsigned long)timeout * SARA_R5_UPSV_FRAME_MICROS) / 1000;
+    if (_upsvSleepMillis > SARA_R5_UPSV_WAKE_MARGIN)
+      _upsvSleepMillis -= SARA_R5_UPSV_WAKE_MARGIN;
+    else
+      _upsvSleepMillis = 0;
+  }
 
-  return (socketConnect(socket, (const char *)charAddress, port));
+  return err;
 }
 
-SARA_R5_error_t SARA_R5::socketWrite(int socket, const char *str, int len)
+SARA_R5_error_t SARA_R5::getUartPowerSaving(SARA_R5_upsv_mode_t *mode, uint16_t *timeout)
 {
+  SARA_R5_error_t err;
   char *command;
   char *response;
-  SARA_R5_error_t err;
+  int m = 0;
+  unsigned int t = 0;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_WRITE_SOCKET) + 16);
+  command = sara_r5_calloc_char(strlen(SARA_R5_UART_POWER_SAVING) + 3);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s?", SARA_R5_UART_POWER_SAVING);
+
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
-  int dataLen = len == -1 ? strlen(str) : len;
-  sprintf(command, "%s=%d,%d", SARA_R5_WRITE_SOCKET, socket, dataLen);
 
-  err = sendCommandWithResponse(command, "@", response,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT * 5);
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
   if (err == SARA_R5_ERROR_SUCCESS)
   {
-    unsigned long writeDelay = millis();
-    while (millis() < (writeDelay + 50))
-      delay(1); //u-blox specification says to wait 50ms after receiving "@" to write data.
-
-    if (len == -1)
+    // Example response: +UPSV: 1,2000
+    char *searchPtr = strstr(response, "+UPSV:");
+    int scanned = 0;
+    if (searchPtr != nullptr)
     {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("socketWrite: writing: "));
-        _debugPort->println(str);
-      }
-      hwPrint(str);
+      searchPtr += strlen("+UPSV:");
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      scanned = sscanf(searchPtr, "%d,%u", &m, &t);
     }
-    else
+    if (scanned >= 1)
     {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("socketWrite: writing "));
-        _debugPort->print(len);
-        _debugPort->println(F(" bytes"));
-      }
-      hwWriteData(str, len);
+      *mode = (SARA_R5_upsv_mode_t)m;
+      if (timeout != nullptr)
+        *timeout = (scanned == 2) ? (uint16_t)t : 0;
     }
-
-    err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_SOCKET_WRITE_TIMEOUT);
+    else
+      err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  if (err != SARA_R5_ERROR_SUCCESS)
-  {
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("socketWrite: Error: "));
-      _debugPort->print(err);
-      _debugPort->print(F(" => {"));
-      _debugPort->print(response);
-      _debugPort->println(F("}"));
-    }
-  }
+  sara_r5_free(command);
+  sara_r5_free(response);
 
-  free(command);
-  free(response);
   return err;
 }
 
-SARA_R5_error_t SARA_R5::socketWrite(int socket, String str)
+SARA_R5_error_t SARA_R5::wakeModule(void)
 {
-  return socketWrite(socket, str.c_str(), str.length());
-}
+  SARA_R5_LOCK();
 
-SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, const char *address, int port, const char *str, int len)
-{
-  char *command;
-  char *response;
-  SARA_R5_error_t err;
-  int dataLen = len == -1 ? strlen(str) : len;
-
-  command = sara_r5_calloc_char(64);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  response = sara_r5_calloc_char(minimumResponseAllocation);
-  if (response == nullptr)
-  {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  }
-
-  sprintf(command, "%s=%d,\"%s\",%d,%d", SARA_R5_WRITE_UDP_SOCKET,
-          socket, address, port, dataLen);
-  err = sendCommandWithResponse(command, "@", response, SARA_R5_STANDARD_RESPONSE_TIMEOUT * 5);
+  if ((_upsvMode == SARA_R5_UPSV_DISABLED) || _upsvWaking)
+    return SARA_R5_ERROR_SUCCESS;
 
-  if (err == SARA_R5_ERROR_SUCCESS)
+  if (_upsvMode == SARA_R5_UPSV_DTR)
   {
-    if (len == -1) //If binary data we need to send a length.
-    {
-      hwPrint(str);
-    }
-    else
+    if (!_dtrAsserted)
     {
-      hwWriteData(str, len);
+      digitalWrite(_dtrPin, LOW); // ON
+      _dtrAsserted = true;
+      _upsvWakes++;
+      delay(_upsvWakeDelay);
     }
-    err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_SOCKET_WRITE_TIMEOUT);
+    _uartActivityMillis = millis(); // Restart the DTR hold time
+    return SARA_R5_ERROR_SUCCESS;
   }
-  else
+
+  if ((millis() - _uartActivityMillis) < _upsvSleepMillis)
+    return SARA_R5_ERROR_SUCCESS; // Still awake. No extra latency
+
+  // The module may be asleep. The first character wakes it but is lost, so send a character the module ignores
+  // and then check with AT. If the AT is not answered, its first character was lost too: try again
+  _upsvWaking = true;
+  _upsvWakes++;
+  hwWrite('\r');
+  delay(_upsvWakeDelay);
+
+  SARA_R5_error_t err = SARA_R5_ERROR_NO_RESPONSE;
+  for (uint8_t retry = 0; (retry < SARA_R5_UPSV_WAKE_RETRIES) && (err != SARA_R5_ERROR_SUCCESS); retry++)
   {
-    if (_printDebug == true)
-      _debugPort->print(F("socketWriteUDP: Error: "));
-    if (_printDebug == true)
-      _debugPort->println(socketGetLastError());
+    err = sendCommandWithResponse("", SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_UPSV_WAKE_TIMEOUT);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      _upsvWakeRetries++;
   }
+  _upsvWaking = false;
+
+  if ((err != SARA_R5_ERROR_SUCCESS) && SARA_R5_LOG_ERROR_ENABLED)
+    _debugPort->println(F("wakeModule: no response"));
 
-  free(command);
-  free(response);
   return err;
 }
 
-SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, IPAddress address, int port, const char *str, int len)
+SARA_R5_error_t SARA_R5::setGpioMode(SARA_R5_gpio_t gpio,
+                                     SARA_R5_gpio_mode_t mode, int value)
 {
-  char *charAddress = sara_r5_calloc_char(16);
-  if (charAddress == nullptr)
+  SARA_R5_error_t err;
+  char *command;
+
+  // Example command: AT+UGPIOC=16,2
+  // Example command: AT+UGPIOC=23,0,1
+  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_GPIO) + 16);
+  if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
-  memset(charAddress, 0, 16);
-  sprintf(charAddress, "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+  if (mode == GPIO_OUTPUT)
+    sprintf(command, "%s=%d,%d,%d", SARA_R5_COMMAND_GPIO, gpio, mode, value);
+  else
+    sprintf(command, "%s=%d,%d", SARA_R5_COMMAND_GPIO, gpio, mode);
 
-  return (socketWriteUDP(socket, (const char *)charAddress, port, str, len));
-}
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                nullptr, SARA_R5_10_SEC_TIMEOUT);
 
-SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, String address, int port, String str)
-{
-  return socketWriteUDP(socket, address.c_str(), port, str.c_str(), str.length());
+  sara_r5_free(command);
+
+  return err;
 }
 
-SARA_R5_error_t SARA_R5::socketRead(int socket, int length, char *readDest, int *bytesRead)
+SARA_R5::SARA_R5_gpio_mode_t SARA_R5::getGpioMode(SARA_R5_gpio_t gpio)
 {
+  SARA_R5_error_t err;
   char *command;
   char *response;
-  char *strBegin;
-  int readIndexTotal = 0;
-  int readIndexThisRead = 0;
-  SARA_R5_error_t err;
-  int scanNum = 0;
-  int readLength = 0;
-  int socketStore = 0;
-  int bytesLeftToRead = length;
-  int bytesToRead;
+  char gpioChar[4];
+  char *gpioStart;
+  int gpioMode;
 
-  // Set *bytesRead to zero
-  if (bytesRead != nullptr)
-    *bytesRead = 0;
+  command = sara_r5_calloc_char(strlen(SARA_R5_COMMAND_GPIO) + 2);
+  if (command == nullptr)
+    return GPIO_MODE_INVALID;
+  sprintf(command, "%s?", SARA_R5_COMMAND_GPIO);
 
-  // Check if length is zero
-  if (length == 0)
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
   {
-    if (_printDebug == true)
-      _debugPort->print(F("socketRead: length is 0! Call socketReadAvailable?"));
-    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+    sara_r5_free(command);
+    return GPIO_MODE_INVALID;
   }
 
-  // Allocate memory for the command
-  command = sara_r5_calloc_char(strlen(SARA_R5_READ_SOCKET) + 32);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  // Allocate memory for the response
-  // We only need enough to read _saraR5maxSocketRead bytes - not the whole thing
-  int responseLength = _saraR5maxSocketRead + strlen(SARA_R5_READ_SOCKET) + minimumResponseAllocation;
-  response = sara_r5_calloc_char(responseLength);
-  if (response == nullptr)
+  if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+    sara_r5_free(command);
+    sara_r5_free(response);
+    return GPIO_MODE_INVALID;
   }
 
-  // If there are more than _saraR5maxSocketRead (1024) bytes to be read,
-  // we need to do multiple reads to get all the data
+  sprintf(gpioChar, "%d", gpio);          // Convert GPIO to char array
+  gpioStart = strstr(response, gpioChar); // Find first occurence of GPIO in response
 
-  while (bytesLeftToRead > 0)
-  {
-    if (bytesLeftToRead > _saraR5maxSocketRead) // Limit a single read to _saraR5maxSocketRead
-      bytesToRead = _saraR5maxSocketRead;
-    else
-      bytesToRead = bytesLeftToRead;
+  sara_r5_free(command);
+  sara_r5_free(response);
 
-    sprintf(command, "%s=%d,%d", SARA_R5_READ_SOCKET, socket, bytesToRead);
+  if (gpioStart == nullptr)
+    return GPIO_MODE_INVALID; // If not found return invalid
+  sscanf(gpioStart, "%*d,%d\r\n", &gpioMode);
 
-    err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
-                                  SARA_R5_STANDARD_RESPONSE_TIMEOUT, responseLength);
+  return (SARA_R5_gpio_mode_t)gpioMode;
+}
 
-    if (err != SARA_R5_ERROR_SUCCESS)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("socketRead: sendCommandWithResponse err "));
-        _debugPort->println(err);
-      }
-      free(command);
-      free(response);
-      return err;
-    }
+SARA_R5 *SARA_R5::_ringInstance = nullptr;
 
-    // Extract the data
-    char *searchPtr = strstr(response, "+USORD:");
-    if (searchPtr != nullptr)
-    {
-      searchPtr += strlen("+USORD:"); //  Move searchPtr to first char
-      while (*searchPtr == ' ') searchPtr++; // skip spaces
-      scanNum = sscanf(searchPtr, "%d,%d",
-                        &socketStore, &readLength);
-    }
-    if (scanNum != 2)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("socketRead: error: scanNum is "));
-        _debugPort->println(scanNum);
-      }
-      free(command);
-      free(response);
-      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
-    }
+void SARA_R5_ISR_ATTR SARA_R5::ringISR(void)
+{
+  if (_ringInstance != nullptr)
+  {
+    _ringInstance->_ringFlag = true;
+    _ringInstance->_ringCount = _ringInstance->_ringCount + 1;
+  }
+}
 
-    // Check that readLength == bytesToRead
-    if (readLength != bytesToRead)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("socketRead: length mismatch! bytesToRead="));
-        _debugPort->print(bytesToRead);
-        _debugPort->print(F(" readLength="));
-        _debugPort->println(readLength);
-      }
-    }
+SARA_R5_error_t SARA_R5::enableRingIndicator(SARA_R5_gpio_t gpio, int ringPin)
+{
+  if (ringPin < 0)
+    return SARA_R5_ERROR_INVALID;
 
-    // Check that readLength > 0
-    if (readLength == 0)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->println(F("socketRead: zero length!"));
-      }
-      free(command);
-      free(response);
-      return SARA_R5_ERROR_ZERO_READ_LENGTH;
-    }
+  if ((_ringInstance != nullptr) && (_ringInstance != this))
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("enableRingIndicator: already in use by another SARA_R5"));
+    return SARA_R5_ERROR_BUSY;
+  }
 
-    // Find the first double-quote:
-    strBegin = strchr(searchPtr, '\"');
+  SARA_R5_error_t err = setGpioMode(gpio, RING_INDICATION);
+  if (err != SARA_R5_ERROR_SUCCESS)
+    return err;
 
-    if (strBegin == nullptr)
-    {
-      free(command);
-      free(response);
-      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
-    }
+  disableRingIndicator(); // In case the pin has changed
 
-    // Now copy the data into readDest
-    readIndexThisRead = 1; // Start after the quote
-    while (readIndexThisRead < (readLength + 1))
-    {
-      readDest[readIndexTotal] = strBegin[readIndexThisRead];
-      readIndexTotal++;
-      readIndexThisRead++;
-    }
+  _ringPin = ringPin;
+  _ringFlag = true; // Poll once, in case a URC arrived before the interrupt was attached
+  _ringInstance = this;
+  pinMode(ringPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ringPin), ringISR, FALLING);
 
-    if (_printDebug == true)
-      _debugPort->println(F("socketRead: success"));
+  return SARA_R5_ERROR_SUCCESS;
+}
 
-    // Update *bytesRead
-    if (bytesRead != nullptr)
-      *bytesRead = readIndexTotal;
+void SARA_R5::disableRingIndicator(void)
+{
+  if (_ringPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_ringPin));
+  _ringPin = -1;
+  if (_ringInstance == this)
+    _ringInstance = nullptr;
+}
 
-    // How many bytes are left to read?
-    // This would have been bytesLeftToRead -= bytesToRead
-    // Except the SARA can potentially return less data than requested...
-    // So we need to subtract readLength instead.
-    bytesLeftToRead -= readLength;
-    if (_printDebug == true)
-    {
-      if (bytesLeftToRead > 0)
-      {
-        _debugPort->print(F("socketRead: multiple read. bytesLeftToRead: "));
-        _debugPort->println(bytesLeftToRead);
-      }
-    }
-  } // /while (bytesLeftToRead > 0)
+bool SARA_R5::ringPending(void)
+{
+  if (_ringFlag)
+    return true;
+  if ((_ringPin >= 0) && (digitalRead(_ringPin) == LOW)) // RI is still asserted
+    return true;
+  if ((millis() - _ringMillis) < SARA_R5_RING_POLL_WINDOW)
+    return true;
+  // Data saved in the backlog while a command was in progress, or received since the last poll
+  return ((_saraResponseBacklogLength > 0) || (hwAvailable() > 0));
+}
 
-  free(command);
-  free(response);
+bool SARA_R5::ringPoll(void)
+{
+  if (!ringPending())
+    return false;
 
-  return SARA_R5_ERROR_SUCCESS;
+  if (_ringFlag)
+  {
+    _ringFlag = false;
+    _ringMillis = millis();
+  }
+
+  return bufferedPoll();
 }
 
-SARA_R5_error_t SARA_R5::socketReadAvailable(int socket, int *length)
+int SARA_R5::socketOpen(SARA_R5_socket_protocol_t protocol, unsigned int localPort)
 {
+  SARA_R5_error_t err;
   char *command;
   char *response;
-  SARA_R5_error_t err;
-  int scanNum = 0;
-  int readLength = 0;
-  int socketStore = 0;
+  int sockId = -1;
+  char *responseStart;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_READ_SOCKET) + 32);
+  command = sara_r5_calloc_char(strlen(SARA_R5_CREATE_SOCKET) + 10);
   if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d,0", SARA_R5_READ_SOCKET, socket);
+    return -1;
+  if (localPort == 0)
+    sprintf(command, "%s=%d", SARA_R5_CREATE_SOCKET, (int)protocol);
+  else
+    sprintf(command, "%s=%d,%d", SARA_R5_CREATE_SOCKET, (int)protocol, localPort);
 
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("socketOpen: Fail: nullptr response"));
+    sara_r5_free(command);
+    return -1;
   }
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
+                                response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  if (err == SARA_R5_ERROR_SUCCESS)
+  if (err != SARA_R5_ERROR_SUCCESS)
   {
-    char *searchPtr = strstr(response, "+USORD:");
-    if (searchPtr != nullptr)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
-      searchPtr += strlen("+USORD:"); //  Move searchPtr to first char
-      while (*searchPtr == ' ') searchPtr++; // skip spaces
-      scanNum = sscanf(searchPtr, "%d,%d",
-                        &socketStore, &readLength);
+      _debugPort->print(F("socketOpen: Fail: Error: "));
+      _debugPort->print(err);
+      _debugPort->print(F("  Response: {"));
+      _debugPort->print(response);
+      _debugPort->println(F("}"));
     }
-    if (scanNum != 2)
+    sara_r5_free(command);
+    sara_r5_free(response);
+    return -1;
+  }
+
+  responseStart = strstr(response, "+USOCR:");
+  if (responseStart == nullptr)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+    {
+      _debugPort->print(F("socketOpen: Failure: {"));
+      _debugPort->print(response);
+      _debugPort->println(F("}"));
+    }
+    sara_r5_free(command);
+    sara_r5_free(response);
+    return -1;
+  }
+
+  responseStart += strlen("+USOCR:"); //  Move searchPtr to first char
+  while (*responseStart == ' ') responseStart++; // skip spaces
+  sscanf(responseStart, "%d", &sockId);
+  _lastSocketProtocol[sockId] = (int)protocol;
+  if ((sockId >= 0) && (sockId < SARA_R5_NUM_SOCKETS))
+    _socketSecure[sockId] = false; // A new socket is not secure until socketSetSecure is called
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+
+  return sockId;
+}
+
+SARA_R5_error_t SARA_R5::socketClose(int socket, unsigned long timeout)
+{
+  SARA_R5_error_t err;
+  char *command;
+  char *response;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_CLOSE_SOCKET) + 10);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+  // if timeout is short, close asynchronously and don't wait for socket closure (we will get the URC later)
+  // this will make sure the AT command parser is not confused during init()
+  const char* format = (SARA_R5_STANDARD_RESPONSE_TIMEOUT == timeout) ? "%s=%d,1" : "%s=%d";
+  sprintf(command, format, SARA_R5_CLOSE_SOCKET, socket);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response, timeout);
+
+  if ((err != SARA_R5_ERROR_SUCCESS) && SARA_R5_LOG_ERROR_ENABLED)
+  {
+    _debugPort->print(F("socketClose: Error: "));
+    _debugPort->println(socketGetLastError());
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketConnect(int socket, const char *address,
+                                       unsigned int port)
+{
+  SARA_R5_error_t err;
+  char *command;
+  char ipAddress[16];
+  bool secure = (socket >= 0) && (socket < SARA_R5_NUM_SOCKETS) && _socketSecure[socket];
+  bool resolved = (!secure) && resolveForSocket(address, ipAddress); // TLS needs the hostname
+  const char *connectAddress = resolved ? ipAddress : address; // The IP address can be longer than the hostname
+  unsigned long connectStart;
+
+  // =<socket>,"<address>",<port> : allow 3 digits for the socket and 5 for the port, plus the NULL
+  command = sara_r5_calloc_char(strlen(SARA_R5_CONNECT_SOCKET) + strlen(connectAddress) + 16);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d,\"%s\",%d", SARA_R5_CONNECT_SOCKET, socket, connectAddress, port);
+
+  connectStart = millis();
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_IP_CONNECT_TIMEOUT);
+
+  sara_r5_free(command);
+
+  if ((err == SARA_R5_ERROR_SUCCESS) && (socket >= 0) && (socket < SARA_R5_NUM_SOCKETS))
+  {
+    _socketConnectTime[socket] = millis() - connectStart;
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+    {
+      _debugPort->print(F("socketConnect: connected in "));
+      _debugPort->print(_socketConnectTime[socket]);
+      _debugPort->println(F(" ms"));
+    }
+  }
+
+  if ((err != SARA_R5_ERROR_SUCCESS) && (resolved))
+    removeDNSCacheEntry(address); // The address may have changed. Resolve it again next time
+
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketConnect(int socket, IPAddress address,
+                                       unsigned int port)
+{
+  char *charAddress = sara_r5_calloc_char(16);
+  if (charAddress == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  memset(charAddress, 0, 16);
+  sprintf(charAddress, "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+
+  SARA_R5_error_t err = socketConnect(socket, (const char *)charAddress, port);
+  sara_r5_free(charAddress);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketSetSecure(int socket, bool secure, int secprofile)
+{
+  SARA_R5_error_t err;
+  char *command;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_SECURE_SOCKET) + 16);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  if (secure)
+    sprintf(command, "%s=%d,1,%d", SARA_R5_SECURE_SOCKET, socket, secprofile);
+  else
+    sprintf(command, "%s=%d,0", SARA_R5_SECURE_SOCKET, socket);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  if ((err == SARA_R5_ERROR_SUCCESS) && (socket >= 0) && (socket < SARA_R5_NUM_SOCKETS))
+    _socketSecure[socket] = secure;
+
+  sara_r5_free(command);
+  return err;
+}
+
+unsigned long SARA_R5::socketGetConnectTime(int socket)
+{
+  if ((socket < 0) || (socket >= SARA_R5_NUM_SOCKETS))
+    return 0;
+  return _socketConnectTime[socket];
+}
+
+SARA_R5_error_t SARA_R5::socketWrite(int socket, const char *str, int len)
+{
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
+  char *command;
+  char *response;
+  SARA_R5_error_t err;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_WRITE_SOCKET) + 16);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+  int dataLen = len == -1 ? strlen(str) : len;
+  sprintf(command, "%s=%d,%d", SARA_R5_WRITE_SOCKET, socket, dataLen);
+
+  err = sendCommandWithResponse(command, "@", response,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT * 5);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    unsigned long writeDelay = millis();
+    while (millis() < (writeDelay + 50))
+      delay(1); //u-blox specification says to wait 50ms after receiving "@" to write data.
+
+    if (len == -1)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
       {
-        _debugPort->print(F("socketReadAvailable: error: scanNum is "));
-        _debugPort->println(scanNum);
+        _debugPort->print(F("socketWrite: writing: "));
+        _debugPort->println(str);
       }
-      free(command);
-      free(response);
-      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+      hwPrint(str);
+    }
+    else
+    {
+      if (SARA_R5_LOG_DEBUG_ENABLED)
+      {
+        _debugPort->print(F("socketWrite: writing "));
+        _debugPort->print(len);
+        _debugPort->println(F(" bytes"));
+      }
+      hwWriteData(str, len);
     }
 
-    *length = readLength;
+    err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_SOCKET_WRITE_TIMEOUT);
   }
 
-  free(command);
-  free(response);
+  if (err != SARA_R5_ERROR_SUCCESS)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+    {
+      _debugPort->print(F("socketWrite: Error: "));
+      _debugPort->print(err);
+      _debugPort->print(F(" => {"));
+      _debugPort->print(response);
+      _debugPort->println(F("}"));
+    }
+  }
 
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
-SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
-                                      IPAddress *remoteIPAddress, int *remotePort, int *bytesRead)
+SARA_R5_error_t SARA_R5::socketWrite(int socket, String str)
+{
+  return socketWrite(socket, str.c_str(), str.length());
+}
+
+SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, const char *address, int port, const char *str, int len)
+{
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
+  char *command;
+  char *response;
+  SARA_R5_error_t err;
+  int dataLen = len == -1 ? strlen(str) : len;
+  char ipAddress[16];
+
+  if (resolveForSocket(address, ipAddress))
+    address = ipAddress;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_WRITE_UDP_SOCKET) + strlen(address) + 32);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  sprintf(command, "%s=%d,\"%s\",%d,%d", SARA_R5_WRITE_UDP_SOCKET,
+          socket, address, port, dataLen);
+  err = sendCommandWithResponse(command, "@", response, SARA_R5_STANDARD_RESPONSE_TIMEOUT * 5);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    if (len == -1) //If binary data we need to send a length.
+    {
+      hwPrint(str);
+    }
+    else
+    {
+      hwWriteData(str, len);
+    }
+    err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_SOCKET_WRITE_TIMEOUT);
+  }
+  else
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->print(F("socketWriteUDP: Error: "));
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+      _debugPort->println(socketGetLastError());
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, IPAddress address, int port, const char *str, int len)
+{
+  char *charAddress = sara_r5_calloc_char(16);
+  if (charAddress == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  memset(charAddress, 0, 16);
+  sprintf(charAddress, "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+
+  SARA_R5_error_t err = socketWriteUDP(socket, (const char *)charAddress, port, str, len);
+  sara_r5_free(charAddress);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketWriteUDP(int socket, String address, int port, String str)
+{
+  return socketWriteUDP(socket, address.c_str(), port, str.c_str(), str.length());
+}
+
+SARA_R5_error_t SARA_R5::socketRead(int socket, int length, char *readDest, int *bytesRead)
 {
   char *command;
   char *response;
@@ -3128,8 +5048,6 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
   int readIndexThisRead = 0;
   SARA_R5_error_t err;
   int scanNum = 0;
-  int remoteIPstore[4] = { 0, 0, 0, 0 };
-  int portStore = 0;
   int readLength = 0;
   int socketStore = 0;
   int bytesLeftToRead = length;
@@ -3142,23 +5060,23 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
   // Check if length is zero
   if (length == 0)
   {
-    if (_printDebug == true)
-      _debugPort->print(F("socketReadUDP: length is 0! Call socketReadAvailableUDP?"));
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->print(F("socketRead: length is 0! Call socketReadAvailable?"));
     return SARA_R5_ERROR_UNEXPECTED_PARAM;
   }
 
   // Allocate memory for the command
-  command = sara_r5_calloc_char(strlen(SARA_R5_READ_UDP_SOCKET) + 32);
+  command = sara_r5_calloc_char(strlen(SARA_R5_READ_SOCKET) + 32);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
 
   // Allocate memory for the response
   // We only need enough to read _saraR5maxSocketRead bytes - not the whole thing
-  int responseLength = _saraR5maxSocketRead + strlen(SARA_R5_READ_UDP_SOCKET) + minimumResponseAllocation;
+  int responseLength = _saraR5maxSocketRead + strlen(SARA_R5_READ_SOCKET) + minimumResponseAllocation;
   response = sara_r5_calloc_char(responseLength);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3172,49 +5090,267 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
     else
       bytesToRead = bytesLeftToRead;
 
-    sprintf(command, "%s=%d,%d", SARA_R5_READ_UDP_SOCKET, socket, bytesToRead);
+    sprintf(command, "%s=%d,%d", SARA_R5_READ_SOCKET, socket, bytesToRead);
 
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT, responseLength);
 
     if (err != SARA_R5_ERROR_SUCCESS)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
-        _debugPort->print(F("socketReadUDP: sendCommandWithResponse err "));
+        _debugPort->print(F("socketRead: sendCommandWithResponse err "));
         _debugPort->println(err);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return err;
     }
 
     // Extract the data
-    char *searchPtr = strstr(response, "+USORF:");
+    char *searchPtr = strstr(response, "+USORD:");
     if (searchPtr != nullptr)
     {
-      searchPtr += strlen("+USORF:"); //  Move searchPtr to first char
+      searchPtr += strlen("+USORD:"); //  Move searchPtr to first char
       while (*searchPtr == ' ') searchPtr++; // skip spaces
-      scanNum = sscanf(searchPtr, "%d,\"%d.%d.%d.%d\",%d,%d",
-                        &socketStore, &remoteIPstore[0], &remoteIPstore[1], &remoteIPstore[2], &remoteIPstore[3],
-                        &portStore, &readLength);
+      scanNum = sscanf(searchPtr, "%d,%d",
+                        &socketStore, &readLength);
     }
-    if (scanNum != 7)
+    if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
-        _debugPort->print(F("socketReadUDP: error: scanNum is "));
+        _debugPort->print(F("socketRead: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     // Check that readLength == bytesToRead
     if (readLength != bytesToRead)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("socketRead: length mismatch! bytesToRead="));
+        _debugPort->print(bytesToRead);
+        _debugPort->print(F(" readLength="));
+        _debugPort->println(readLength);
+      }
+    }
+
+    // Check that readLength > 0
+    if (readLength == 0)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->println(F("socketRead: zero length!"));
+      }
+      sara_r5_free(command);
+      sara_r5_free(response);
+      return SARA_R5_ERROR_ZERO_READ_LENGTH;
+    }
+
+    // Find the first double-quote:
+    strBegin = strchr(searchPtr, '\"');
+
+    if (strBegin == nullptr)
+    {
+      sara_r5_free(command);
+      sara_r5_free(response);
+      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+    }
+
+    // Now copy the data into readDest
+    readIndexThisRead = 1; // Start after the quote
+    while (readIndexThisRead < (readLength + 1))
+    {
+      readDest[readIndexTotal] = strBegin[readIndexThisRead];
+      readIndexTotal++;
+      readIndexThisRead++;
+    }
+
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+      _debugPort->println(F("socketRead: success"));
+
+    // Update *bytesRead
+    if (bytesRead != nullptr)
+      *bytesRead = readIndexTotal;
+
+    // How many bytes are left to read?
+    // This would have been bytesLeftToRead -= bytesToRead
+    // Except the SARA can potentially return less data than requested...
+    // So we need to subtract readLength instead.
+    bytesLeftToRead -= readLength;
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+    {
+      if (bytesLeftToRead > 0)
+      {
+        _debugPort->print(F("socketRead: multiple read. bytesLeftToRead: "));
+        _debugPort->println(bytesLeftToRead);
+      }
+    }
+  } // /while (bytesLeftToRead > 0)
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+SARA_R5_error_t SARA_R5::socketReadAvailable(int socket, int *length)
+{
+  char *command;
+  char *response;
+  SARA_R5_error_t err;
+  int scanNum = 0;
+  int readLength = 0;
+  int socketStore = 0;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_READ_SOCKET) + 32);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d,0", SARA_R5_READ_SOCKET, socket);
+
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    char *searchPtr = strstr(response, "+USORD:");
+    if (searchPtr != nullptr)
+    {
+      searchPtr += strlen("+USORD:"); //  Move searchPtr to first char
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      scanNum = sscanf(searchPtr, "%d,%d",
+                        &socketStore, &readLength);
+    }
+    if (scanNum != 2)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("socketReadAvailable: error: scanNum is "));
+        _debugPort->println(scanNum);
+      }
+      sara_r5_free(command);
+      sara_r5_free(response);
+      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+    }
+
+    *length = readLength;
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
+                                      IPAddress *remoteIPAddress, int *remotePort, int *bytesRead)
+{
+  char *command;
+  char *response;
+  char *strBegin;
+  int readIndexTotal = 0;
+  int readIndexThisRead = 0;
+  SARA_R5_error_t err;
+  int scanNum = 0;
+  int remoteIPstore[4] = { 0, 0, 0, 0 };
+  int portStore = 0;
+  int readLength = 0;
+  int socketStore = 0;
+  int bytesLeftToRead = length;
+  int bytesToRead;
+
+  // Set *bytesRead to zero
+  if (bytesRead != nullptr)
+    *bytesRead = 0;
+
+  // Check if length is zero
+  if (length == 0)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->print(F("socketReadUDP: length is 0! Call socketReadAvailableUDP?"));
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+  }
+
+  // Allocate memory for the command
+  command = sara_r5_calloc_char(strlen(SARA_R5_READ_UDP_SOCKET) + 32);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+
+  // Allocate memory for the response
+  // We only need enough to read _saraR5maxSocketRead bytes - not the whole thing
+  int responseLength = _saraR5maxSocketRead + strlen(SARA_R5_READ_UDP_SOCKET) + minimumResponseAllocation;
+  response = sara_r5_calloc_char(responseLength);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  // If there are more than _saraR5maxSocketRead (1024) bytes to be read,
+  // we need to do multiple reads to get all the data
+
+  while (bytesLeftToRead > 0)
+  {
+    if (bytesLeftToRead > _saraR5maxSocketRead) // Limit a single read to _saraR5maxSocketRead
+      bytesToRead = _saraR5maxSocketRead;
+    else
+      bytesToRead = bytesLeftToRead;
+
+    sprintf(command, "%s=%d,%d", SARA_R5_READ_UDP_SOCKET, socket, bytesToRead);
+
+    err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
+                                  SARA_R5_STANDARD_RESPONSE_TIMEOUT, responseLength);
+
+    if (err != SARA_R5_ERROR_SUCCESS)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("socketReadUDP: sendCommandWithResponse err "));
+        _debugPort->println(err);
+      }
+      sara_r5_free(command);
+      sara_r5_free(response);
+      return err;
+    }
+
+    // Extract the data
+    char *searchPtr = strstr(response, "+USORF:");
+    if (searchPtr != nullptr)
+    {
+      searchPtr += strlen("+USORF:"); //  Move searchPtr to first char
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      scanNum = sscanf(searchPtr, "%d,\"%d.%d.%d.%d\",%d,%d",
+                        &socketStore, &remoteIPstore[0], &remoteIPstore[1], &remoteIPstore[2], &remoteIPstore[3],
+                        &portStore, &readLength);
+    }
+    if (scanNum != 7)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("socketReadUDP: error: scanNum is "));
+        _debugPort->println(scanNum);
+      }
+      sara_r5_free(command);
+      sara_r5_free(response);
+      return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+    }
+
+    // Check that readLength == bytesToRead
+    if (readLength != bytesToRead)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("socketReadUDP: length mismatch! bytesToRead="));
         _debugPort->print(bytesToRead);
@@ -3226,12 +5362,12 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
     // Check that readLength > 0
     if (readLength == 0)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->println(F("socketRead: zero length!"));
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_ZERO_READ_LENGTH;
     }
 
@@ -3242,8 +5378,8 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
 
     if (strBegin == nullptr)
     {
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
@@ -3273,7 +5409,7 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
       *remotePort = portStore;
     }
 
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
       _debugPort->println(F("socketReadUDP: success"));
 
     // Update *bytesRead
@@ -3285,7 +5421,7 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
     // Except the SARA can potentially return less data than requested...
     // So we need to subtract readLength instead.
     bytesLeftToRead -= readLength;
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       if (bytesLeftToRead > 0)
       {
@@ -3295,8 +5431,8 @@ SARA_R5_error_t SARA_R5::socketReadUDP(int socket, int length, char *readDest,
     }
   } // /while (bytesLeftToRead > 0)
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return SARA_R5_ERROR_SUCCESS;
 }
@@ -3318,7 +5454,7 @@ SARA_R5_error_t SARA_R5::socketReadAvailableUDP(int socket, int *length)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3337,21 +5473,21 @@ SARA_R5_error_t SARA_R5::socketReadAvailableUDP(int socket, int *length)
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("socketReadAvailableUDP: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *length = readLength;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3369,7 +5505,7 @@ SARA_R5_error_t SARA_R5::socketListen(int socket, unsigned int port)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3386,7 +5522,7 @@ SARA_R5_error_t SARA_R5::socketDirectLinkMode(int socket)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_CONNECT, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3407,7 +5543,7 @@ SARA_R5_error_t SARA_R5::socketDirectLinkTimeTrigger(int socket, unsigned long t
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3428,7 +5564,7 @@ SARA_R5_error_t SARA_R5::socketDirectLinkDataLengthTrigger(int socket, int dataL
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3449,7 +5585,7 @@ SARA_R5_error_t SARA_R5::socketDirectLinkCharacterTrigger(int socket, int charac
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3470,7 +5606,7 @@ SARA_R5_error_t SARA_R5::socketDirectLinkCongestionTimer(int socket, unsigned lo
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3491,7 +5627,7 @@ SARA_R5_error_t SARA_R5::querySocketType(int socket, SARA_R5_socket_protocol_t *
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3510,13 +5646,13 @@ SARA_R5_error_t SARA_R5::querySocketType(int socket, SARA_R5_socket_protocol_t *
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketType: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
@@ -3524,8 +5660,8 @@ SARA_R5_error_t SARA_R5::querySocketType(int socket, SARA_R5_socket_protocol_t *
     _lastSocketProtocol[socketStore] = paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3547,7 +5683,7 @@ SARA_R5_error_t SARA_R5::querySocketLastError(int socket, int *error)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3566,21 +5702,21 @@ SARA_R5_error_t SARA_R5::querySocketLastError(int socket, int *error)
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketLastError: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *error = paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3602,7 +5738,7 @@ SARA_R5_error_t SARA_R5::querySocketTotalBytesSent(int socket, uint32_t *total)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3621,21 +5757,21 @@ SARA_R5_error_t SARA_R5::querySocketTotalBytesSent(int socket, uint32_t *total)
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketTotalBytesSent: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *total = (uint32_t)paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3657,7 +5793,7 @@ SARA_R5_error_t SARA_R5::querySocketTotalBytesReceived(int socket, uint32_t *tot
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3676,21 +5812,21 @@ SARA_R5_error_t SARA_R5::querySocketTotalBytesReceived(int socket, uint32_t *tot
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketTotalBytesReceived: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *total = (uint32_t)paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3712,7 +5848,7 @@ SARA_R5_error_t SARA_R5::querySocketRemoteIPAddress(int socket, IPAddress *addre
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3733,13 +5869,13 @@ SARA_R5_error_t SARA_R5::querySocketRemoteIPAddress(int socket, IPAddress *addre
     }
     if (scanNum != 6)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketRemoteIPAddress: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
@@ -3749,8 +5885,8 @@ SARA_R5_error_t SARA_R5::querySocketRemoteIPAddress(int socket, IPAddress *addre
     *port = paramVals[4];
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3772,7 +5908,7 @@ SARA_R5_error_t SARA_R5::querySocketStatusTCP(int socket, SARA_R5_tcp_socket_sta
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3791,21 +5927,21 @@ SARA_R5_error_t SARA_R5::querySocketStatusTCP(int socket, SARA_R5_tcp_socket_sta
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketStatusTCP: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *status = (SARA_R5_tcp_socket_status_t)paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
@@ -3827,7 +5963,7 @@ SARA_R5_error_t SARA_R5::querySocketOutUnackData(int socket, uint32_t *total)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -3846,95 +5982,298 @@ SARA_R5_error_t SARA_R5::querySocketOutUnackData(int socket, uint32_t *total)
     }
     if (scanNum != 2)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("querySocketOutUnackData: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
     *total = (uint32_t)paramVal;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
 
-//Issues command to get last socket error, then prints to serial. Also updates rx/backlog buffers.
-int SARA_R5::socketGetLastError()
+SARA_R5_error_t SARA_R5::resolve(const char *host, IPAddress *address, bool useCache)
 {
+  SARA_R5_LOCK();
+
   SARA_R5_error_t err;
   char *command;
   char *response;
-  int errorCode = -1;
+  int ipStore[4];
 
-  command = sara_r5_calloc_char(64);
+  if ((host == nullptr) || (address == nullptr))
+    return SARA_R5_ERROR_INVALID;
+
+  if (useCache)
+  {
+    SARA_R5_dns_cache_entry *entry = findDNSCacheEntry(host);
+    if (entry != nullptr)
+    {
+      entry->lastUsedMillis = millis();
+      *address = entry->address;
+      return SARA_R5_ERROR_SUCCESS;
+    }
+  }
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_DNS_RESOLUTION) + strlen(host) + 8);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=0,\"%s\"", SARA_R5_DNS_RESOLUTION, host);
 
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
-  sprintf(command, "%s", SARA_R5_GET_ERROR);
-
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+                                SARA_R5_IP_CONNECT_TIMEOUT);
 
   if (err == SARA_R5_ERROR_SUCCESS)
   {
-    char *searchPtr = strstr(response, "+USOER:");
+    int scanned = 0;
+    char *searchPtr = strstr(response, SARA_R5_DNS_RESOLUTION);
     if (searchPtr != nullptr)
     {
-      searchPtr += strlen("+USOER:"); //  Move searchPtr to first char
+      searchPtr += strlen(SARA_R5_DNS_RESOLUTION) + 1; // Move searchPtr to first char
       while (*searchPtr == ' ') searchPtr++; // skip spaces
-      sscanf(searchPtr, "%d", &errorCode);
+      scanned = sscanf(searchPtr, "\"%d.%d.%d.%d\"", &ipStore[0], &ipStore[1], &ipStore[2], &ipStore[3]);
+    }
+    if (scanned == 4)
+    {
+      for (int i = 0; i < 4; i++)
+        (*address)[i] = (uint8_t)ipStore[i];
+    }
+    else
+    {
+      err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
-  return errorCode;
-}
+  if ((err != SARA_R5_ERROR_SUCCESS) || (!useCache) || (_dnsCacheTTL == 0) || (strlen(host) >= SARA_R5_DNS_HOST_LENGTH))
+    return err;
 
-IPAddress SARA_R5::lastRemoteIP(void)
-{
-  return _lastRemoteIP;
+  // Cache the address. Replace the entry for this host, an empty entry or the least recently used entry
+  SARA_R5_dns_cache_entry *entry = &_dnsCache[0];
+  for (int i = 0; i < SARA_R5_DNS_CACHE_SIZE; i++)
+  {
+    if ((_dnsCache[i].inUse) && (strcmp(_dnsCache[i].host, host) == 0))
+    {
+      entry = &_dnsCache[i];
+      break;
+    }
+    if (!_dnsCache[i].inUse)
+      entry = &_dnsCache[i];
+    else if ((entry->inUse) && ((millis() - _dnsCache[i].lastUsedMillis) > (millis() - entry->lastUsedMillis)))
+      entry = &_dnsCache[i];
+  }
+  entry->inUse = true;
+  strcpy(entry->host, host);
+  entry->address = *address;
+  entry->resolvedMillis = millis();
+  entry->lastUsedMillis = entry->resolvedMillis;
+
+  return err;
 }
 
-SARA_R5_error_t SARA_R5::resetHTTPprofile(int profile)
+void SARA_R5::setDNSCacheTTL(unsigned long ttlMillis)
 {
-  SARA_R5_error_t err;
-  char *command;
+  SARA_R5_LOCK();
 
-  if (profile >= SARA_R5_NUM_HTTP_PROFILES)
-    return SARA_R5_ERROR_ERROR;
-
-  command = sara_r5_calloc_char(strlen(SARA_R5_HTTP_PROFILE) + 16);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d", SARA_R5_HTTP_PROFILE, profile);
+  _dnsCacheTTL = ttlMillis;
+  if (ttlMillis == 0)
+    clearDNSCache();
+}
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+void SARA_R5::clearDNSCache(void)
+{
+  SARA_R5_LOCK();
 
-  free(command);
-  return err;
+  for (int i = 0; i < SARA_R5_DNS_CACHE_SIZE; i++)
+    _dnsCache[i].inUse = false;
 }
 
-SARA_R5_error_t SARA_R5::setHTTPserverIPaddress(int profile, IPAddress address)
+SARA_R5::SARA_R5_dns_cache_entry *SARA_R5::findDNSCacheEntry(const char *host)
 {
-  SARA_R5_error_t err;
-  char *command;
+  for (int i = 0; i < SARA_R5_DNS_CACHE_SIZE; i++)
+  {
+    if ((_dnsCache[i].inUse) && (strcmp(_dnsCache[i].host, host) == 0))
+    {
+      if ((millis() - _dnsCache[i].resolvedMillis) < _dnsCacheTTL)
+        return &_dnsCache[i];
+      _dnsCache[i].inUse = false; // Expired
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+void SARA_R5::removeDNSCacheEntry(const char *host)
+{
+  for (int i = 0; i < SARA_R5_DNS_CACHE_SIZE; i++)
+  {
+    if ((_dnsCache[i].inUse) && (strcmp(_dnsCache[i].host, host) == 0))
+      _dnsCache[i].inUse = false;
+  }
+}
+
+bool SARA_R5::resolveForSocket(const char *host, char *ipString)
+{
+  if ((_dnsCacheTTL == 0) || (host == nullptr) || (strlen(host) >= SARA_R5_DNS_HOST_LENGTH))
+    return false;
+
+  // Is host already an IP address? IPv6 addresses contain colons
+  bool literal = true;
+  for (const char *ptr = host; *ptr != '\0'; ptr++)
+  {
+    if (*ptr == ':')
+      break;
+    if ((*ptr != '.') && ((*ptr < '0') || (*ptr > '9')))
+    {
+      literal = false;
+      break;
+    }
+  }
+  if (literal)
+    return false;
+
+  IPAddress address(0, 0, 0, 0);
+  if (resolve(host, &address) != SARA_R5_ERROR_SUCCESS)
+    return false; // Let the module try
+
+  sprintf(ipString, "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+  return true;
+}
+
+SARA_R5_error_t SARA_R5::setRTCMFramingSocket(int socket)
+{
+  SARA_R5_LOCK();
+
+  if (socket >= SARA_R5_NUM_SOCKETS)
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+
+  if (socket < 0) // Disable framing
+  {
+    _rtcmFramingSocket = -1;
+    return SARA_R5_ERROR_SUCCESS;
+  }
+
+  if (_rtcmFramer == nullptr)
+  {
+    _rtcmFramer = new SARA_R5_RTCM3_Framer;
+    if (_rtcmFramer == nullptr)
+      return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+  if (_rtcmFramer->begin() == false)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("setRTCMFramingSocket: not enough memory for the RTCM frame buffer!"));
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  // A new socket means a new stream. Discard any partial frame from the old one
+  if (socket != _rtcmFramingSocket)
+    _rtcmFramer->reset();
+
+  _rtcmFramer->setFrameCallback(_rtcmFrameCallback, _rtcmFrameCallbackContext);
+  _rtcmFramingSocket = socket;
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+SARA_R5_error_t SARA_R5::setRTCMMessageFilter(const uint16_t *types, uint8_t numTypes)
+{
+  SARA_R5_LOCK();
+
+  if (_rtcmFramer == nullptr)
+    return SARA_R5_ERROR_INVALID; // Call setRTCMFramingSocket first
+  if (_rtcmFramer->setMessageFilter(types, numTypes) == false)
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+//Issues command to get last socket error, then prints to serial. Also updates rx/backlog buffers.
+int SARA_R5::socketGetLastError()
+{
+  SARA_R5_error_t err;
+  char *command;
+  char *response;
+  int errorCode = -1;
+
+  command = sara_r5_calloc_char(64);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  sprintf(command, "%s", SARA_R5_GET_ERROR);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    char *searchPtr = strstr(response, "+USOER:");
+    if (searchPtr != nullptr)
+    {
+      searchPtr += strlen("+USOER:"); //  Move searchPtr to first char
+      while (*searchPtr == ' ') searchPtr++; // skip spaces
+      sscanf(searchPtr, "%d", &errorCode);
+    }
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+
+  return errorCode;
+}
+
+IPAddress SARA_R5::lastRemoteIP(void)
+{
+  return _lastRemoteIP;
+}
+
+SARA_R5_error_t SARA_R5::resetHTTPprofile(int profile)
+{
+  SARA_R5_error_t err;
+  char *command;
+
+  if (profile >= SARA_R5_NUM_HTTP_PROFILES)
+    return SARA_R5_ERROR_ERROR;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_HTTP_PROFILE) + 16);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d", SARA_R5_HTTP_PROFILE, profile);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  sara_r5_free(command);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::setHTTPserverIPaddress(int profile, IPAddress address)
+{
+  SARA_R5_error_t err;
+  char *command;
 
   if (profile >= SARA_R5_NUM_HTTP_PROFILES)
     return SARA_R5_ERROR_ERROR;
@@ -3948,7 +6287,7 @@ SARA_R5_error_t SARA_R5::setHTTPserverIPaddress(int profile, IPAddress address)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3969,7 +6308,7 @@ SARA_R5_error_t SARA_R5::setHTTPserverName(int profile, String server)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -3990,7 +6329,7 @@ SARA_R5_error_t SARA_R5::setHTTPusername(int profile, String username)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4011,7 +6350,7 @@ SARA_R5_error_t SARA_R5::setHTTPpassword(int profile, String password)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4032,7 +6371,7 @@ SARA_R5_error_t SARA_R5::setHTTPauthentication(int profile, bool authenticate)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4053,7 +6392,7 @@ SARA_R5_error_t SARA_R5::setHTTPserverPort(int profile, int port)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4074,7 +6413,7 @@ SARA_R5_error_t SARA_R5::setHTTPcustomHeader(int profile, String header)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4098,7 +6437,7 @@ SARA_R5_error_t SARA_R5::setHTTPsecure(int profile, bool secure, int secprofile)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4118,10 +6457,206 @@ SARA_R5_error_t SARA_R5::ping(String remote_host, int retry, int p_size,
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
+SARA_R5_error_t SARA_R5::sntpRequest(const char *const *servers, uint8_t numServers, uint8_t apply,
+                                     void (*sntpCallback)(SARA_R5_error_t result, const SARA_R5_sntp_result *sntp, void *context),
+                                     void *context)
+{
+  SARA_R5_LOCK();
+
+  uint8_t packet[SARA_R5_SNTP_PACKET_LENGTH];
+
+  if (_sntpSocket >= 0)
+    return SARA_R5_ERROR_BUSY;
+  if ((servers == nullptr) || (numServers == 0))
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+  if (numServers > SARA_R5_SNTP_MAX_SERVERS)
+    numServers = SARA_R5_SNTP_MAX_SERVERS;
+
+  int socket = socketOpen(SARA_R5_UDP);
+  if (socket < 0)
+    return SARA_R5_ERROR_ERROR;
+
+  _sntpSocket = socket;
+  _sntpStartMillis = millis(); // Before the first send: processSNTP checks the timeout as soon as _sntpSocket is set
+  _sntpNumServers = 0;
+  _sntpApply = apply;
+  _sntpCallback = sntpCallback;
+  _sntpCallbackContext = context;
+
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    SARA_R5_sntp_server *server = &_sntpServers[_sntpNumServers];
+    if (resolve(servers[i], &server->address) != SARA_R5_ERROR_SUCCESS)
+    {
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("sntpRequest: could not resolve "));
+        _debugPort->println(servers[i]);
+      }
+      continue;
+    }
+
+    // LI 0, version 4, mode 3 (client). Only the transmit timestamp is set: to a tag we can check in the response
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x23;
+    server->sentMillis = millis();
+    server->tag = server->sentMillis ^ ((uint32_t)(_sntpNumServers + 1) << 24);
+    for (int b = 0; b < 4; b++)
+      packet[44 + b] = (uint8_t)(server->tag >> (24 - (b * 8)));
+    server->responded = false;
+
+    char address[16];
+    sprintf(address, "%d.%d.%d.%d", server->address[0], server->address[1], server->address[2], server->address[3]);
+    if (socketWriteUDP(socket, (const char *)address, SARA_R5_SNTP_PORT, (const char *)packet, sizeof(packet)) == SARA_R5_ERROR_SUCCESS)
+      _sntpNumServers++;
+  }
+
+  if (_sntpNumServers == 0)
+  {
+    socketClose(socket);
+    _sntpSocket = -1;
+    return SARA_R5_ERROR_ERROR;
+  }
+
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+void SARA_R5::processSNTPResponse(const uint8_t *packet, int length, IPAddress remoteAddress)
+{
+  unsigned long receivedMillis = millis();
+
+  if (length < SARA_R5_SNTP_PACKET_LENGTH)
+    return;
+
+  uint8_t leap = packet[0] >> 6;
+  uint8_t mode = packet[0] & 0x07;
+  uint8_t stratum = packet[1];
+  if ((leap == 3) || (mode != 4) || (stratum == 0) || (stratum > 15))
+  {
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+      _debugPort->println(F("processSNTPResponse: server not synchronized"));
+    return;
+  }
+
+  // Big-endian 32-bit words
+  uint32_t words[12];
+  for (int w = 0; w < 12; w++)
+    words[w] = ((uint32_t)packet[w * 4] << 24) | ((uint32_t)packet[(w * 4) + 1] << 16) | ((uint32_t)packet[(w * 4) + 2] << 8) | packet[(w * 4) + 3];
+
+  for (uint8_t i = 0; i < _sntpNumServers; i++)
+  {
+    SARA_R5_sntp_server *server = &_sntpServers[i];
+    if ((server->responded) || (!(server->address == remoteAddress)) || (words[6] != 0) || (words[7] != server->tag))
+      continue;
+
+    // T1 and T4 are local (millis). T2 and T3 are the server receive and transmit timestamps (NTP seconds and fractions)
+    const uint32_t ntpToUnix = 2208988800UL;
+    uint64_t t2 = ((uint64_t)(words[8] - ntpToUnix) * 1000) + (((uint64_t)words[9] * 1000) >> 32);
+    uint64_t t3 = ((uint64_t)(words[10] - ntpToUnix) * 1000) + (((uint64_t)words[11] * 1000) >> 32);
+    uint32_t roundTrip = receivedMillis - server->sentMillis;
+    uint32_t serverTime = (t3 > t2) ? (uint32_t)(t3 - t2) : 0;
+    uint32_t delay = (roundTrip > serverTime) ? roundTrip - serverTime : 0;
+    uint32_t dispersion = ((words[2] >> 16) * 1000) + (((words[2] & 0xFFFF) * 1000) >> 16); // Root dispersion (16.16 seconds)
+
+    SARA_R5_sntp_result *result = &server->result;
+    result->epochMillis = t3 + (delay / 2); // The server time when the response was received
+    result->localMillis = receivedMillis;
+    result->delayMillis = delay;
+    result->accuracyMillis = (uint16_t)(((delay / 2) + dispersion) > 0xFFFF ? 0xFFFF : ((delay / 2) + dispersion));
+    result->stratum = stratum;
+    result->server = remoteAddress;
+    result->offsetMillis = 0;
+    if (_clockValid) // offset = ((T2 - T1) + (T3 - T4)) / 2, with T1 and T4 from the clock model
+    {
+      uint64_t t4 = getEpochMillis() - (millis() - receivedMillis);
+      uint64_t t1 = t4 - roundTrip;
+      result->offsetMillis = (int32_t)((((int64_t)t2 - (int64_t)t1) + ((int64_t)t3 - (int64_t)t4)) / 2);
+    }
+    server->responded = true;
+
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+    {
+      _debugPort->print(F("processSNTPResponse: delay "));
+      _debugPort->print(delay);
+      _debugPort->print(F(" ms, offset "));
+      _debugPort->println(result->offsetMillis);
+    }
+    break;
+  }
+
+  for (uint8_t i = 0; i < _sntpNumServers; i++)
+  {
+    if (!_sntpServers[i].responded)
+      return;
+  }
+  completeSNTP(); // All of the servers have responded
+}
+
+void SARA_R5::processSNTP(void)
+{
+  if ((_sntpSocket >= 0) && ((millis() - _sntpStartMillis) >= SARA_R5_SNTP_TIMEOUT))
+    completeSNTP();
+}
+
+// Select the response with the lowest delay, apply it and call the callback
+void SARA_R5::completeSNTP(void)
+{
+  SARA_R5_sntp_result *best = nullptr;
+  uint8_t responses = 0;
+  SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
+
+  int socket = _sntpSocket;
+  _sntpSocket = -1; // Clear this first - the callback could start a new request
+  socketClose(socket);
+
+  for (uint8_t i = 0; i < _sntpNumServers; i++)
+  {
+    if (!_sntpServers[i].responded)
+      continue;
+    responses++;
+    if ((best == nullptr) || (_sntpServers[i].result.delayMillis < best->delayMillis))
+      best = &_sntpServers[i].result;
+  }
+
+  if (best == nullptr)
+  {
+    if (_sntpCallback != nullptr)
+      _sntpCallback(SARA_R5_ERROR_TIMEOUT, nullptr, _sntpCallbackContext);
+    return;
+  }
+
+  best->responses = responses;
+  uint64_t now = best->epochMillis + (millis() - best->localMillis);
+
+  if (_sntpApply & SARA_R5_SNTP_APPLY_CLOCK_MODEL)
+    setClockEpoch((uint32_t)(now / 1000), (uint16_t)(now % 1000), best->accuracyMillis);
+
+  if (_sntpApply & SARA_R5_SNTP_APPLY_CCLK)
+  {
+    // Civil from days: see http://howardhinnant.github.io/date_algorithms.html
+    uint32_t seconds = (uint32_t)(now / 1000);
+    int32_t z = (int32_t)(seconds / 86400) + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint8_t d = doy - (153 * mp + 2) / 5 + 1;
+    uint8_t mo = mp < 10 ? mp + 3 : mp - 9;
+    uint32_t y = yoe + era * 400 + (mo <= 2 ? 1 : 0);
+    uint32_t daySeconds = seconds % 86400;
+    if (setClock((uint8_t)(y % 100), mo, d, daySeconds / 3600, (daySeconds / 60) % 60, daySeconds % 60, 0) != SARA_R5_ERROR_SUCCESS)
+      err = SARA_R5_ERROR_ERROR;
+  }
+
+  if (_sntpCallback != nullptr)
+    _sntpCallback(err, best, _sntpCallbackContext);
+}
+
 SARA_R5_error_t SARA_R5::sendHTTPGET(int profile, String path, String responseFilename)
 {
   SARA_R5_error_t err;
@@ -4140,7 +6675,7 @@ SARA_R5_error_t SARA_R5::sendHTTPGET(int profile, String path, String responseFi
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4163,7 +6698,7 @@ SARA_R5_error_t SARA_R5::sendHTTPPOSTdata(int profile, String path, String respo
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4186,7 +6721,7 @@ SARA_R5_error_t SARA_R5::sendHTTPPOSTfile(int profile, String path, String respo
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4206,7 +6741,7 @@ SARA_R5_error_t SARA_R5::getHTTPprotocolError(int profile, int *error_class, int
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -4233,8 +6768,8 @@ SARA_R5_error_t SARA_R5::getHTTPprotocolError(int profile, int *error_class, int
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -4248,7 +6783,7 @@ SARA_R5_error_t SARA_R5::nvMQTT(SARA_R5_mqtt_nv_parameter_t parameter)
     sprintf(command, "%s=%d", SARA_R5_MQTT_NVM, parameter);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4262,7 +6797,7 @@ SARA_R5_error_t SARA_R5::setMQTTclientId(const String& clientId)
     sprintf(command, "%s=%d,\"%s\"", SARA_R5_MQTT_PROFILE, SARA_R5_MQTT_PROFILE_CLIENT_ID, clientId.c_str());
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4276,7 +6811,7 @@ SARA_R5_error_t SARA_R5::setMQTTserver(const String& serverName, int port)
     sprintf(command, "%s=%d,\"%s\",%d", SARA_R5_MQTT_PROFILE, SARA_R5_MQTT_PROFILE_SERVERNAME, serverName.c_str(), port);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4291,7 +6826,7 @@ SARA_R5_error_t SARA_R5::setMQTTcredentials(const String& userName, const String
     sprintf(command, "%s=%d,\"%s\",\"%s\"", SARA_R5_MQTT_PROFILE, SARA_R5_MQTT_PROFILE_USERNAMEPWD, userName.c_str(), pwd.c_str());
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4306,7 +6841,7 @@ SARA_R5_error_t SARA_R5::setMQTTsecure(bool secure, int secprofile)
     else sprintf(command, "%s=%d,%d,%d", SARA_R5_MQTT_PROFILE, SARA_R5_MQTT_PROFILE_SECURE, secure, secprofile);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4320,7 +6855,7 @@ SARA_R5_error_t SARA_R5::connectMQTT(void)
     sprintf(command, "%s=%d", SARA_R5_MQTT_COMMAND, SARA_R5_MQTT_COMMAND_LOGIN);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4334,7 +6869,7 @@ SARA_R5_error_t SARA_R5::disconnectMQTT(void)
     sprintf(command, "%s=%d", SARA_R5_MQTT_COMMAND, SARA_R5_MQTT_COMMAND_LOGOUT);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4348,7 +6883,7 @@ SARA_R5_error_t SARA_R5::subscribeMQTTtopic(int max_Qos, const String& topic)
   sprintf(command, "%s=%d,%d,\"%s\"", SARA_R5_MQTT_COMMAND, SARA_R5_MQTT_COMMAND_SUBSCRIBE, max_Qos, topic.c_str());
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4362,7 +6897,7 @@ SARA_R5_error_t SARA_R5::unsubscribeMQTTtopic(const String& topic)
   sprintf(command, "%s=%d,\"%s\"", SARA_R5_MQTT_COMMAND, SARA_R5_MQTT_COMMAND_UNSUBSCRIBE, topic.c_str());
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4388,7 +6923,7 @@ SARA_R5_error_t SARA_R5::readMQTT(int* pQos, String* pTopic, uint8_t *readDest,
   response = sara_r5_calloc_char(responseLength);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -4401,13 +6936,13 @@ SARA_R5_error_t SARA_R5::readMQTT(int* pQos, String* pTopic, uint8_t *readDest,
 
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("readMQTT: sendCommandWithResponse err "));
       _debugPort->println(err);
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
@@ -4422,13 +6957,13 @@ SARA_R5_error_t SARA_R5::readMQTT(int* pQos, String* pTopic, uint8_t *readDest,
   }
   if ((scanNum != 5) || (cmd != SARA_R5_MQTT_COMMAND_READ))
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("readMQTT: error: scanNum is "));
       _debugPort->println(scanNum);
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
@@ -4444,7 +6979,7 @@ SARA_R5_error_t SARA_R5::readMQTT(int* pQos, String* pTopic, uint8_t *readDest,
     if (readDest && (searchPtr != nullptr) && (response + responseLength >= searchPtr + data_length + 1) && (searchPtr[data_length + 1] == '"')) {
       if (data_length > readLength) {
         data_length = readLength;
-        if (_printDebug == true) {
+        if (SARA_R5_LOG_ERROR_ENABLED) {
           _debugPort->print(F("readMQTT: error: trucate message"));
         }
         err = SARA_R5_ERROR_OUT_OF_MEMORY;
@@ -4452,20 +6987,25 @@ SARA_R5_error_t SARA_R5::readMQTT(int* pQos, String* pTopic, uint8_t *readDest,
       memcpy(readDest, searchPtr+1, data_length);
       *bytesRead = data_length;
     } else {
-      if (_printDebug == true) {
+      if (SARA_R5_LOG_ERROR_ENABLED) {
         _debugPort->print(F("readMQTT: error: message end "));
       }
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
   }
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
 
 SARA_R5_error_t SARA_R5::mqttPublishTextMsg(const String& topic, const char * const msg, uint8_t qos, bool retain)
 {
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
   if (topic.length() < 1 || msg == nullptr)
   {
     return SARA_R5_ERROR_INVALID;
@@ -4511,12 +7051,17 @@ SARA_R5_error_t SARA_R5::mqttPublishTextMsg(const String& topic, const char * co
     err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
   }
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
 SARA_R5_error_t SARA_R5::mqttPublishBinaryMsg(const String& topic, const char * const msg, size_t msg_len, uint8_t qos, bool retain)
 {
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
   /*
    * The modem prints the '>' as the signal to send the binary message content.
    * at+umqttc=9,0,0,"topic",4
@@ -4548,12 +7093,17 @@ SARA_R5_error_t SARA_R5::mqttPublishBinaryMsg(const String& topic, const char *
     err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
   }
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
 SARA_R5_error_t SARA_R5::mqttPublishFromFile(const String& topic, const String& filename, uint8_t qos, bool retain)
 {
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
   if (topic.length() < 1|| filename.length() < 1)
   {
     return SARA_R5_ERROR_INVALID;
@@ -4571,7 +7121,7 @@ SARA_R5_error_t SARA_R5::mqttPublishFromFile(const String& topic, const String&
   sendCommand(command, true);
   err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4611,7 +7161,7 @@ SARA_R5_error_t SARA_R5::getMQTTprotocolError(int *error_code, int *error_code2)
       err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(response);
+  sara_r5_free(response);
   return err;
 }
 
@@ -4690,7 +7240,7 @@ SARA_R5_error_t SARA_R5::ftpGetFile(const String& filename)
   SARA_R5_error_t err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4735,7 +7285,7 @@ SARA_R5_error_t SARA_R5::getFTPprotocolError(int *error_code, int *error_code2)
     }
   }
 
-  free(response);
+  sara_r5_free(response);
   return err;
 }
 
@@ -4753,7 +7303,7 @@ SARA_R5_error_t SARA_R5::resetSecurityProfile(int secprofile)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4768,7 +7318,7 @@ SARA_R5_error_t SARA_R5::configSecurityProfile(int secprofile, SARA_R5_sec_profi
     sprintf(command, "%s=%d,%d,%d", SARA_R5_SEC_PROFILE, secprofile,parameter,value);
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
@@ -4782,95 +7332,409 @@ SARA_R5_error_t SARA_R5::configSecurityProfileString(int secprofile, SARA_R5_sec
     sprintf(command, "%s=%d,%d,\"%s\"", SARA_R5_SEC_PROFILE, secprofile,parameter,value.c_str());
     err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                   SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
+    sara_r5_free(command);
     return err;
 }
 
-SARA_R5_error_t SARA_R5::setSecurityManager(SARA_R5_sec_manager_opcode_t opcode, SARA_R5_sec_manager_parameter_t parameter, String name, String data)
+SARA_R5_error_t SARA_R5::applySecurityProfile(int secprofile, const SARA_R5_sec_profile_setting *settings, uint8_t numSettings, bool *written)
 {
-  char *command;
-  char *response;
   SARA_R5_error_t err;
+  char fingerprint[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+  char stored[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+  char filename[24];
+  int size = 0;
+
+  if (written != nullptr)
+    *written = false;
+  if ((settings == nullptr) && (numSettings > 0))
+    return SARA_R5_ERROR_INVALID;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_SEC_MANAGER) + name.length() + 20);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  response = sara_r5_calloc_char(minimumResponseAllocation);
-  if (response == nullptr)
-  {
-    free(command);
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  }
-  int dataLen = data.length();
-  sprintf(command, "%s=%d,%d,\"%s\",%d", SARA_R5_SEC_MANAGER, opcode, parameter, name.c_str(), dataLen);
+  securityProfileFingerprint(settings, numSettings, fingerprint);
+  sprintf(filename, "%s%d.md5", SARA_R5_SEC_PROFILE_FINGERPRINT_PREFIX, secprofile);
 
-  err = sendCommandWithResponse(command, ">", response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
-  if (err == SARA_R5_ERROR_SUCCESS)
+  // getFileSize returns an error if the file does not exist
+  if ((getFileSize(String(filename), &size) == SARA_R5_ERROR_SUCCESS) && (size == (SARA_R5_SEC_MANAGER_MD5_LENGTH - 1)))
   {
-    if (_printDebug == true)
+    if (getFileContents(String(filename), stored) == SARA_R5_ERROR_SUCCESS)
     {
-      _debugPort->print(F("dataDownload: writing "));
-      _debugPort->print(dataLen);
-      _debugPort->println(F(" bytes"));
+      stored[SARA_R5_SEC_MANAGER_MD5_LENGTH - 1] = '\0';
+      if (strcmp(stored, fingerprint) == 0)
+      {
+        if (SARA_R5_LOG_DEBUG_ENABLED)
+          _debugPort->println(F("applySecurityProfile: profile is up to date"));
+        return SARA_R5_ERROR_SUCCESS;
+      }
     }
-    hwWriteData(data.c_str(), dataLen);
-    err = waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_STANDARD_RESPONSE_TIMEOUT*3);
   }
 
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+    _debugPort->println(F("applySecurityProfile: writing profile"));
 
-  if (err != SARA_R5_ERROR_SUCCESS)
+  if (written != nullptr)
+    *written = true;
+
+  // Delete the old fingerprint first. If a setting fails, the profile is rewritten next time
+  if (size > 0)
+    deleteFile(String(filename));
+
+  err = resetSecurityProfile(secprofile);
+  for (uint8_t i = 0; (i < numSettings) && (err == SARA_R5_ERROR_SUCCESS); i++)
   {
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("dataDownload: Error: "));
-      _debugPort->print(err);
-      _debugPort->print(F(" => {"));
-      _debugPort->print(response);
-      _debugPort->println(F("}"));
-    }
+    if (settings[i].string != nullptr)
+      err = configSecurityProfileString(secprofile, settings[i].parameter, String(settings[i].string));
+    else
+      err = configSecurityProfile(secprofile, settings[i].parameter, settings[i].value);
   }
 
-  free(command);
-  free(response);
+  if (err == SARA_R5_ERROR_SUCCESS)
+    err = appendFileContents(String(filename), fingerprint, SARA_R5_SEC_MANAGER_MD5_LENGTH - 1);
+
   return err;
 }
 
-SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, int value)
+SARA_R5_error_t SARA_R5::forgetSecurityProfile(int secprofile)
 {
-  SARA_R5_error_t err;
-  char *command;
+  char filename[24];
+  sprintf(filename, "%s%d.md5", SARA_R5_SEC_PROFILE_FINGERPRINT_PREFIX, secprofile);
+  return deleteFile(String(filename));
+}
 
-  if (profile >= SARA_R5_NUM_PSD_PROFILES)
-    return SARA_R5_ERROR_ERROR;
+SARA_R5_error_t SARA_R5::enableTLSSessionResumption(int secprofile, bool enable)
+{
+  return configSecurityProfile(secprofile, SARA_R5_SEC_PROFILE_PARAM_TLS_SESSION_RESUMPTION, enable ? 1 : 0);
+}
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_MESSAGE_PDP_CONFIG) + 24);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
-  sprintf(command, "%s=%d,%d,%d", SARA_R5_MESSAGE_PDP_CONFIG, profile, parameter,
-          value);
+void SARA_R5::securityProfileFingerprint(const SARA_R5_sec_profile_setting *settings, uint8_t numSettings, char *md5)
+{
+  SARA_R5_MD5 hash;
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  // Hash the parameter, a type marker, then the value (little-endian) or the string including its NULL
+  for (uint8_t i = 0; i < numSettings; i++)
+  {
+    uint8_t header[2] = {(uint8_t)settings[i].parameter, (uint8_t)((settings[i].string != nullptr) ? 's' : 'i')};
+    hash.update(header, 2);
+    if (settings[i].string != nullptr)
+    {
+      hash.update((const uint8_t *)settings[i].string, strlen(settings[i].string) + 1);
+    }
+    else
+    {
+      uint8_t value[4];
+      for (int b = 0; b < 4; b++)
+        value[b] = (uint8_t)((uint32_t)settings[i].value >> (8 * b));
+      hash.update(value, 4);
+    }
+  }
+  hash.finish(md5);
+}
 
-  free(command);
-  return err;
+SARA_R5_error_t SARA_R5::setSecurityManager(SARA_R5_sec_manager_opcode_t opcode, SARA_R5_sec_manager_parameter_t parameter, String name, String data)
+{
+  if (opcode != SARA_R5_SEC_MANAGER_OPCODE_IMPORT)
+    return SARA_R5_ERROR_INVALID;
+
+  return importSecurityObject(parameter, name.c_str(), (const uint8_t *)data.c_str(), data.length(), false);
 }
 
-SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, SARA_R5_pdp_protocol_type_t value)
+SARA_R5_error_t SARA_R5::importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, Stream &data, size_t length, char *md5)
 {
-  return (setPDPconfiguration(profile, parameter, (int)value));
+  return streamSecurityObject(parameter, name, length, readStreamChunk, (void *)&data, md5);
 }
 
-SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, String value)
+SARA_R5_error_t SARA_R5::importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, const uint8_t *data, size_t length, bool skipIfIdentical)
+{
+  if (data == nullptr)
+    return SARA_R5_ERROR_INVALID;
+
+  return importSecurityObject(parameter, name, length, readMemoryChunk, (void *)data, skipIfIdentical);
+}
+
+SARA_R5_error_t SARA_R5::importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, size_t length,
+                                              size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context,
+                                              bool skipIfIdentical)
 {
   SARA_R5_error_t err;
-  char *command;
 
-  if (profile >= SARA_R5_NUM_PSD_PROFILES)
-    return SARA_R5_ERROR_ERROR;
+  if ((name == nullptr) || (readChunk == nullptr) || (length == 0))
+    return SARA_R5_ERROR_INVALID;
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_MESSAGE_PDP_CONFIG) + 64);
-  if (command == nullptr)
+  if (skipIfIdentical)
+  {
+    char localMD5[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+    char moduleMD5[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+
+    err = hashSecurityObject(length, readChunk, context, localMD5);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      return err;
+
+    // getSecurityObjectMD5 returns an error if the module does not hold the object
+    if ((getSecurityObjectMD5(parameter, name, moduleMD5) == SARA_R5_ERROR_SUCCESS) && (strcmp(localMD5, moduleMD5) == 0))
+    {
+      if (SARA_R5_LOG_DEBUG_ENABLED)
+      {
+        _debugPort->print(F("importSecurityObject: "));
+        _debugPort->print(name);
+        _debugPort->println(F(" is already up to date"));
+      }
+      return SARA_R5_ERROR_SUCCESS;
+    }
+  }
+
+  return streamSecurityObject(parameter, name, length, readChunk, context, nullptr);
+}
+
+SARA_R5_error_t SARA_R5::getSecurityObjectMD5(SARA_R5_sec_manager_parameter_t parameter, const char *name, char *md5)
+{
+  SARA_R5_error_t err;
+  char *command;
+  char *response;
+
+  if ((name == nullptr) || (md5 == nullptr))
+    return SARA_R5_ERROR_INVALID;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_SEC_MANAGER) + strlen(name) + 16);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d,%d,\"%s\"", SARA_R5_SEC_MANAGER, SARA_R5_SEC_MANAGER_OPCODE_MD5, parameter, name);
+
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK, response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    // +USECMNG: 4,<type>,"<internal_name>","<md5_string>"
+    char *searchPtr = strstr(response, "+USECMNG:");
+    char *fields[4];
+    if ((searchPtr != nullptr) && (splitFields(searchPtr + 9, fields, 4) == 4) && (strlen(fields[3]) == (SARA_R5_SEC_MANAGER_MD5_LENGTH - 1)))
+    {
+      for (int i = 0; i < (SARA_R5_SEC_MANAGER_MD5_LENGTH - 1); i++)
+        md5[i] = tolower(fields[3][i]);
+      md5[SARA_R5_SEC_MANAGER_MD5_LENGTH - 1] = '\0';
+    }
+    else
+    {
+      err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+    }
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::streamSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, size_t length,
+                                              size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context,
+                                              char *md5)
+{
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
+  SARA_R5_error_t err;
+  char *command;
+  char *response;
+  uint8_t chunk[SARA_R5_SEC_MANAGER_CHUNK_LENGTH];
+  char localMD5[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+  char moduleMD5[SARA_R5_SEC_MANAGER_MD5_LENGTH];
+  SARA_R5_MD5 hash;
+  size_t offset = 0;
+
+  if ((name == nullptr) || (readChunk == nullptr) || (length == 0))
+    return SARA_R5_ERROR_INVALID;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_SEC_MANAGER) + strlen(name) + 24);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  response = sara_r5_calloc_char(minimumResponseAllocation);
+  if (response == nullptr)
+  {
+    sara_r5_free(command);
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  }
+  sprintf(command, "%s=%d,%d,\"%s\",%lu", SARA_R5_SEC_MANAGER, SARA_R5_SEC_MANAGER_OPCODE_IMPORT, parameter, name, (unsigned long)length);
+
+  err = sendCommandWithResponse(command, ">", response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+    {
+      _debugPort->print(F("dataDownload: writing "));
+      _debugPort->print((unsigned long)length);
+      _debugPort->println(F(" bytes"));
+    }
+
+    while (offset < length)
+    {
+      size_t size = length - offset;
+      if (size > SARA_R5_SEC_MANAGER_CHUNK_LENGTH)
+        size = SARA_R5_SEC_MANAGER_CHUNK_LENGTH;
+      size_t got = readChunk(chunk, offset, size, context);
+      if (got == 0)
+        break;
+      if (got > size)
+        got = size;
+      hash.update(chunk, got);
+      hwWriteData((const char *)chunk, (int)got);
+      offset += got;
+    }
+
+    if (offset < length)
+    {
+      // The source ran dry. The module will reject the incomplete object. Wait for the ERROR so the next command is not swallowed
+      waitForResponse(SARA_R5_RESPONSE_OK, SARA_R5_RESPONSE_ERROR, SARA_R5_STANDARD_RESPONSE_TIMEOUT * 3);
+      err = SARA_R5_ERROR_ZERO_READ_LENGTH;
+    }
+    else
+    {
+      // The response is:
+      // +USECMNG: 0,<type>,"<internal_name>","<md5_string>"
+      // OK
+      size_t lineLength;
+      moduleMD5[0] = '\0';
+      err = SARA_R5_ERROR_TIMEOUT;
+      while (readResponseLine(response, minimumResponseAllocation, &lineLength, SARA_R5_STANDARD_RESPONSE_TIMEOUT * 3) == SARA_R5_ERROR_SUCCESS)
+      {
+        if (strncmp(response, "+USECMNG:", 9) == 0)
+        {
+          char *fields[4];
+          if (splitFields(response + 9, fields, 4) == 4)
+          {
+            strncpy(moduleMD5, fields[3], SARA_R5_SEC_MANAGER_MD5_LENGTH - 1);
+            moduleMD5[SARA_R5_SEC_MANAGER_MD5_LENGTH - 1] = '\0';
+            for (char *c = moduleMD5; *c != '\0'; c++)
+              *c = tolower(*c);
+          }
+        }
+        else if (strcmp(response, "OK") == 0)
+        {
+          err = SARA_R5_ERROR_SUCCESS;
+          break;
+        }
+        else if ((strcmp(response, "ERROR") == 0) || (strncmp(response, "+CME ERROR", 10) == 0))
+        {
+          err = SARA_R5_ERROR_ERROR;
+          break;
+        }
+        else if (lineLength > 0)
+        {
+          appendToBacklog(response, lineLength); // Could be a URC
+        }
+      }
+
+      hash.finish(localMD5);
+      if ((err == SARA_R5_ERROR_SUCCESS) && (moduleMD5[0] != '\0') && (strcmp(localMD5, moduleMD5) != 0))
+      {
+        if (SARA_R5_LOG_ERROR_ENABLED)
+        {
+          _debugPort->print(F("dataDownload: MD5 mismatch: "));
+          _debugPort->print(localMD5);
+          _debugPort->print(F(" != "));
+          _debugPort->println(moduleMD5);
+        }
+        err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
+      }
+      if ((err == SARA_R5_ERROR_SUCCESS) && (md5 != nullptr))
+        strcpy(md5, localMD5);
+    }
+  }
+
+  if (err != SARA_R5_ERROR_SUCCESS)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+    {
+      _debugPort->print(F("dataDownload: Error: "));
+      _debugPort->print(err);
+      _debugPort->print(F(" => {"));
+      _debugPort->print(response);
+      _debugPort->println(F("}"));
+    }
+  }
+
+  sara_r5_free(command);
+  sara_r5_free(response);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::hashSecurityObject(size_t length, size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context,
+                                            char *md5)
+{
+  uint8_t chunk[SARA_R5_SEC_MANAGER_CHUNK_LENGTH];
+  SARA_R5_MD5 hash;
+  size_t offset = 0;
+
+  while (offset < length)
+  {
+    size_t size = length - offset;
+    if (size > SARA_R5_SEC_MANAGER_CHUNK_LENGTH)
+      size = SARA_R5_SEC_MANAGER_CHUNK_LENGTH;
+    size_t got = readChunk(chunk, offset, size, context);
+    if (got == 0)
+      return SARA_R5_ERROR_ZERO_READ_LENGTH;
+    if (got > size)
+      got = size;
+    hash.update(chunk, got);
+    offset += got;
+  }
+
+  hash.finish(md5);
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+size_t SARA_R5::readStreamChunk(uint8_t *buffer, size_t offset, size_t size, void *context)
+{
+  (void)offset; // Streams can only be read in order
+  return ((Stream *)context)->readBytes((char *)buffer, size);
+}
+
+size_t SARA_R5::readMemoryChunk(uint8_t *buffer, size_t offset, size_t size, void *context)
+{
+  memcpy(buffer, (const uint8_t *)context + offset, size);
+  return size;
+}
+
+SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, int value)
+{
+  SARA_R5_error_t err;
+  char *command;
+
+  if (profile >= SARA_R5_NUM_PSD_PROFILES)
+    return SARA_R5_ERROR_ERROR;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_MESSAGE_PDP_CONFIG) + 24);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  sprintf(command, "%s=%d,%d,%d", SARA_R5_MESSAGE_PDP_CONFIG, profile, parameter,
+          value);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  sara_r5_free(command);
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, SARA_R5_pdp_protocol_type_t value)
+{
+  return (setPDPconfiguration(profile, parameter, (int)value));
+}
+
+SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configuration_parameter_t parameter, String value)
+{
+  SARA_R5_error_t err;
+  char *command;
+
+  if (profile >= SARA_R5_NUM_PSD_PROFILES)
+    return SARA_R5_ERROR_ERROR;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_MESSAGE_PDP_CONFIG) + 64);
+  if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   sprintf(command, "%s=%d,%d,\"%s\"", SARA_R5_MESSAGE_PDP_CONFIG, profile, parameter,
           value.c_str());
@@ -4878,7 +7742,7 @@ SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configurat
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4899,7 +7763,7 @@ SARA_R5_error_t SARA_R5::setPDPconfiguration(int profile, SARA_R5_pdp_configurat
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4919,10 +7783,117 @@ SARA_R5_error_t SARA_R5::performPDPaction(int profile, SARA_R5_pdp_actions_t act
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
+SARA_R5_error_t SARA_R5::startConnectionManager(const char *apn, int profile, int cid)
+{
+  SARA_R5_LOCK();
+
+  SARA_R5_error_t err;
+
+  if ((profile < 0) || (profile >= SARA_R5_NUM_PSD_PROFILES))
+    return SARA_R5_ERROR_UNEXPECTED_PARAM;
+
+  if (apn != nullptr)
+  {
+    err = setAPN(String(apn), (uint8_t)cid);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      return err;
+    err = setPDPconfiguration(profile, SARA_R5_PSD_CONFIG_PARAM_MAP_TO_CID, cid);
+    if (err != SARA_R5_ERROR_SUCCESS)
+      return err;
+  }
+
+  // The +CEREG URCs tell us as soon as registration is lost or regained
+  err = enableRegistrationURCs();
+  if (err != SARA_R5_ERROR_SUCCESS)
+    return err;
+
+  _connectionProfile = profile;
+  _connectionBackoff = SARA_R5_CONNECTION_BACKOFF_MIN;
+  _connectionLost = false;
+  setConnectionState(SARA_R5_CONNECTION_REGISTERING);
+  processConnectionManager(); // Activate now if we are already registered
+
+  return SARA_R5_ERROR_SUCCESS;
+}
+
+void SARA_R5::stopConnectionManager(bool deactivate)
+{
+  SARA_R5_LOCK();
+
+  for (int i = 0; i < SARA_R5_NUM_MANAGED_SOCKETS; i++)
+  {
+    if (_managedSockets[i].inUse)
+      closeManagedSocket(i, true);
+  }
+
+  if ((deactivate) && (_connectionState == SARA_R5_CONNECTION_CONNECTED))
+    performPDPaction(_connectionProfile, SARA_R5_PSD_ACTION_DEACTIVATE);
+
+  setConnectionState(SARA_R5_CONNECTION_STOPPED);
+}
+
+void SARA_R5::setConnectionStateCallback(void (*connectionStateCallback)(SARA_R5_connection_state_t state, void *context), void *context)
+{
+  SARA_R5_LOCK();
+
+  _connectionStateCallback = connectionStateCallback;
+  _connectionStateCallbackContext = context;
+}
+
+int SARA_R5::addManagedSocket(SARA_R5_socket_protocol_t protocol, const char *host, unsigned int port,
+                              void (*socketCallback)(int id, int socket, void *context), void *context)
+{
+  SARA_R5_LOCK();
+
+  if ((host == nullptr) || (strlen(host) >= SARA_R5_MANAGED_SOCKET_HOST_LENGTH))
+    return -1;
+
+  for (int i = 0; i < SARA_R5_NUM_MANAGED_SOCKETS; i++)
+  {
+    if (!_managedSockets[i].inUse)
+    {
+      SARA_R5_managed_socket *managed = &_managedSockets[i];
+      managed->inUse = true;
+      managed->protocol = protocol;
+      strcpy(managed->host, host);
+      managed->port = port;
+      managed->socket = -1;
+      managed->retryMillis = millis();
+      managed->backoff = 0; // Open as soon as possible
+      managed->callback = socketCallback;
+      managed->context = context;
+      if (_connectionState == SARA_R5_CONNECTION_CONNECTED)
+        openManagedSockets();
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void SARA_R5::removeManagedSocket(int id)
+{
+  SARA_R5_LOCK();
+
+  if ((id < 0) || (id >= SARA_R5_NUM_MANAGED_SOCKETS) || (!_managedSockets[id].inUse))
+    return;
+  closeManagedSocket(id, true);
+  _managedSockets[id].inUse = false;
+}
+
+int SARA_R5::getManagedSocket(int id)
+{
+  SARA_R5_LOCK();
+
+  if ((id < 0) || (id >= SARA_R5_NUM_MANAGED_SOCKETS) || (!_managedSockets[id].inUse))
+    return -1;
+  return _managedSockets[id].socket;
+}
+
 SARA_R5_error_t SARA_R5::activatePDPcontext(bool status, int cid)
 {
   SARA_R5_error_t err;
@@ -4942,7 +7913,7 @@ SARA_R5_error_t SARA_R5::activatePDPcontext(bool status, int cid)
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -4964,7 +7935,7 @@ SARA_R5_error_t SARA_R5::getNetworkAssignedIPAddress(int profile, IPAddress *add
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -4984,13 +7955,13 @@ SARA_R5_error_t SARA_R5::getNetworkAssignedIPAddress(int profile, IPAddress *add
     }
     if (scanNum != 6)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("getNetworkAssignedIPAddress: error: scanNum is "));
         _debugPort->println(scanNum);
       }
-      free(command);
-      free(response);
+      sara_r5_free(command);
+      sara_r5_free(response);
       return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
     }
 
@@ -4999,19 +7970,22 @@ SARA_R5_error_t SARA_R5::getNetworkAssignedIPAddress(int profile, IPAddress *add
     *address = tempAddress;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
 
-bool SARA_R5::isGPSon(void)
+bool SARA_R5::isGPSon(bool forceRefresh)
 {
   SARA_R5_error_t err;
   char *command;
   char *response;
   bool on = false;
 
+  if ((!forceRefresh) && (_gnssPowerState != SARA_R5_GNSS_POWER_UNKNOWN))
+    return (_gnssPowerState == SARA_R5_GNSS_POWER_ON);
+
   command = sara_r5_calloc_char(strlen(SARA_R5_GNSS_POWER) + 2);
   if (command == nullptr)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
@@ -5020,7 +7994,7 @@ bool SARA_R5::isGPSon(void)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -5038,10 +8012,11 @@ bool SARA_R5::isGPSon(void)
       if ((pch2 != nullptr) && ((pch2 == pch1 + 1) || (pch2 == pch1 + 2)))
         on = true;
     }
+    _gnssPowerState = on ? SARA_R5_GNSS_POWER_ON : SARA_R5_GNSS_POWER_OFF;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return on;
 }
@@ -5073,8 +8048,12 @@ SARA_R5_error_t SARA_R5::gpsPower(bool enable, gnss_system_t gnss_sys, gnss_aidi
   }
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, 10000);
+  if (err == SARA_R5_ERROR_SUCCESS)
+    _gnssPowerState = enable ? SARA_R5_GNSS_POWER_ON : SARA_R5_GNSS_POWER_OFF;
+  else
+    _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN; // The cache may be stale. Query the module next time
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -5160,7 +8139,7 @@ SARA_R5_error_t SARA_R5::gpsEnableRmc(bool enable)
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_10_SEC_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -5180,7 +8159,7 @@ SARA_R5_error_t SARA_R5::gpsGetRmc(struct PositionData *pos, struct SpeedData *s
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -5199,8 +8178,8 @@ SARA_R5_error_t SARA_R5::gpsGetRmc(struct PositionData *pos, struct SpeedData *s
     }
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -5223,9 +8202,7 @@ SARA_R5_error_t SARA_R5::gpsGetSpeed(struct SpeedData *speed)
 SARA_R5_error_t SARA_R5::gpsRequest(unsigned int timeout, uint32_t accuracy,
                                     bool detailed, unsigned int sensor)
 {
-  // AT+ULOC=2,<useCellLocate>,<detailed>,<timeout>,<accuracy>
-  SARA_R5_error_t err;
-  char *command;
+  SARA_R5_LOCK();
 
   // This function will only work if the GPS module is initially turned off.
   if (isGPSon())
@@ -5233,6 +8210,26 @@ SARA_R5_error_t SARA_R5::gpsRequest(unsigned int timeout, uint32_t accuracy,
     gpsPower(false);
   }
 
+  SARA_R5_error_t err = sendLocationRequest(timeout, accuracy, detailed, sensor);
+  if (err == SARA_R5_ERROR_SUCCESS)
+  {
+    // Hold off gpsRequestAsync until this +UULOC has arrived, so it is not mistaken for an async result
+    if (_legacyLocationRequests < 255)
+      _legacyLocationRequests++;
+    if (timeout > 999)
+      timeout = 999;
+    _legacyLocationDeadline = millis() + ((unsigned long)timeout * 1000) + SARA_R5_LOCATION_REQUEST_MARGIN;
+  }
+  return err;
+}
+
+SARA_R5_error_t SARA_R5::sendLocationRequest(unsigned int timeout, uint32_t accuracy,
+                                             bool detailed, unsigned int sensor)
+{
+  // AT+ULOC=2,<useCellLocate>,<detailed>,<timeout>,<accuracy>
+  SARA_R5_error_t err;
+  char *command;
+
   if (timeout > 999)
     timeout = 999;
   if (accuracy > 999999)
@@ -5251,47 +8248,124 @@ SARA_R5_error_t SARA_R5::gpsRequest(unsigned int timeout, uint32_t accuracy,
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr, SARA_R5_10_SEC_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
-SARA_R5_error_t SARA_R5::gpsAidingServerConf(const char *primaryServer, const char *secondaryServer, const char *authToken,
-                                             unsigned int days, unsigned int period, unsigned int resolution,
-                                             unsigned int gnssTypes, unsigned int mode, unsigned int dataType)
+int SARA_R5::gpsRequestAsync(unsigned int timeout, uint32_t accuracy,
+                             void (*locationCallback)(SARA_R5_error_t result, ClockData time, PositionData gps, SpeedData spd,
+                                                      unsigned long uncertainty, void *context),
+                             void *context, bool detailed, unsigned int sensor)
 {
-  SARA_R5_error_t err;
-  char *command;
+  SARA_R5_LOCK();
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_AIDING_SERVER_CONFIGURATION) + 256);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  if (_numLocationRequests >= SARA_R5_NUM_LOCATION_REQUESTS)
+  {
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("gpsRequestAsync: queue is full!"));
+    return -1;
+  }
 
-  sprintf(command, "%s=\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,%d,%d", SARA_R5_AIDING_SERVER_CONFIGURATION,
-          primaryServer, secondaryServer, authToken,
-          days, period, resolution, gnssTypes, mode, dataType);
+  SARA_R5_location_request *request = &_locationRequests[_numLocationRequests];
+  request->id = _nextLocationRequestID;
+  request->active = false;
+  request->cancelled = false;
+  request->timeout = (timeout > 999) ? 999 : timeout;
+  request->accuracy = accuracy;
+  request->detailed = detailed;
+  request->sensor = sensor;
+  request->startTime = 0;
+  request->callback = locationCallback;
+  request->context = context;
+  _numLocationRequests++;
 
-  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
-                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+  _nextLocationRequestID++;
+  if (_nextLocationRequestID < 0) // Wrap around without going negative
+    _nextLocationRequestID = 0;
 
-  free(command);
-  return err;
+  return request->id;
 }
 
-
-// OK for text files. But will fail with binary files (containing \0) on some platforms.
-SARA_R5_error_t SARA_R5::appendFileContents(String filename, const char *str, int len)
+SARA_R5_error_t SARA_R5::gpsRequestCancel(int requestID)
 {
-  char *command;
-  char *response;
-  SARA_R5_error_t err;
+  SARA_R5_LOCK();
 
-  command = sara_r5_calloc_char(strlen(SARA_R5_FILE_SYSTEM_DOWNLOAD_FILE) + filename.length() + 10);
-  if (command == nullptr)
-    return SARA_R5_ERROR_OUT_OF_MEMORY;
+  for (uint8_t i = 0; i < _numLocationRequests; i++)
+  {
+    if (_locationRequests[i].id == requestID)
+    {
+      if (_locationRequests[i].active)
+      {
+        // The +ULOC can't be recalled. Keep the slot until the +UULOC (or the deadline) arrives
+        _locationRequests[i].cancelled = true;
+      }
+      else
+      {
+        for (uint8_t j = i + 1; j < _numLocationRequests; j++)
+          _locationRequests[j - 1] = _locationRequests[j];
+        _numLocationRequests--;
+      }
+      return SARA_R5_ERROR_SUCCESS;
+    }
+  }
+  return SARA_R5_ERROR_INVALID;
+}
+
+uint8_t SARA_R5::gpsRequestsPending(void)
+{
+  SARA_R5_LOCK();
+
+  uint8_t pending = 0;
+  for (uint8_t i = 0; i < _numLocationRequests; i++)
+  {
+    if (!_locationRequests[i].cancelled)
+      pending++;
+  }
+  return pending;
+}
+
+SARA_R5_error_t SARA_R5::gpsAidingServerConf(const char *primaryServer, const char *secondaryServer, const char *authToken,
+                                             unsigned int days, unsigned int period, unsigned int resolution,
+                                             unsigned int gnssTypes, unsigned int mode, unsigned int dataType)
+{
+  SARA_R5_error_t err;
+  char *command;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_AIDING_SERVER_CONFIGURATION) + 256);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
+
+  sprintf(command, "%s=\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,%d,%d", SARA_R5_AIDING_SERVER_CONFIGURATION,
+          primaryServer, secondaryServer, authToken,
+          days, period, resolution, gnssTypes, mode, dataType);
+
+  err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
+                                SARA_R5_STANDARD_RESPONSE_TIMEOUT);
+
+  sara_r5_free(command);
+  return err;
+}
+
+
+// OK for text files. But will fail with binary files (containing \0) on some platforms.
+SARA_R5_error_t SARA_R5::appendFileContents(String filename, const char *str, int len)
+{
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
+  char *command;
+  char *response;
+  SARA_R5_error_t err;
+
+  command = sara_r5_calloc_char(strlen(SARA_R5_FILE_SYSTEM_DOWNLOAD_FILE) + filename.length() + 10);
+  if (command == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
   int dataLen = len == -1 ? strlen(str) : len;
@@ -5306,7 +8380,7 @@ SARA_R5_error_t SARA_R5::appendFileContents(String filename, const char *str, in
 
   if (err == SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       _debugPort->print(F("fileDownload: writing "));
       _debugPort->print(dataLen);
@@ -5318,7 +8392,7 @@ SARA_R5_error_t SARA_R5::appendFileContents(String filename, const char *str, in
   }
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("fileDownload: Error: "));
       _debugPort->print(err);
@@ -5328,8 +8402,8 @@ SARA_R5_error_t SARA_R5::appendFileContents(String filename, const char *str, in
     }
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -5351,7 +8425,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
   err = getFileSize(filename, &fileSize);
   if (err != SARA_R5_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: getFileSize returned err "));
       _debugPort->println(err);
@@ -5367,12 +8441,12 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
   response = sara_r5_calloc_char(fileSize + minimumResponseAllocation);
   if (response == nullptr)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: response alloc failed: "));
       _debugPort->println(fileSize + minimumResponseAllocation);
     }
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -5386,13 +8460,13 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
 
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: sendCommandWithResponse returned err "));
       _debugPort->println(err);
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
@@ -5412,12 +8486,12 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
 
       if (searchPtr == nullptr)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_ERROR_ENABLED)
         {
           _debugPort->println(F("getFileContents: third quote not found!"));
         }
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
 
@@ -5432,7 +8506,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
         contents->concat(*(searchPtr)); // Append file char to contents
         bytesRead++;
       }
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
       {
         _debugPort->print(F("getFileContents: total bytes read: "));
         _debugPort->println(bytesRead);
@@ -5441,7 +8515,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
     }
     else
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("getFileContents: sscanf failed! scanned is "));
         _debugPort->println(scanned);
@@ -5451,13 +8525,13 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, String *contents)
   }
   else
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
       _debugPort->println(F("getFileContents: strstr failed!"));
     err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -5473,7 +8547,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
   err = getFileSize(filename, &fileSize);
   if (err != SARA_R5_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: getFileSize returned err "));
       _debugPort->println(err);
@@ -5489,12 +8563,12 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
   response = sara_r5_calloc_char(fileSize + minimumResponseAllocation);
   if (response == nullptr)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: response alloc failed: "));
       _debugPort->println(fileSize + minimumResponseAllocation);
     }
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -5508,13 +8582,13 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
 
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileContents: sendCommandWithResponse returned err "));
       _debugPort->println(err);
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
@@ -5534,12 +8608,12 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
 
       if (searchPtr == nullptr)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_ERROR_ENABLED)
         {
           _debugPort->println(F("getFileContents: third quote not found!"));
         }
-        free(command);
-        free(response);
+        sara_r5_free(command);
+        sara_r5_free(response);
         return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
       }
 
@@ -5551,7 +8625,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
         contents[bytesRead] = *searchPtr; // Append file char to contents
         bytesRead++;
       }
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
       {
         _debugPort->print(F("getFileContents: total bytes read: "));
         _debugPort->println(bytesRead);
@@ -5560,7 +8634,7 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
     }
     else
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_ERROR_ENABLED)
       {
         _debugPort->print(F("getFileContents: sscanf failed! scanned is "));
         _debugPort->println(scanned);
@@ -5570,18 +8644,23 @@ SARA_R5_error_t SARA_R5::getFileContents(String filename, char *contents)
   }
   else
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
       _debugPort->println(F("getFileContents: strstr failed!"));
     err = SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
 SARA_R5_error_t SARA_R5::getFileBlock(const String& filename, char* buffer, size_t offset, size_t requested_length, size_t& bytes_read)
 {
+  SARA_R5_LOCK();
+
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // Sending anything would abort the scan
+
   bytes_read = 0;
   if (filename.length() < 1 || buffer == nullptr || requested_length < 1)
   {
@@ -5592,7 +8671,7 @@ SARA_R5_error_t SARA_R5::getFileBlock(const String& filename, char* buffer, size
   // a real UART.
   if (_hardSerial == nullptr)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->println(F("getFileBlock: only works with a hardware UART"));
     }
@@ -5601,6 +8680,8 @@ SARA_R5_error_t SARA_R5::getFileBlock(const String& filename, char* buffer, size
 
   size_t cmd_len = filename.length() + 32;
   char* cmd = sara_r5_calloc_char(cmd_len);
+  if (cmd == nullptr)
+    return SARA_R5_ERROR_OUT_OF_MEMORY;
   sprintf(cmd, "at+urdblock=\"%s\",%zu,%zu\r\n", filename.c_str(), offset, requested_length);
   sendCommand(cmd, false);
 
@@ -5634,7 +8715,7 @@ SARA_R5_error_t SARA_R5::getFileBlock(const String& filename, char* buffer, size
   // Example response:
   // +URDBLOCK: "wombat.bin",64000,"<data starts here>... "<cr><lf>
   size_t data_length = strtoul(&cmd[comma_idx], nullptr, 10);
-  free(cmd);
+  sara_r5_free(cmd);
 
   bytes_read = 0;
   size_t bytes_remaining = data_length;
@@ -5663,14 +8744,14 @@ SARA_R5_error_t SARA_R5::getFileSize(String filename, int *size)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileSize: Fail: Error: "));
       _debugPort->print(err);
@@ -5678,22 +8759,22 @@ SARA_R5_error_t SARA_R5::getFileSize(String filename, int *size)
       _debugPort->print(response);
       _debugPort->println(F("}"));
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
   char *responseStart = strstr(response, "+ULSTFILE:");
   if (responseStart == nullptr)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("getFileSize: Failure: {"));
       _debugPort->print(response);
       _debugPort->println(F("}"));
     }
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
@@ -5703,8 +8784,8 @@ SARA_R5_error_t SARA_R5::getFileSize(String filename, int *size)
   sscanf(responseStart, "%d", &fileSize);
   *size = fileSize;
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
   return err;
 }
 
@@ -5722,14 +8803,14 @@ SARA_R5_error_t SARA_R5::deleteFile(String filename)
 
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
     {
       _debugPort->print(F("deleteFile: Fail: Error: "));
       _debugPort->println(err);
     }
   }
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -5744,10 +8825,12 @@ SARA_R5_error_t SARA_R5::modulePowerOff(void)
 
   sprintf(command, "%s", SARA_R5_COMMAND_POWER_OFF);
 
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN;
+
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR, nullptr,
                                 SARA_R5_POWER_OFF_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
   return err;
 }
 
@@ -5759,7 +8842,7 @@ void SARA_R5::modulePowerOn(void)
   }
   else
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
       _debugPort->println(F("modulePowerOn: not supported. _powerPin not defined."));
   }
 }
@@ -5774,16 +8857,22 @@ SARA_R5_error_t SARA_R5::init(unsigned long baud,
   int retries = _maxInitTries;
   SARA_R5_error_t err = SARA_R5_ERROR_SUCCESS;
 
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN; // The module could have been reset or power cycled
+  resetNetworkState();
+  _operatorScanActive = false;
+  if (_connectionState == SARA_R5_CONNECTION_CONNECTED)
+    _connectionLost = true; // Any sockets are gone. Re-attach from bufferedPoll
+
   beginSerial(baud);
 
   do
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
       _debugPort->println(F("init: Begin module init."));
 
     if (initType == SARA_R5_INIT_AUTOBAUD)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
         _debugPort->println(F("init: Attempting autobaud connection to module."));
 
       err = autobaud(baud);
@@ -5794,7 +8883,7 @@ SARA_R5_error_t SARA_R5::init(unsigned long baud,
     }
     else if (initType == SARA_R5_INIT_RESET)
     {
-      if (_printDebug == true)
+      if (SARA_R5_LOG_DEBUG_ENABLED)
         _debugPort->println(F("init: Power cycling module."));
 
       powerOff();
@@ -5814,7 +8903,7 @@ SARA_R5_error_t SARA_R5::init(unsigned long baud,
       err = enableEcho(false); // = disableEcho
       if (err != SARA_R5_ERROR_SUCCESS)
       {
-        if (_printDebug == true)
+        if (SARA_R5_LOG_ERROR_ENABLED)
           _debugPort->println(F("init: Module failed echo test."));
         initType =  SARA_R5_INIT_AUTOBAUD;
       }
@@ -5824,12 +8913,12 @@ SARA_R5_error_t SARA_R5::init(unsigned long baud,
 
   // we tried but seems failed
   if (err != SARA_R5_ERROR_SUCCESS) {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_ERROR_ENABLED)
       _debugPort->println(F("init: Module failed to init. Exiting."));
     return (SARA_R5_ERROR_NO_RESPONSE);
   }
 
-  if (_printDebug == true)
+  if (SARA_R5_LOG_DEBUG_ENABLED)
     _debugPort->println(F("init: Module responded successfully."));
 
   _baud = baud;
@@ -5855,6 +8944,7 @@ void SARA_R5::invertPowerPin(bool invert)
 // Note: +CPWROFF () is preferred to this.
 void SARA_R5::powerOff(void)
 {
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN;
   if (_powerPin >= 0)
   {
     if (_invertPowerPin) // Set the pin state before making it an output
@@ -5868,13 +8958,14 @@ void SARA_R5::powerOff(void)
       digitalWrite(_powerPin, LOW);
     delay(SARA_R5_POWER_OFF_PULSE_PERIOD);
     pinMode(_powerPin, INPUT); // Return to high-impedance, rely on (e.g.) SARA module internal pull-up
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
       _debugPort->println(F("powerOff: complete"));
   }
 }
 
 void SARA_R5::powerOn(void)
 {
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN;
   if (_powerPin >= 0)
   {
     if (_invertPowerPin) // Set the pin state before making it an output
@@ -5889,7 +8980,7 @@ void SARA_R5::powerOn(void)
     delay(SARA_R5_POWER_ON_PULSE_PERIOD);
     pinMode(_powerPin, INPUT); // Return to high-impedance, rely on (e.g.) SARA module internal pull-up
     //delay(2000);               // Do this in init. Wait before sending AT commands to module. 100 is too short.
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
       _debugPort->println(F("powerOn: complete"));
   }
 }
@@ -5899,6 +8990,7 @@ void SARA_R5::powerOn(void)
 //You cannot use this function on the SparkFun Asset Tracker and RESET_N is tied to the MicroMod processor !RESET!...
 void SARA_R5::hwReset(void)
 {
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN;
   if ((_resetPin >= 0) && (_powerPin >= 0))
   {
     digitalWrite(_resetPin, HIGH); // Start by making sure the RESET_N pin is high
@@ -5952,10 +9044,12 @@ SARA_R5_error_t SARA_R5::functionality(SARA_R5_functionality_t function)
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   sprintf(command, "%s=%d", SARA_R5_COMMAND_FUNC, function);
 
+  _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN; // +CFUN can reset the module or power down the GNSS
+
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_3_MIN_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
 
   return err;
 }
@@ -5976,7 +9070,7 @@ SARA_R5_error_t SARA_R5::setMNOprofile(mobile_network_operator_t mno, bool autoR
   err = sendCommandWithResponse(command, SARA_R5_RESPONSE_OK_OR_ERROR,
                                 nullptr, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
 
-  free(command);
+  sara_r5_free(command);
 
   return err;
 }
@@ -6000,7 +9094,7 @@ SARA_R5_error_t SARA_R5::getMNOprofile(mobile_network_operator_t *mno)
   response = sara_r5_calloc_char(minimumResponseAllocation);
   if (response == nullptr)
   {
-    free(command);
+    sara_r5_free(command);
     return SARA_R5_ERROR_OUT_OF_MEMORY;
   }
 
@@ -6008,8 +9102,8 @@ SARA_R5_error_t SARA_R5::getMNOprofile(mobile_network_operator_t *mno)
                                 response, SARA_R5_STANDARD_RESPONSE_TIMEOUT);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(command);
-    free(response);
+    sara_r5_free(command);
+    sara_r5_free(response);
     return err;
   }
 
@@ -6025,7 +9119,7 @@ SARA_R5_error_t SARA_R5::getMNOprofile(mobile_network_operator_t *mno)
 
   if (scanned >= 1)
   {
-    if (_printDebug == true)
+    if (SARA_R5_LOG_DEBUG_ENABLED)
     {
       _debugPort->print(F("getMNOprofile: MNO is: "));
       _debugPort->println(o);
@@ -6037,14 +9131,16 @@ SARA_R5_error_t SARA_R5::getMNOprofile(mobile_network_operator_t *mno)
     err = SARA_R5_ERROR_INVALID;
   }
 
-  free(command);
-  free(response);
+  sara_r5_free(command);
+  sara_r5_free(response);
 
   return err;
 }
 
 SARA_R5_error_t SARA_R5::waitForResponse(const char *expectedResponse, const char *expectedError, uint16_t timeout)
 {
+  SARA_R5_LOCK();
+
   unsigned long timeIn;
   bool found = false;
   bool error = false;
@@ -6056,12 +9152,15 @@ SARA_R5_error_t SARA_R5::waitForResponse(const char *expectedResponse, const cha
   int responseLen = (int)strlen(expectedResponse);
   int errorLen = (int)strlen(expectedError);
 
+  if (_operatorScanActive)
+    return SARA_R5_ERROR_BUSY; // The response would be read as part of the scan
+
   while ((!found) && ((timeIn + timeout) > millis()))
   {
     if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is nullptr
     {
       char c = readChar();
-      // if (_printDebug == true)
+      // if (SARA_R5_LOG_DEBUG_ENABLED)
       // {
       //   if (printedSomething == false)
       //     _debugPort->print(F("waitForResponse: "));
@@ -6097,27 +9196,35 @@ SARA_R5_error_t SARA_R5::waitForResponse(const char *expectedResponse, const cha
       //The backlog is only used by bufferedPoll to process the URCs - which are all readable.
       //bufferedPoll uses strtok - which does not like nullptr characters.
       //So let's make sure no NULLs end up in the backlog!
-      if (_saraResponseBacklogLength < _RXBuffSize) // Don't overflow the buffer
+      if (_saraResponseBacklogLength < (_RXBuffSize - 1)) // Don't overflow the buffer. Leave room for the NULL
       {
         if (c == '\0')
           _saraResponseBacklog[_saraResponseBacklogLength++] = '0'; // Change NULLs to ASCII Zeros
         else
           _saraResponseBacklog[_saraResponseBacklogLength++] = c;
       }
+      else
+      {
+        backlogOverflow(1);
+      }
     } else {
       yield();
     }
   }
 
-  // if (_printDebug == true)
+  // if (SARA_R5_LOG_DEBUG_ENABLED)
   //   if (printedSomething)
   //     _debugPort->println();
 
   pruneBacklog(); // Prune any incoming non-actionable URC's and responses/errors from the backlog
 
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  recordCommandStats(true, millis() - timeIn, (found == true) ? ((error == true) ? SARA_R5_ERROR_ERROR : SARA_R5_ERROR_SUCCESS) : SARA_R5_ERROR_NO_RESPONSE);
+#endif
+
   if (found == true)
   {
-    if (true == _printAtDebug) {
+    if (SARA_R5_LOG_AT_ENABLED) {
       _debugAtPort->print((error == true) ? expectedError : expectedResponse);
     }
 
@@ -6131,6 +9238,8 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
     const char *command, const char *expectedResponse, char *responseDest,
     unsigned long commandTimeout, int destSize, bool at)
 {
+  SARA_R5_LOCK();
+
   bool found = false;
   bool error = false;
   int responseIndex = 0;
@@ -6143,12 +9252,19 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
   bool printResponse = false; // Change to true to print the full response
   bool printedSomething = false;
 
-  if (_printDebug == true)
+  if (SARA_R5_LOG_DEBUG_ENABLED)
   {
     _debugPort->print(F("sendCommandWithResponse: Command: "));
     _debugPort->println(String(command));
   }
 
+  if (_operatorScanActive)
+  {
+    if (SARA_R5_LOG_DEBUG_ENABLED)
+      _debugPort->println(F("sendCommandWithResponse: operator scan in progress"));
+    return SARA_R5_ERROR_BUSY; // Sending a command would abort the scan
+  }
+
   sendCommand(command, at); //Sending command needs to dump data to backlog buffer as well.
   unsigned long timeIn = millis();
   if (SARA_R5_RESPONSE_OK_OR_ERROR == expectedResponse) {
@@ -6165,7 +9281,7 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
     if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is nullptr
     {
       char c = readChar();
-      if ((printResponse = true) && (_printDebug == true))
+      if ((printResponse == true) && SARA_R5_LOG_DEBUG_ENABLED)
       {
         if (printedSomething == false)
         {
@@ -6181,12 +9297,12 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
         destIndex++;
         if (destIndex == destSize)
         {
-          if (_printDebug == true)
+          if (SARA_R5_LOG_ERROR_ENABLED)
           {
-            if ((printResponse = true) && (printedSomething))
+            if ((printResponse == true) && (printedSomething))
               _debugPort->println();
             _debugPort->print(F("sendCommandWithResponse: Panic! responseDest is full!"));
-            if ((printResponse = true) && (printedSomething))
+            if ((printResponse == true) && (printedSomething))
               _debugPort->print(F("sendCommandWithResponse: Ignored response: "));
           }
         }
@@ -6221,27 +9337,36 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
       //The backlog is only used by bufferedPoll to process the URCs - which are all readable.
       //bufferedPoll uses strtok - which does not like NULL characters.
       //So let's make sure no NULLs end up in the backlog!
-      if (_saraResponseBacklogLength < _RXBuffSize) // Don't overflow the buffer
+      if (_saraResponseBacklogLength < (_RXBuffSize - 1)) // Don't overflow the buffer. Leave room for the NULL
       {
         if (c == '\0')
           _saraResponseBacklog[_saraResponseBacklogLength++] = '0'; // Change NULLs to ASCII Zeros
         else
           _saraResponseBacklog[_saraResponseBacklogLength++] = c;
       }
+      else
+      {
+        backlogOverflow(1);
+      }
     } else {
       yield();
     }
   }
 
-  if (_printDebug == true)
-    if ((printResponse = true) && (printedSomething))
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+    if ((printResponse == true) && (printedSomething))
       _debugPort->println();
 
   pruneBacklog(); // Prune any incoming non-actionable URC's and responses/errors from the backlog
 
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  // A response which did not match before the timeout counts as a timeout
+  recordCommandStats(false, millis() - timeIn, found ? (error ? SARA_R5_ERROR_ERROR : SARA_R5_ERROR_SUCCESS) : SARA_R5_ERROR_NO_RESPONSE);
+#endif
+
   if (found)
   {
-    if ((true == _printAtDebug) && ((nullptr != responseDest) || (nullptr != expectedResponse))) {
+    if (SARA_R5_LOG_AT_ENABLED && ((nullptr != responseDest) || (nullptr != expectedResponse))) {
       _debugAtPort->print((nullptr != responseDest) ? responseDest : expectedResponse);
     }
     return error ? SARA_R5_ERROR_ERROR : SARA_R5_ERROR_SUCCESS;
@@ -6252,7 +9377,7 @@ SARA_R5_error_t SARA_R5::sendCommandWithResponse(
   }
   else
   {
-    if ((true == _printAtDebug) && (nullptr != responseDest)) {
+    if (SARA_R5_LOG_AT_ENABLED && (nullptr != responseDest)) {
       _debugAtPort->print(responseDest);
     }
     return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
@@ -6267,8 +9392,74 @@ SARA_R5_error_t SARA_R5::sendCustomCommandWithResponse(const char *command, cons
   return sendCommandWithResponse(command, expectedResponse, responseDest, commandTimeout, 32766, at);
 }
 
+SARA_R5_error_t SARA_R5::readResponseLine(char *dest, size_t destSize, size_t *length, unsigned long timeout)
+{
+  size_t destIndex = 0;
+  unsigned long timeIn = millis();
+
+  *length = 0;
+  if (destSize > 0)
+    dest[0] = '\0';
+
+  while ((millis() - timeIn) < timeout)
+  {
+    if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is NULL
+    {
+      char c = readChar();
+      timeIn = millis();
+      if (c == '\n')
+      {
+        if ((destIndex > 0) && (dest[destIndex - 1] == '\r')) // Remove the CR
+          destIndex--;
+        if (destSize > 0)
+          dest[destIndex] = '\0';
+        *length = destIndex;
+        if (SARA_R5_LOG_AT_ENABLED && (destSize > 0))
+        {
+          _debugAtPort->println(dest);
+        }
+        return SARA_R5_ERROR_SUCCESS;
+      }
+      if ((destIndex + 1) < destSize) // Discard the char if there is no room for it
+        dest[destIndex++] = c;
+    }
+    else
+    {
+      yield();
+    }
+  }
+
+  if (destSize > 0)
+    dest[destIndex] = '\0';
+  *length = destIndex;
+  return SARA_R5_ERROR_TIMEOUT;
+}
+
+void SARA_R5::appendToBacklog(const char *line, size_t length)
+{
+  if ((_saraResponseBacklogLength + length + 2) < (size_t)_RXBuffSize) // Leave room for the NULL
+  {
+    memcpy(&_saraResponseBacklog[_saraResponseBacklogLength], line, length);
+    _saraResponseBacklogLength += length;
+    _saraResponseBacklog[_saraResponseBacklogLength++] = '\r';
+    _saraResponseBacklog[_saraResponseBacklogLength++] = '\n';
+  }
+  else
+  {
+    backlogOverflow(length + 2);
+  }
+}
+
 void SARA_R5::sendCommand(const char *command, bool at)
 {
+  if (_operatorScanActive)
+  {
+    // Any character would abort +COPS=? - and the scan is reading the serial data
+    if (SARA_R5_LOG_ERROR_ENABLED)
+      _debugPort->println(F("sendCommand: operator scan in progress. Command not sent"));
+    return;
+  }
+
   //Check for incoming serial data. Copy it into the backlog
 
   // Important note:
@@ -6280,7 +9471,7 @@ void SARA_R5::sendCommand(const char *command, bool at)
   unsigned long timeIn = millis();
   if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is NULL
   {
-    while (((millis() - timeIn) < _rxWindowMillis) && (_saraResponseBacklogLength < _RXBuffSize)) //May need to escape on newline?
+    while (((millis() - timeIn) < _rxWindowMillis) && (_saraResponseBacklogLength < (_RXBuffSize - 1))) //May need to escape on newline?
     {
       if (hwAvailable() > 0) //hwAvailable can return -1 if the serial port is NULL
       {
@@ -6301,6 +9492,20 @@ void SARA_R5::sendCommand(const char *command, bool at)
     }
   }
 
+  if (at)
+    wakeModule(); // Data (at == false) follows a prompt, so the module is already awake
+
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  uint8_t prefixLength = 0;
+  while ((command[prefixLength] != '\0') && (command[prefixLength] != '=') && (command[prefixLength] != '?') &&
+         (prefixLength < (SARA_R5_COMMAND_STATS_PREFIX_LENGTH - 2))) // Leave room for the '>'
+  {
+    _statsPrefix[prefixLength] = command[prefixLength];
+    prefixLength++;
+  }
+  _statsPrefix[prefixLength] = '\0';
+#endif
+
   //Now send the command
   if (at)
   {
@@ -6324,8 +9529,10 @@ SARA_R5_error_t SARA_R5::parseSocketReadIndication(int socket, int length)
     return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  // Return now if both callbacks pointers are nullptr - otherwise the data will be read and lost!
-  if ((_socketReadCallback == nullptr) && (_socketReadCallbackPlus == nullptr))
+  bool rtcmFraming = (socket == _rtcmFramingSocket) && (_rtcmFramer != nullptr);
+
+  // Return now if all of the callbacks pointers are nullptr - otherwise the data will be read and lost!
+  if ((!socketReadCallbackSet()) && (!rtcmFraming))
     return SARA_R5_ERROR_INVALID;
 
   readDest = sara_r5_calloc_char(length + 1);
@@ -6336,30 +9543,22 @@ SARA_R5_error_t SARA_R5::parseSocketReadIndication(int socket, int length)
   err = socketRead(socket, length, readDest, &bytesRead);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(readDest);
+    sara_r5_free(readDest);
     return err;
   }
 
-  if (_socketReadCallback != nullptr)
+  if (rtcmFraming) // Pass the data to the framer instead of the read callbacks
   {
-    String dataAsString = ""; // Create an empty string
-    // Copy the data from readDest into the String in a binary-compatible way
-    // Important Note: some implementations of concat, like the one on ESP32, are binary-compatible.
-    // But some, like SAMD, are not. They use strlen or strcpy internally - which don't like \0's.
-    // The only true binary-compatible solution is to use socketReadCallbackPlus...
-    for (int i = 0; i < bytesRead; i++)
-      dataAsString.concat(readDest[i]);
-    _socketReadCallback(socket, dataAsString);
+    _rtcmFramer->process((const uint8_t *)readDest, bytesRead);
+    sara_r5_free(readDest);
+    return SARA_R5_ERROR_SUCCESS;
   }
 
-  if (_socketReadCallbackPlus != nullptr)
-  {
-    IPAddress dummyAddress = { 0, 0, 0, 0 };
-    int dummyPort = 0;
-    _socketReadCallbackPlus(socket, (const char *)readDest, bytesRead, dummyAddress, dummyPort);
-  }
+  IPAddress dummyAddress = { 0, 0, 0, 0 };
+  int dummyPort = 0;
+  callSocketReadCallbacks(socket, (const char *)readDest, bytesRead, dummyAddress, dummyPort);
 
-  free(readDest);
+  sara_r5_free(readDest);
   return SARA_R5_ERROR_SUCCESS;
 }
 
@@ -6375,8 +9574,11 @@ SARA_R5_error_t SARA_R5::parseSocketReadIndicationUDP(int socket, int length)
     return SARA_R5_ERROR_UNEXPECTED_RESPONSE;
   }
 
-  // Return now if both callbacks pointers are nullptr - otherwise the data will be read and lost!
-  if ((_socketReadCallback == nullptr) && (_socketReadCallbackPlus == nullptr))
+  bool rtcmFraming = (socket == _rtcmFramingSocket) && (_rtcmFramer != nullptr);
+  bool sntp = (socket == _sntpSocket);
+
+  // Return now if all of the callbacks pointers are nullptr - otherwise the data will be read and lost!
+  if ((!socketReadCallbackSet()) && (!rtcmFraming) && (!sntp))
     return SARA_R5_ERROR_INVALID;
 
   readDest = sara_r5_calloc_char(length + 1);
@@ -6389,27 +9591,27 @@ SARA_R5_error_t SARA_R5::parseSocketReadIndicationUDP(int socket, int length)
   err = socketReadUDP(socket, length, readDest, &remoteAddress, &remotePort, &bytesRead);
   if (err != SARA_R5_ERROR_SUCCESS)
   {
-    free(readDest);
+    sara_r5_free(readDest);
     return err;
   }
 
-  if (_socketReadCallback != nullptr)
+  if (sntp) // SNTP responses are not passed to the read callbacks
   {
-    String dataAsString = ""; // Create an empty string
-    // Important Note: some implementations of concat, like the one on ESP32, are binary-compatible.
-    // But some, like SAMD, are not. They use strlen or strcpy internally - which don't like \0's.
-    // The only true binary-compatible solution is to use socketReadCallbackPlus...
-    for (int i = 0; i < bytesRead; i++) // Copy the data from readDest into the String in a binary-compatible way
-      dataAsString.concat(readDest[i]);
-    _socketReadCallback(socket, dataAsString);
+    processSNTPResponse((const uint8_t *)readDest, bytesRead, remoteAddress);
+    sara_r5_free(readDest);
+    return SARA_R5_ERROR_SUCCESS;
   }
 
-  if (_socketReadCallbackPlus != nullptr)
+  if (rtcmFraming) // Pass the data to the framer instead of the read callbacks
   {
-    _socketReadCallbackPlus(socket, (const char *)readDest, bytesRead, remoteAddress, remotePort);
+    _rtcmFramer->process((const uint8_t *)readDest, bytesRead);
+    sara_r5_free(readDest);
+    return SARA_R5_ERROR_SUCCESS;
   }
 
-  free(readDest);
+  callSocketReadCallbacks(socket, (const char *)readDest, bytesRead, remoteAddress, remotePort);
+
+  sara_r5_free(readDest);
   return SARA_R5_ERROR_SUCCESS;
 }
 
@@ -6418,10 +9620,7 @@ SARA_R5_error_t SARA_R5::parseSocketListenIndication(int listeningSocket, IPAddr
   _lastLocalIP = localIP;
   _lastRemoteIP = remoteIP;
 
-  if (_socketListenCallback != nullptr)
-  {
-    _socketListenCallback(listeningSocket, localIP, listeningPort, socket, remoteIP, port);
-  }
+  callSocketListenCallback(listeningSocket, localIP, listeningPort, socket, remoteIP, port);
 
   return SARA_R5_ERROR_SUCCESS;
 }
@@ -6438,19 +9637,19 @@ SARA_R5_error_t SARA_R5::parseSocketCloseIndication(String *closeIndication)
   // Socket will be first integer, should be single-digit number between 0-6:
   socket = closeIndication->substring(search, search + 1).toInt();
 
-  if (_socketCloseCallback != nullptr)
-  {
-    _socketCloseCallback(socket);
-  }
+  callSocketCloseCallback(socket);
 
   return SARA_R5_ERROR_SUCCESS;
 }
 
 size_t SARA_R5::hwPrint(const char *s)
 {
-  if ((true == _printAtDebug) && (nullptr != s)) {
+  _uartActivityMillis = millis();
+  if (SARA_R5_LOG_AT_ENABLED && (nullptr != s)) {
     _debugAtPort->print(s);
   }
+  if ((nullptr != _atTrace) && (nullptr != s))
+    traceAt(false, (const uint8_t *)s, strlen(s));
   if (_hardSerial != nullptr)
   {
     return _hardSerial->print(s);
@@ -6467,9 +9666,12 @@ size_t SARA_R5::hwPrint(const char *s)
 
 size_t SARA_R5::hwWriteData(const char *buff, int len)
 {
-  if ((true == _printAtDebug) && (nullptr != buff) && (0 < len) ) {
+  _uartActivityMillis = millis();
+  if (SARA_R5_LOG_AT_ENABLED && (nullptr != buff) && (0 < len) ) {
     _debugAtPort->write(buff,len);
   }
+  if ((nullptr != _atTrace) && (nullptr != buff) && (0 < len))
+    traceAt(false, (const uint8_t *)buff, len);
   if (_hardSerial != nullptr)
   {
     return _hardSerial->write((const uint8_t *)buff, len);
@@ -6485,9 +9687,12 @@ size_t SARA_R5::hwWriteData(const char *buff, int len)
 
 size_t SARA_R5::hwWrite(const char c)
 {
-  if (true == _printAtDebug) {
+  _uartActivityMillis = millis();
+  if (SARA_R5_LOG_AT_ENABLED) {
     _debugAtPort->write(c);
   }
+  if (nullptr != _atTrace)
+    traceAt(false, (const uint8_t *)&c, 1);
   if (_hardSerial != nullptr)
   {
     return _hardSerial->write(c);
@@ -6520,7 +9725,7 @@ int SARA_R5::readAvailable(char *inString)
     {
       inString[len] = 0;
     }
-    //if (_printDebug == true)
+    //if (SARA_R5_LOG_DEBUG_ENABLED)
     //  _debugPort->println(inString);
   }
 #ifdef SARA_R5_SOFTWARE_SERIAL_ENABLED
@@ -6541,6 +9746,9 @@ int SARA_R5::readAvailable(char *inString)
   }
 #endif
 
+  if ((nullptr != _atTrace) && (inString != nullptr))
+    traceAt(true, (const uint8_t *)inString, len);
+
   return len;
 }
 
@@ -6559,6 +9767,11 @@ char SARA_R5::readChar(void)
   }
 #endif
 
+  if (nullptr != _atTrace)
+    traceAt(true, (const uint8_t *)&ret, 1);
+
+  _uartActivityMillis = millis();
+
   return ret;
 }
 
@@ -6645,17 +9858,158 @@ SARA_R5_error_t SARA_R5::autobaud(unsigned long desiredBaud)
   return err;
 }
 
+#ifdef SARA_R5_HEAP_TRACKING
+// Each allocation is preceded by a header which records its length and tag, so sara_r5_free can account for it
+struct SARA_R5_heap_header
+{
+  uint32_t length;
+  uint16_t guard;
+  uint8_t tagIndex;
+  uint8_t spare;
+};
+
+char *SARA_R5::sara_r5_calloc_char(size_t num, const char *tag)
+{
+  SARA_R5_heap_header *header = (SARA_R5_heap_header *)calloc(num + SARA_R5_HEAP_HEADER_LENGTH, sizeof(char));
+  if (header == nullptr)
+  {
+    _heapStats.failures++;
+    return nullptr;
+  }
+
+  uint8_t index = heapTagIndex(tag);
+  header->length = num;
+  header->guard = SARA_R5_HEAP_GUARD;
+  header->tagIndex = index;
+
+  _heapStats.allocations++;
+  _heapStats.currentBytes += num;
+  if (_heapStats.currentBytes > _heapStats.peakBytes)
+    _heapStats.peakBytes = _heapStats.currentBytes;
+
+  SARA_R5_heap_tag *entry = &_heapTags[index];
+  entry->allocations++;
+  entry->currentBytes += num;
+  if (entry->currentBytes > entry->peakBytes)
+    entry->peakBytes = entry->currentBytes;
+
+  return ((char *)header) + SARA_R5_HEAP_HEADER_LENGTH;
+}
+
+void SARA_R5::sara_r5_free(void *ptr)
+{
+  if (ptr == nullptr)
+    return;
+
+  SARA_R5_heap_header *header = (SARA_R5_heap_header *)(((char *)ptr) - SARA_R5_HEAP_HEADER_LENGTH);
+  if ((header->guard != SARA_R5_HEAP_GUARD) || (header->tagIndex >= _numHeapTags))
+  {
+    _heapStats.badFrees++;
+    if (SARA_R5_LOG_ERROR_ENABLED)
+    {
+      _debugPort->println(F("sara_r5_free: bad guard. Double free?"));
+    }
+    return;
+  }
+
+  header->guard = 0; // Catch a second free of the same buffer
+
+  _heapStats.frees++;
+  _heapStats.currentBytes -= header->length;
+
+  SARA_R5_heap_tag *entry = &_heapTags[header->tagIndex];
+  entry->frees++;
+  entry->currentBytes -= header->length;
+
+  free(header);
+}
+
+uint8_t SARA_R5::heapTagIndex(const char *tag)
+{
+  if (tag == nullptr)
+    tag = "?";
+
+  for (uint8_t i = 0; i < _numHeapTags; i++)
+  {
+    if ((_heapTags[i].tag == tag) || (strcmp(_heapTags[i].tag, tag) == 0))
+      return i;
+  }
+
+  if (_numHeapTags < (SARA_R5_HEAP_TRACKING_TAGS - 1))
+  {
+    _heapTags[_numHeapTags].tag = tag;
+    return _numHeapTags++;
+  }
+
+  // The table is full. Use the last entry for everything else
+  _heapTags[SARA_R5_HEAP_TRACKING_TAGS - 1].tag = "*";
+  _numHeapTags = SARA_R5_HEAP_TRACKING_TAGS;
+  return SARA_R5_HEAP_TRACKING_TAGS - 1;
+}
+
+const SARA_R5_heap_tag *SARA_R5::getHeapTag(uint8_t index)
+{
+  if (index >= _numHeapTags)
+    return nullptr;
+  return &_heapTags[index];
+}
+
+void SARA_R5::resetHeapPeak(void)
+{
+  _heapStats.peakBytes = _heapStats.currentBytes;
+  for (uint8_t i = 0; i < _numHeapTags; i++)
+    _heapTags[i].peakBytes = _heapTags[i].currentBytes;
+}
+
+void SARA_R5::dumpHeapStats(Print &out)
+{
+  out.print(F("Heap: current "));
+  out.print(_heapStats.currentBytes);
+  out.print(F(" peak "));
+  out.print(_heapStats.peakBytes);
+  out.print(F(" allocations "));
+  out.print(_heapStats.allocations);
+  out.print(F(" frees "));
+  out.print(_heapStats.frees);
+  out.print(F(" failures "));
+  out.print(_heapStats.failures);
+  out.print(F(" bad frees "));
+  out.println(_heapStats.badFrees);
+  out.println(F("Function: current peak allocations frees"));
+  for (uint8_t i = 0; i < _numHeapTags; i++)
+  {
+    const SARA_R5_heap_tag *entry = &_heapTags[i];
+    out.print(entry->tag);
+    out.print(F(": "));
+    out.print(entry->currentBytes);
+    out.print(F(" "));
+    out.print(entry->peakBytes);
+    out.print(F(" "));
+    out.print(entry->allocations);
+    out.print(F(" "));
+    out.println(entry->frees);
+  }
+}
+#else
 char *SARA_R5::sara_r5_calloc_char(size_t num)
 {
   return (char *)calloc(num, sizeof(char));
 }
 
+void SARA_R5::sara_r5_free(void *ptr)
+{
+  free(ptr);
+}
+#endif
+
 //This prunes the backlog of non-actionable events. If new actionable events are added, you must modify the if statement.
 void SARA_R5::pruneBacklog()
 {
   char *event;
 
-  // if (_printDebug == true)
+  updateBacklogHighWater();
+
+  // if (SARA_R5_LOG_DEBUG_ENABLED)
   // {
   //   if (_saraResponseBacklogLength > 0) //Handy for debugging new parsing.
   //   {
@@ -6674,6 +10028,7 @@ void SARA_R5::pruneBacklog()
   _saraResponseBacklogLength = 0; // Zero the backlog length
 
   char *preservedEvent;
+  bool keepNextEvent = false;
   event = strtok_r(_saraResponseBacklog, "\r\n", &preservedEvent); // Look for an 'event' - something ending in \r\n
 
   while (event != nullptr) //If event is actionable, add it to pruneBuffer.
@@ -6686,13 +10041,19 @@ void SARA_R5::pruneBacklog()
         || (strstr(event, SARA_R5_GNSS_REQUEST_LOCATION_URC) != nullptr)
         || (strstr(event, SARA_R5_SIM_STATE_URC) != nullptr)
         || (strstr(event, SARA_R5_MESSAGE_PDP_ACTION_URC) != nullptr)
+        || (strstr(event, SARA_R5_MESSAGE_PDP_DEACTIVATED_URC) != nullptr)
         || (strstr(event, SARA_R5_HTTP_COMMAND_URC) != nullptr)
         || (strstr(event, SARA_R5_MQTT_COMMAND_URC) != nullptr)
         || (strstr(event, SARA_R5_PING_COMMAND_URC) != nullptr)
         || (strstr(event, SARA_R5_REGISTRATION_STATUS_URC) != nullptr)
         || (strstr(event, SARA_R5_EPSREGISTRATION_STATUS_URC) != nullptr)
-        || (strstr(event, SARA_R5_FTP_COMMAND_URC) != nullptr))
+        || (strstr(event, SARA_R5_FTP_COMMAND_URC) != nullptr)
+        || (strstr(event, SARA_R5_GNSS_ASSISTED_IND_URC) != nullptr)
+        || (strstr(event, SARA_R5_NEW_MESSAGE_STORED_URC) != nullptr)
+        || (strstr(event, SARA_R5_NEW_MESSAGE_URC) != nullptr)
+        || (keepNextEvent))
     {
+      keepNextEvent = (strstr(event, SARA_R5_NEW_MESSAGE_URC) != nullptr); // Keep the message which follows a +CMT too
       strcat(_pruneBuffer, event); // The URCs are all readable text so using strcat is OK
       strcat(_pruneBuffer, "\r\n"); // strtok blows away delimiter, but we want that for later.
       _saraResponseBacklogLength += strlen(event) + 2; // Add the length of this event to _saraResponseBacklogLength
@@ -6704,7 +10065,7 @@ void SARA_R5::pruneBacklog()
   memset(_saraResponseBacklog, 0, _RXBuffSize); //Clear out backlog buffer.
   memcpy(_saraResponseBacklog, _pruneBuffer, _saraResponseBacklogLength); //Copy the pruned buffer back into the backlog
 
-  // if (_printDebug == true)
+  // if (SARA_R5_LOG_DEBUG_ENABLED)
   // {
   //   if (_saraResponseBacklogLength > 0) //Handy for debugging new parsing.
   //   {
@@ -6719,61 +10080,469 @@ void SARA_R5::pruneBacklog()
   // }
 }
 
-// GPS Helper Functions:
-
-// Read a source string until a delimiter is hit, store the result in destination
-char *SARA_R5::readDataUntil(char *destination, unsigned int destSize,
-                             char *source, char delimiter)
+// Asynchronous tasks. Called by bufferedPoll once any URCs have been processed
+void SARA_R5::processAsyncTasks(void)
 {
+  if (_operatorScanActive)
+  {
+    processOperatorScan(); // The other tasks need to send commands. They will run when the scan is complete
+    return;
+  }
 
-  char *strEnd;
-  size_t len;
-
-  strEnd = strchr(source, delimiter);
+  processBacklogOverflow();
+  processLocationRequests();
+  processNewSMS();
+  processNetworkState();
+  processSignalHistory();
+  processConnectionManager();
+  processClockModel();
+  processSNTP();
+  processUartPowerSaving();
+}
 
-  if (strEnd != nullptr)
+// Release DTR once the UART is idle, so the module can sleep
+void SARA_R5::processUartPowerSaving(void)
+{
+  if ((_upsvMode == SARA_R5_UPSV_DTR) && _dtrAsserted && ((millis() - _uartActivityMillis) >= SARA_R5_UPSV_DTR_HOLD))
   {
-    len = strEnd - source;
-    memset(destination, 0, destSize);
-    memcpy(destination, source, len);
+    digitalWrite(_dtrPin, HIGH); // OFF
+    _dtrAsserted = false;
   }
+}
 
-  return strEnd;
+// Resync the clock model from +CCLK
+void SARA_R5::processClockModel(void)
+{
+  if ((_clockResyncInterval == 0) || ((_clockValid) && ((millis() - _clockBaseMillis) < _clockResyncInterval)))
+    return;
+  if ((_clockResyncAttempted) && ((millis() - _clockResyncAttemptMillis) < _clockResyncInterval))
+    return; // Don't retry immediately if the last sync failed
+
+  _clockResyncAttempted = true;
+  _clockResyncAttemptMillis = millis();
+  syncClock();
 }
 
-bool SARA_R5::parseGPRMCString(char *rmcString, PositionData *pos,
-                               ClockData *clk, SpeedData *spd)
+// Drive the connection manager state machine
+void SARA_R5::processConnectionManager(void)
 {
-  char *ptr, *search;
-  unsigned long tTemp;
-  char tempData[TEMP_NMEA_DATA_SIZE];
+  switch (_connectionState)
+  {
+  case SARA_R5_CONNECTION_STOPPED:
+    return;
 
-  // if (_printDebug == true)
-  // {
-  //   _debugPort->println(F("parseGPRMCString: rmcString: "));
-  //   _debugPort->println(rmcString);
-  // }
+  case SARA_R5_CONNECTION_REGISTERING:
+    // The network state is kept up to date by the +CEREG URCs. Poll occasionally in case one was missed
+    if ((!isRegistered()) && ((millis() - _connectionStateMillis) >= SARA_R5_CONNECTION_POLL_INTERVAL))
+    {
+      _connectionStateMillis = millis();
+      registration(true);
+    }
+    if (isRegistered())
+    {
+      _connectionActivationResult = -1;
+      setConnectionState(SARA_R5_CONNECTION_ACTIVATING);
+      if (performPDPaction(_connectionProfile, SARA_R5_PSD_ACTION_ACTIVATE) != SARA_R5_ERROR_SUCCESS)
+        connectionFailed();
+    }
+    return;
 
-  // Fast-forward test to first value:
-  ptr = strchr(rmcString, ',');
-  ptr++; // Move ptr past first comma
+  case SARA_R5_CONNECTION_ACTIVATING:
+    if (_connectionActivationResult == 0)
+    {
+      _connectionBackoff = SARA_R5_CONNECTION_BACKOFF_MIN;
+      _connectionLost = false;
+      setConnectionState(SARA_R5_CONNECTION_CONNECTED);
+      openManagedSockets();
+    }
+    else if (_connectionActivationResult > 0)
+    {
+      connectionFailed();
+    }
+    else if ((millis() - _connectionStateMillis) >= SARA_R5_CONNECTION_ACTIVATION_TIMEOUT)
+    {
+      // No +UUPSDA. Check for an IP address instead
+      IPAddress address(0, 0, 0, 0);
+      if ((getNetworkAssignedIPAddress(_connectionProfile, &address) == SARA_R5_ERROR_SUCCESS) && (address[0] != 0))
+        _connectionActivationResult = 0; // Connected on the next pass
+      else
+        connectionFailed();
+    }
+    return;
 
-  // If the next character is another comma, there's no time data
-  // Find time:
-  search = readDataUntil(tempData, TEMP_NMEA_DATA_SIZE, ptr, ',');
-  // Next comma should be present and not the next position
-  if ((search != nullptr) && (search != ptr))
-  {
-    pos->utc = atof(tempData);                             // Extract hhmmss.ss as float
-    tTemp = pos->utc;                                      // Convert to unsigned long (discard the digits beyond the decimal point)
-    clk->time.ms = ((unsigned int)(pos->utc * 100)) % 100; // Extract the milliseconds
-    clk->time.hour = tTemp / 10000;
-    tTemp -= ((unsigned long)clk->time.hour * 10000);
-    clk->time.minute = tTemp / 100;
-    tTemp -= ((unsigned long)clk->time.minute * 100);
-    clk->time.second = tTemp;
+  case SARA_R5_CONNECTION_CONNECTED:
+    if ((_connectionLost) || (!isRegistered()))
+      connectionLost();
+    else
+      openManagedSockets(); // Retry any which failed or were closed
+    return;
+
+  case SARA_R5_CONNECTION_BACKOFF:
+    if ((millis() - _connectionStateMillis) >= _connectionBackoff)
+    {
+      _connectionBackoff *= 2;
+      if (_connectionBackoff > SARA_R5_CONNECTION_BACKOFF_MAX)
+        _connectionBackoff = SARA_R5_CONNECTION_BACKOFF_MAX;
+      setConnectionState(SARA_R5_CONNECTION_REGISTERING);
+      processConnectionManager();
+    }
+    return;
   }
-  else
+}
+
+void SARA_R5::setConnectionState(SARA_R5_connection_state_t state)
+{
+  _connectionStateMillis = millis();
+  if (state == _connectionState)
+    return;
+
+  if (SARA_R5_LOG_DEBUG_ENABLED)
+  {
+    _debugPort->print(F("setConnectionState: "));
+    _debugPort->println((int)state);
+  }
+
+  _connectionState = state;
+  if (_connectionStateCallback != nullptr)
+    _connectionStateCallback(state, _connectionStateCallbackContext);
+}
+
+void SARA_R5::connectionFailed(void)
+{
+  if (SARA_R5_LOG_ERROR_ENABLED)
+  {
+    _debugPort->print(F("connectionFailed: retrying in "));
+    _debugPort->println(_connectionBackoff);
+  }
+  setConnectionState(SARA_R5_CONNECTION_BACKOFF);
+}
+
+void SARA_R5::connectionLost(void)
+{
+  if (SARA_R5_LOG_ERROR_ENABLED)
+    _debugPort->println(F("connectionLost: re-attaching"));
+
+  // The module closes the sockets when the PSD profile is deactivated
+  for (int i = 0; i < SARA_R5_NUM_MANAGED_SOCKETS; i++)
+  {
+    if (_managedSockets[i].inUse)
+    {
+      closeManagedSocket(i, false);
+      _managedSockets[i].backoff = 0; // Reopen as soon as we are connected again
+    }
+  }
+
+  // Re-attach immediately. The backoff only applies if that fails
+  _connectionLost = false;
+  setConnectionState(SARA_R5_CONNECTION_REGISTERING);
+  processConnectionManager();
+}
+
+void SARA_R5::openManagedSockets(void)
+{
+  for (int i = 0; i < SARA_R5_NUM_MANAGED_SOCKETS; i++)
+  {
+    SARA_R5_managed_socket *managed = &_managedSockets[i];
+    if ((!managed->inUse) || (managed->socket >= 0) || ((millis() - managed->retryMillis) < managed->backoff))
+      continue;
+
+    int socket = socketOpen(managed->protocol);
+    if ((socket >= 0) && (managed->protocol == SARA_R5_TCP))
+    {
+      if (socketConnect(socket, managed->host, managed->port) != SARA_R5_ERROR_SUCCESS)
+      {
+        socketClose(socket);
+        socket = -1;
+      }
+    }
+
+    if (socket < 0)
+    {
+      managed->retryMillis = millis();
+      managed->backoff = (managed->backoff == 0) ? SARA_R5_CONNECTION_BACKOFF_MIN : managed->backoff * 2;
+      if (managed->backoff > SARA_R5_CONNECTION_BACKOFF_MAX)
+        managed->backoff = SARA_R5_CONNECTION_BACKOFF_MAX;
+      continue;
+    }
+
+    managed->socket = socket;
+    managed->backoff = 0;
+    if (managed->callback != nullptr)
+      managed->callback(i, socket, managed->context);
+  }
+}
+
+void SARA_R5::closeManagedSocket(int id, bool close)
+{
+  SARA_R5_managed_socket *managed = &_managedSockets[id];
+  if (managed->socket < 0)
+    return;
+
+  int socket = managed->socket;
+  managed->socket = -1;
+  if (close)
+    socketClose(socket);
+  if (managed->callback != nullptr)
+    managed->callback(id, -1, managed->context);
+}
+
+// +UUSOCL: reopen the socket from processConnectionManager
+void SARA_R5::managedSocketClosed(int socket)
+{
+  for (int i = 0; i < SARA_R5_NUM_MANAGED_SOCKETS; i++)
+  {
+    if ((_managedSockets[i].inUse) && (_managedSockets[i].socket == socket))
+    {
+      closeManagedSocket(i, false);
+      _managedSockets[i].retryMillis = millis();
+      _managedSockets[i].backoff = SARA_R5_CONNECTION_BACKOFF_MIN;
+    }
+  }
+}
+
+// Add a +CESQ sample to the signal history
+void SARA_R5::processSignalHistory(void)
+{
+  if (_signalHistoryInterval == 0)
+    return;
+  if ((_signalHistorySampled) && ((millis() - _signalHistoryLastSample) < _signalHistoryInterval))
+    return;
+
+  _signalHistorySampled = true;
+  _signalHistoryLastSample = millis();
+
+  signal_quality signal;
+  if (getExtSignalQuality(signal) != SARA_R5_ERROR_SUCCESS)
+    return; // Try again at the next interval
+
+  _signalMillis[_signalMillisNext] = millis();
+  _signalMillisNext = (_signalMillisNext + 1) % SARA_R5_SIGNAL_HISTORY_SIZE;
+  _signalRSRP.add((uint8_t)signal.rsrp);
+  _signalRSRQ.add((uint8_t)signal.rsrq);
+}
+
+// Refresh the signal quality in the cached network state
+void SARA_R5::processNetworkState(void)
+{
+  if (_networkStateRefreshInterval == 0)
+    return;
+  if ((_networkStateRefreshed) && ((millis() - _networkStateLastRefresh) < _networkStateRefreshInterval))
+    return;
+
+  _networkStateRefreshed = true;
+  _networkStateLastRefresh = millis(); // Don't retry immediately if the refresh fails
+
+  signal_quality signal;
+  getExtSignalQuality(signal);
+  rssi();
+}
+
+// Read the messages indicated by +CMTI and pass them to the callback
+void SARA_R5::processNewSMS(void)
+{
+  while (_numNewSMS > 0)
+  {
+    int index = _newSMSIndexes[_newSMSHead];
+
+    if (_newSMSCallback == nullptr)
+    {
+      dequeueNewSMS(); // Leave the message in storage
+      continue;
+    }
+
+    // Wait before reading a message again
+    if ((_newSMSRetries > 0) && ((millis() - _newSMSRetryMillis) < SARA_R5_NEW_SMS_RETRY_INTERVAL))
+      return;
+
+    SARA_R5_error_t err;
+    if (_smsMessageFormat == SARA_R5_MESSAGE_FORMAT_PDU)
+    {
+      char *pduHex = sara_r5_calloc_char(SARA_R5_SMS_MAX_PDU_HEX_LENGTH);
+      if (pduHex == nullptr)
+      {
+        err = SARA_R5_ERROR_OUT_OF_MEMORY; // The message remains in storage
+      }
+      else
+      {
+        err = readSMSmessagePDU(index, pduHex, SARA_R5_SMS_MAX_PDU_HEX_LENGTH);
+        if (err == SARA_R5_ERROR_SUCCESS)
+          _newSMSCallback(index, "", "", pduHex, strlen(pduHex), _newSMSCallbackContext);
+        sara_r5_free(pduHex);
+      }
+    }
+    else
+    {
+      String unread = "";
+      String from = "";
+      String dateTime = "";
+      String message = "";
+      err = readSMSmessage(index, &unread, &from, &dateTime, &message);
+      if (err == SARA_R5_ERROR_SUCCESS)
+        _newSMSCallback(index, from.c_str(), dateTime.c_str(), message.c_str(), message.length(), _newSMSCallbackContext);
+    }
+    if (err != SARA_R5_ERROR_SUCCESS)
+    {
+      _newSMSRetries++;
+      _newSMSRetryMillis = millis();
+      if (SARA_R5_LOG_ERROR_ENABLED)
+      {
+        _debugPort->print(F("processNewSMS: read failed: "));
+        _debugPort->print(err);
+        _debugPort->print(F(" index "));
+        _debugPort->print(index);
+        _debugPort->print(F(" attempt "));
+        _debugPort->println(_newSMSRetries);
+      }
+      if (_newSMSRetries < SARA_R5_NEW_SMS_RETRIES)
+        return; // Try again later
+      dequeueNewSMS(); // Give up. The message remains in storage
+      continue;
+    }
+
+    dequeueNewSMS();
+    if (_newSMSDeleteAfterRead)
+      deleteSMSmessage(index);
+  }
+}
+
+void SARA_R5::dequeueNewSMS(void)
+{
+  _newSMSHead = (_newSMSHead + 1) % SARA_R5_NEW_SMS_QUEUE_SIZE;
+  _numNewSMS--;
+  _newSMSRetries = 0;
+}
+
+void SARA_R5::processLocationRequests(void)
+{
+  while (_numLocationRequests > 0)
+  {
+    SARA_R5_location_request *request = &_locationRequests[0];
+
+    if (request->active)
+    {
+      // Has the deadline passed?
+      if ((millis() - request->startTime) < (((unsigned long)request->timeout * 1000) + SARA_R5_LOCATION_REQUEST_MARGIN))
+        return; // Keep waiting for the +UULOC
+
+      if (SARA_R5_LOG_ERROR_ENABLED)
+        _debugPort->println(F("processLocationRequests: request timed out"));
+      completeLocationRequest(SARA_R5_ERROR_TIMEOUT, nullptr, nullptr, nullptr, 0);
+      continue; // Send the next request (if any)
+    }
+
+    // Wait for any +UULOC from gpsRequest first
+    if (_legacyLocationRequests > 0)
+    {
+      if ((long)(millis() - _legacyLocationDeadline) < 0)
+        return;
+      _legacyLocationRequests = 0; // It is not coming
+    }
+
+    // +ULOC only works if the GNSS is off. isGPSon only queries the module if the power state is unknown
+    if (isGPSon())
+      gpsPower(false);
+
+    SARA_R5_error_t err = sendLocationRequest(request->timeout, request->accuracy, request->detailed, request->sensor);
+    if (err == SARA_R5_ERROR_SUCCESS)
+    {
+      request->active = true;
+      request->startTime = millis();
+      return;
+    }
+
+    if (SARA_R5_LOG_ERROR_ENABLED)
+    {
+      _debugPort->print(F("processLocationRequests: +ULOC failed: "));
+      _debugPort->println(err);
+    }
+    request->active = true; // Mark as active so completeLocationRequest will remove it
+    completeLocationRequest(err, nullptr, nullptr, nullptr, 0);
+  }
+}
+
+// Call the active request's callback (unless it has been cancelled) and remove it from the queue
+void SARA_R5::completeLocationRequest(SARA_R5_error_t result, ClockData *clck, PositionData *gps, SpeedData *spd, unsigned long uncertainty)
+{
+  if ((_numLocationRequests == 0) || (!_locationRequests[0].active))
+    return; // This +UULOC was not for one of our requests
+
+  SARA_R5_location_request request = _locationRequests[0]; // Take a copy - the callback could queue a new request
+  for (uint8_t i = 1; i < _numLocationRequests; i++)
+    _locationRequests[i - 1] = _locationRequests[i];
+  _numLocationRequests--;
+
+  if ((request.cancelled) || (request.callback == nullptr))
+    return;
+
+  ClockData noClock;
+  PositionData noPosition;
+  SpeedData noSpeed;
+  memset(&noClock, 0, sizeof(noClock));
+  memset(&noPosition, 0, sizeof(noPosition));
+  memset(&noSpeed, 0, sizeof(noSpeed));
+
+  request.callback(result,
+                   (clck != nullptr) ? *clck : noClock,
+                   (gps != nullptr) ? *gps : noPosition,
+                   (spd != nullptr) ? *spd : noSpeed,
+                   uncertainty, request.context);
+}
+
+// GPS Helper Functions:
+
+// Read a source string until a delimiter is hit, store the result in destination
+char *SARA_R5::readDataUntil(char *destination, unsigned int destSize,
+                             char *source, char delimiter)
+{
+
+  char *strEnd;
+  size_t len;
+
+  strEnd = strchr(source, delimiter);
+
+  if (strEnd != nullptr)
+  {
+    len = strEnd - source;
+    memset(destination, 0, destSize);
+    memcpy(destination, source, len);
+  }
+
+  return strEnd;
+}
+
+bool SARA_R5::parseGPRMCString(char *rmcString, PositionData *pos,
+                               ClockData *clk, SpeedData *spd)
+{
+  char *ptr, *search;
+  unsigned long tTemp;
+  char tempData[TEMP_NMEA_DATA_SIZE];
+
+  // if (SARA_R5_LOG_DEBUG_ENABLED)
+  // {
+  //   _debugPort->println(F("parseGPRMCString: rmcString: "));
+  //   _debugPort->println(rmcString);
+  // }
+
+  // Fast-forward test to first value:
+  ptr = strchr(rmcString, ',');
+  ptr++; // Move ptr past first comma
+
+  // If the next character is another comma, there's no time data
+  // Find time:
+  search = readDataUntil(tempData, TEMP_NMEA_DATA_SIZE, ptr, ',');
+  // Next comma should be present and not the next position
+  if ((search != nullptr) && (search != ptr))
+  {
+    pos->utc = atof(tempData);                             // Extract hhmmss.ss as float
+    tTemp = pos->utc;                                      // Convert to unsigned long (discard the digits beyond the decimal point)
+    clk->time.ms = ((unsigned int)(pos->utc * 100)) % 100; // Extract the milliseconds
+    clk->time.hour = tTemp / 10000;
+    tTemp -= ((unsigned long)clk->time.hour * 10000);
+    clk->time.minute = tTemp / 100;
+    tTemp -= ((unsigned long)clk->time.minute * 100);
+    clk->time.second = tTemp;
+  }
+  else
   {
     pos->utc = 0.0;
     clk->time.hour = 0;
@@ -6930,3 +10699,1257 @@ bool SARA_R5::parseGPRMCString(char *rmcString, PositionData *pos,
   }
   return false;
 }
+
+// RTCM3 framing
+
+// CRC-24Q nibble table: polynomial 0x1864CFB
+static const uint32_t SARA_R5_crc24qTable[16] = {
+  0x000000, 0x864CFB, 0x8AD50D, 0x0C99F6, 0x93E6E1, 0x15AA1A, 0x1933EC, 0x9F7F17,
+  0xA18139, 0x27CDC2, 0x2B5434, 0xAD18CF, 0x3267D8, 0xB42B23, 0xB8B2D5, 0x3EFE2E};
+
+SARA_R5_RTCM3_Framer::SARA_R5_RTCM3_Framer(void)
+{
+  _frame = nullptr;
+  _frameLength = 0;
+  _frameCallback = nullptr;
+  _frameCallbackContext = nullptr;
+  _numFilter = 0;
+  _numStats = 0;
+  reset();
+}
+
+SARA_R5_RTCM3_Framer::~SARA_R5_RTCM3_Framer(void)
+{
+  if (nullptr != _frame)
+  {
+    delete[] _frame;
+    _frame = nullptr;
+  }
+}
+
+bool SARA_R5_RTCM3_Framer::begin(void)
+{
+  if (nullptr == _frame)
+  {
+    _frame = new uint8_t[SARA_R5_RTCM3_MAX_FRAME_LENGTH];
+    if (nullptr == _frame)
+      return false;
+  }
+  _frameLength = 0;
+  return true;
+}
+
+void SARA_R5_RTCM3_Framer::reset(void)
+{
+  _frameLength = 0;
+  _numStats = 0;
+  _framesForwarded = 0;
+  _framesFiltered = 0;
+  _crcErrors = 0;
+  _bytesDiscarded = 0;
+}
+
+void SARA_R5_RTCM3_Framer::setFrameCallback(void (*frameCallback)(const uint8_t *frame, uint16_t length, void *context), void *context)
+{
+  _frameCallback = frameCallback;
+  _frameCallbackContext = context;
+}
+
+bool SARA_R5_RTCM3_Framer::setMessageFilter(const uint16_t *types, uint8_t numTypes)
+{
+  if ((numTypes > SARA_R5_RTCM3_MAX_FILTER_TYPES) || ((numTypes > 0) && (types == nullptr)))
+    return false;
+  for (uint8_t i = 0; i < numTypes; i++)
+    _filter[i] = types[i];
+  _numFilter = numTypes;
+  return true;
+}
+
+uint16_t SARA_R5_RTCM3_Framer::process(const uint8_t *data, size_t length)
+{
+  uint16_t forwarded = 0;
+
+  if ((_frame == nullptr) || (data == nullptr))
+    return 0;
+
+  // parseFrames always leaves less than one complete frame in _frame, so there is always room for more data
+  while (length > 0)
+  {
+    size_t space = SARA_R5_RTCM3_MAX_FRAME_LENGTH - _frameLength;
+    size_t toCopy = (length < space) ? length : space;
+    memcpy(&_frame[_frameLength], data, toCopy);
+    _frameLength += toCopy;
+    data += toCopy;
+    length -= toCopy;
+    forwarded += parseFrames();
+  }
+
+  return forwarded;
+}
+
+uint16_t SARA_R5_RTCM3_Framer::parseFrames(void)
+{
+  uint16_t forwarded = 0;
+
+  while (_frameLength > 0)
+  {
+    // Search for the preamble. Discard anything before it
+    if (_frame[0] != SARA_R5_RTCM3_PREAMBLE)
+    {
+      uint16_t skip = 1;
+      while ((skip < _frameLength) && (_frame[skip] != SARA_R5_RTCM3_PREAMBLE))
+        skip++;
+      discardBytes(skip);
+      continue;
+    }
+
+    if (_frameLength < SARA_R5_RTCM3_HEADER_LENGTH)
+      break; // Wait for the rest of the header
+
+    // The six reserved bits must be zero. If they are not, this was not a real preamble
+    if ((_frame[1] & 0xFC) != 0)
+    {
+      discardBytes(1);
+      continue;
+    }
+
+    uint16_t payloadLength = (((uint16_t)_frame[1] & 0x03) << 8) | _frame[2];
+    uint16_t totalLength = SARA_R5_RTCM3_HEADER_LENGTH + payloadLength + SARA_R5_RTCM3_CRC_LENGTH;
+
+    if (_frameLength < totalLength)
+      break; // Wait for the rest of the frame
+
+    uint32_t expectedCRC = ((uint32_t)_frame[totalLength - 3] << 16) | ((uint32_t)_frame[totalLength - 2] << 8) | _frame[totalLength - 1];
+    if (crc24q(_frame, SARA_R5_RTCM3_HEADER_LENGTH + payloadLength) != expectedCRC)
+    {
+      // Bad frame. Discard the preamble and resynchronise on the next one
+      _crcErrors++;
+      discardBytes(1);
+      continue;
+    }
+
+    // The message type is the first 12 bits of the payload
+    uint16_t type = 0;
+    if (payloadLength >= 2)
+      type = ((uint16_t)_frame[3] << 4) | (_frame[4] >> 4);
+
+    updateStats(type);
+
+    if (passesFilter(type))
+    {
+      _framesForwarded++;
+      forwarded++;
+      if (_frameCallback != nullptr)
+        _frameCallback((const uint8_t *)_frame, totalLength, _frameCallbackContext);
+    }
+    else
+      _framesFiltered++;
+
+    // Remove the frame - without counting it as discarded
+    _frameLength -= totalLength;
+    if (_frameLength > 0)
+      memmove(_frame, &_frame[totalLength], _frameLength);
+  }
+
+  return forwarded;
+}
+
+void SARA_R5_RTCM3_Framer::discardBytes(uint16_t num)
+{
+  if (num > _frameLength)
+    num = _frameLength;
+  _bytesDiscarded += num;
+  _frameLength -= num;
+  if (_frameLength > 0)
+    memmove(_frame, &_frame[num], _frameLength);
+}
+
+void SARA_R5_RTCM3_Framer::updateStats(uint16_t type)
+{
+  for (uint8_t i = 0; i < _numStats; i++)
+  {
+    if (_stats[i].type == type)
+    {
+      _stats[i].count++;
+      _stats[i].lastMillis = millis();
+      return;
+    }
+  }
+  if (_numStats < SARA_R5_RTCM3_MAX_MSG_TYPES) // Table full? The frame is still forwarded, just not counted
+  {
+    _stats[_numStats].type = type;
+    _stats[_numStats].count = 1;
+    _stats[_numStats].lastMillis = millis();
+    _numStats++;
+  }
+}
+
+bool SARA_R5_RTCM3_Framer::passesFilter(uint16_t type)
+{
+  if (_numFilter == 0)
+    return true;
+  for (uint8_t i = 0; i < _numFilter; i++)
+  {
+    if (_filter[i] == type)
+      return true;
+  }
+  return false;
+}
+
+const SARA_R5_rtcm3_msg_stats *SARA_R5_RTCM3_Framer::messageStats(uint8_t index)
+{
+  if (index >= _numStats)
+    return nullptr;
+  return &_stats[index];
+}
+
+uint32_t SARA_R5_RTCM3_Framer::messageCount(uint16_t type)
+{
+  for (uint8_t i = 0; i < _numStats; i++)
+  {
+    if (_stats[i].type == type)
+      return _stats[i].count;
+  }
+  return 0;
+}
+
+unsigned long SARA_R5_RTCM3_Framer::messageAge(uint16_t type)
+{
+  for (uint8_t i = 0; i < _numStats; i++)
+  {
+    if (_stats[i].type == type)
+      return millis() - _stats[i].lastMillis;
+  }
+  return 0xFFFFFFFF;
+}
+
+uint32_t SARA_R5_RTCM3_Framer::crc24q(const uint8_t *data, size_t length, uint32_t crc)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    uint8_t b = data[i];
+    crc = ((crc << 4) ^ SARA_R5_crc24qTable[((crc >> 20) ^ (b >> 4)) & 0x0F]) & 0xFFFFFF;
+    crc = ((crc << 4) ^ SARA_R5_crc24qTable[((crc >> 20) ^ b) & 0x0F]) & 0xFFFFFF;
+  }
+  return crc;
+}
+
+// SMS PDU mode
+
+// GSM 7-bit default alphabet: Unicode for septets 0x00 - 0x1F. 0x1B (escape) decodes as a space
+static const uint16_t SARA_R5_gsm7Low[32] = {
+  0x0040, 0x00A3, 0x0024, 0x00A5, 0x00E8, 0x00E9, 0x00F9, 0x00EC, 0x00F2, 0x00C7, 0x000A, 0x00D8, 0x00F8, 0x000D, 0x00C5, 0x00E5,
+  0x0394, 0x005F, 0x03A6, 0x0393, 0x039B, 0x03A9, 0x03A0, 0x03A8, 0x03A3, 0x0398, 0x039E, 0x0020, 0x00C6, 0x00E6, 0x00DF, 0x00C9};
+
+// GSM 7-bit extension table (escape + septet)
+static const uint8_t SARA_R5_gsm7ExtSeptet[10] = {0x0A, 0x14, 0x28, 0x29, 0x2F, 0x3C, 0x3D, 0x3E, 0x40, 0x65};
+static const uint16_t SARA_R5_gsm7ExtUnicode[10] = {0x000C, 0x005E, 0x007B, 0x007D, 0x005C, 0x005B, 0x007E, 0x005D, 0x007C, 0x20AC};
+
+static int SARA_R5_hexNibble(char c)
+{
+  if ((c >= '0') && (c <= '9'))
+    return c - '0';
+  if ((c >= 'A') && (c <= 'F'))
+    return c - 'A' + 10;
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  return -1;
+}
+
+uint32_t SARA_R5_SMS_PDU::unicodeFromGSM7(uint8_t septet, bool escaped)
+{
+  septet &= 0x7F;
+  if (escaped)
+  {
+    for (uint8_t i = 0; i < sizeof(SARA_R5_gsm7ExtSeptet); i++)
+    {
+      if (SARA_R5_gsm7ExtSeptet[i] == septet)
+        return SARA_R5_gsm7ExtUnicode[i];
+    }
+    // Unknown extension: use the default alphabet character
+  }
+  if (septet < 0x20)
+    return SARA_R5_gsm7Low[septet];
+  switch (septet)
+  {
+  case 0x24:
+    return 0x00A4; // ¤
+  case 0x40:
+    return 0x00A1; // ¡
+  case 0x5B:
+    return 0x00C4; // Ä
+  case 0x5C:
+    return 0x00D6; // Ö
+  case 0x5D:
+    return 0x00D1; // Ñ
+  case 0x5E:
+    return 0x00DC; // Ü
+  case 0x5F:
+    return 0x00A7; // §
+  case 0x60:
+    return 0x00BF; // ¿
+  case 0x7B:
+    return 0x00E4; // ä
+  case 0x7C:
+    return 0x00F6; // ö
+  case 0x7D:
+    return 0x00F1; // ñ
+  case 0x7E:
+    return 0x00FC; // ü
+  case 0x7F:
+    return 0x00E0; // à
+  default:
+    return septet; // The rest match ASCII
+  }
+}
+
+int SARA_R5_SMS_PDU::gsm7FromUnicode(uint32_t c)
+{
+  // Fast path for the ASCII characters which map to themselves
+  if (((c >= 0x20) && (c <= 0x5A) && (c != 0x24) && (c != 0x40)) || ((c >= 0x61) && (c <= 0x7A)))
+    return (int)c;
+  for (uint8_t i = 0; i < 0x80; i++)
+  {
+    if ((i != 0x1B) && (unicodeFromGSM7(i, false) == c))
+      return i;
+  }
+  for (uint8_t i = 0; i < sizeof(SARA_R5_gsm7ExtSeptet); i++)
+  {
+    if (SARA_R5_gsm7ExtUnicode[i] == c)
+      return 0x1B00 | SARA_R5_gsm7ExtSeptet[i];
+  }
+  return -1;
+}
+
+// Return the next character: a Unicode code point for GSM 7-bit and UCS2 (invalid UTF-8 gives U+FFFD), or the next byte for 8-bit
+uint32_t SARA_R5_SMS_PDU::nextChar(const uint8_t *data, size_t length, size_t *index, SARA_R5_sms_encoding_t encoding)
+{
+  uint8_t b = data[(*index)++];
+  if ((encoding == SARA_R5_SMS_ENCODING_8BIT) || (b < 0x80))
+    return b;
+
+  uint8_t extra;
+  uint32_t c;
+  if ((b & 0xE0) == 0xC0)
+  {
+    extra = 1;
+    c = b & 0x1F;
+  }
+  else if ((b & 0xF0) == 0xE0)
+  {
+    extra = 2;
+    c = b & 0x0F;
+  }
+  else if ((b & 0xF8) == 0xF0)
+  {
+    extra = 3;
+    c = b & 0x07;
+  }
+  else
+    return 0xFFFD;
+
+  for (uint8_t i = 0; i < extra; i++)
+  {
+    if ((*index >= length) || ((data[*index] & 0xC0) != 0x80))
+      return 0xFFFD;
+    c = (c << 6) | (data[(*index)++] & 0x3F);
+  }
+  return c;
+}
+
+uint8_t SARA_R5_SMS_PDU::charCost(uint32_t c, SARA_R5_sms_encoding_t encoding)
+{
+  if (encoding == SARA_R5_SMS_ENCODING_GSM7)
+    return (gsm7FromUnicode(c) > 0xFF) ? 2 : 1; // Unknown characters are sent as '?'
+  if (encoding == SARA_R5_SMS_ENCODING_UCS2)
+    return (c > 0xFFFF) ? 2 : 1; // Surrogate pair
+  return 1;
+}
+
+bool SARA_R5_SMS_PDU::segmentBounds(const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding,
+                                    uint8_t segment, size_t *start, size_t *end, uint8_t *numSegments)
+{
+  size_t singleCapacity = 140;
+  size_t partCapacity = 134;
+  if (encoding == SARA_R5_SMS_ENCODING_GSM7)
+  {
+    singleCapacity = 160;
+    partCapacity = 153;
+  }
+  else if (encoding == SARA_R5_SMS_ENCODING_UCS2)
+  {
+    singleCapacity = 70;
+    partCapacity = 67;
+  }
+
+  size_t total = 0;
+  size_t index = 0;
+  if (encoding == SARA_R5_SMS_ENCODING_8BIT)
+    total = length;
+  else
+  {
+    while (index < length)
+      total += charCost(nextChar(data, length, &index, encoding), encoding);
+  }
+
+  *start = 0;
+  *end = length;
+  if (total <= singleCapacity)
+  {
+    *numSegments = 1;
+    return (segment == 1);
+  }
+
+  // Walk through the data, never splitting an escape sequence or a surrogate pair
+  uint16_t seg = 1;
+  size_t used = 0;
+  index = 0;
+  while (index < length)
+  {
+    size_t charStart = index;
+    uint8_t cost = charCost(nextChar(data, length, &index, encoding), encoding);
+    if ((used + cost) > partCapacity)
+    {
+      if (seg == segment)
+        *end = charStart;
+      seg++;
+      if (seg == segment)
+        *start = charStart;
+      used = 0;
+    }
+    used += cost;
+  }
+  if (seg > 255)
+    return false;
+  *numSegments = (uint8_t)seg;
+  return ((segment >= 1) && (segment <= seg));
+}
+
+uint8_t SARA_R5_SMS_PDU::segmentsNeeded(const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding)
+{
+  size_t start, end;
+  uint8_t numSegments = 0;
+  if (!segmentBounds(data, length, encoding, 1, &start, &end, &numSegments))
+    return 0;
+  return numSegments;
+}
+
+bool SARA_R5_SMS_PDU::isGSM7(const uint8_t *text, size_t length)
+{
+  size_t index = 0;
+  while (index < length)
+  {
+    if (gsm7FromUnicode(nextChar(text, length, &index, SARA_R5_SMS_ENCODING_GSM7)) < 0)
+      return false;
+  }
+  return true;
+}
+
+size_t SARA_R5_SMS_PDU::gsm7Pack(const uint8_t *septets, size_t numSeptets, uint8_t *dest, size_t destSize, uint8_t fillBits)
+{
+  size_t numOctets = ((numSeptets * 7) + fillBits + 7) / 8;
+  if (numOctets > destSize)
+    return 0;
+  memset(dest, 0, numOctets);
+  for (size_t i = 0; i < numSeptets; i++)
+  {
+    size_t bit = (i * 7) + fillBits;
+    uint8_t septet = septets[i] & 0x7F;
+    dest[bit / 8] |= septet << (bit % 8);
+    if (((bit % 8) > 1) && (((bit / 8) + 1) < numOctets))
+      dest[(bit / 8) + 1] |= septet >> (8 - (bit % 8));
+  }
+  return numOctets;
+}
+
+size_t SARA_R5_SMS_PDU::gsm7Unpack(const uint8_t *src, size_t srcLength, uint8_t *septets, size_t numSeptets, uint8_t fillBits)
+{
+  size_t i;
+  for (i = 0; i < numSeptets; i++)
+  {
+    size_t bit = (i * 7) + fillBits;
+    if ((bit / 8) >= srcLength)
+      break;
+    uint16_t value = src[bit / 8];
+    if (((bit / 8) + 1) < srcLength)
+      value |= ((uint16_t)src[(bit / 8) + 1]) << 8;
+    septets[i] = (value >> (bit % 8)) & 0x7F;
+  }
+  return i;
+}
+
+size_t SARA_R5_SMS_PDU::encodeAddress(const char *address, uint8_t *dest)
+{
+  uint8_t toa = 0x81; // Unknown / national
+  if (*address == '+')
+  {
+    toa = 0x91; // International
+    address++;
+  }
+  size_t numDigits = strlen(address);
+  if ((numDigits == 0) || (numDigits > 20))
+    return 0;
+
+  dest[0] = (uint8_t)numDigits;
+  dest[1] = toa;
+  for (size_t i = 0; i < numDigits; i++)
+  {
+    char c = address[i];
+    uint8_t nibble;
+    if ((c >= '0') && (c <= '9'))
+      nibble = c - '0';
+    else if (c == '*')
+      nibble = 0x0A;
+    else if (c == '#')
+      nibble = 0x0B;
+    else
+      return 0;
+    if ((i % 2) == 0)
+      dest[2 + (i / 2)] = 0xF0 | nibble; // Pad with F in case this is the last digit
+    else
+      dest[2 + (i / 2)] = (dest[2 + (i / 2)] & 0x0F) | (nibble << 4);
+  }
+  return 2 + ((numDigits + 1) / 2);
+}
+
+bool SARA_R5_SMS_PDU::decodeAddress(const uint8_t *tpdu, size_t length, size_t *index, char *dest, size_t destSize)
+{
+  if ((*index + 2) > length)
+    return false;
+  uint8_t numDigits = tpdu[*index];
+  uint8_t toa = tpdu[*index + 1];
+  size_t numOctets = (numDigits + 1) / 2;
+  if ((*index + 2 + numOctets) > length)
+    return false;
+  const uint8_t *digits = &tpdu[*index + 2];
+  *index += 2 + numOctets;
+
+  size_t d = 0;
+  if ((toa & 0x70) == 0x50) // Alphanumeric (GSM 7-bit)
+  {
+    uint8_t septets[11];
+    size_t numSeptets = gsm7Unpack(digits, numOctets, septets, (numDigits * 4) / 7 > 11 ? 11 : (numDigits * 4) / 7);
+    for (size_t i = 0; (i < numSeptets) && ((d + 1) < destSize); i++)
+    {
+      uint32_t c = unicodeFromGSM7(septets[i], false);
+      dest[d++] = (c < 0x80) ? (char)c : '?';
+    }
+  }
+  else
+  {
+    if (((toa & 0x70) == 0x10) && ((d + 1) < destSize)) // International
+      dest[d++] = '+';
+    for (size_t i = 0; (i < numDigits) && ((d + 1) < destSize); i++)
+    {
+      uint8_t nibble = (i % 2) ? (digits[i / 2] >> 4) : (digits[i / 2] & 0x0F);
+      if (nibble == 0x0F)
+        break;
+      dest[d++] = (nibble < 10) ? ('0' + nibble) : "*#abc"[nibble - 10];
+    }
+  }
+  dest[d] = '\0';
+  return true;
+}
+
+void SARA_R5_SMS_PDU::decodeTimestamp(const uint8_t *src, char *dest)
+{
+  int field[6];
+  for (int i = 0; i < 6; i++)
+    field[i] = ((src[i] & 0x0F) * 10) + (src[i] >> 4); // Swapped semi-octets
+  int tz = ((src[6] & 0x07) * 10) + (src[6] >> 4);     // Quarters of an hour. Bit 3 is the sign
+  sprintf(dest, "%02d/%02d/%02d,%02d:%02d:%02d%c%02d", field[0], field[1], field[2], field[3], field[4], field[5],
+          (src[6] & 0x08) ? '-' : '+', tz);
+}
+
+void SARA_R5_SMS_PDU::appendUTF8(uint32_t c, SARA_R5_sms_pdu *pdu)
+{
+  uint8_t utf8[4];
+  uint8_t n;
+  if (c < 0x80)
+  {
+    utf8[0] = c;
+    n = 1;
+  }
+  else if (c < 0x800)
+  {
+    utf8[0] = 0xC0 | (c >> 6);
+    utf8[1] = 0x80 | (c & 0x3F);
+    n = 2;
+  }
+  else if (c < 0x10000)
+  {
+    utf8[0] = 0xE0 | (c >> 12);
+    utf8[1] = 0x80 | ((c >> 6) & 0x3F);
+    utf8[2] = 0x80 | (c & 0x3F);
+    n = 3;
+  }
+  else
+  {
+    utf8[0] = 0xF0 | (c >> 18);
+    utf8[1] = 0x80 | ((c >> 12) & 0x3F);
+    utf8[2] = 0x80 | ((c >> 6) & 0x3F);
+    utf8[3] = 0x80 | (c & 0x3F);
+    n = 4;
+  }
+  if ((pdu->dataLength + n) > SARA_R5_SMS_MAX_DECODED_LENGTH)
+  {
+    pdu->truncated = true;
+    return;
+  }
+  memcpy(&pdu->data[pdu->dataLength], utf8, n);
+  pdu->dataLength += n;
+}
+
+int SARA_R5_SMS_PDU::encodeSubmit(char *pduHex, size_t pduHexSize, const char *destination,
+                                  const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding,
+                                  uint8_t segment, uint8_t concatReference, bool statusReport)
+{
+  size_t start, end;
+  uint8_t numSegments;
+  if (!segmentBounds(data, length, encoding, segment, &start, &end, &numSegments))
+    return -1;
+
+  uint8_t tpdu[SARA_R5_SMS_MAX_TPDU_LENGTH];
+  size_t i = 0;
+  bool concatenated = (numSegments > 1);
+
+  tpdu[i++] = 0x11 | (statusReport ? 0x20 : 0x00) | (concatenated ? 0x40 : 0x00); // SMS-SUBMIT, relative validity period, SRR, UDHI
+  tpdu[i++] = 0x00; // Message reference: set by the module
+  size_t addressLength = encodeAddress(destination, &tpdu[i]);
+  if (addressLength == 0)
+    return -1;
+  i += addressLength;
+  tpdu[i++] = 0x00; // Protocol identifier
+  tpdu[i++] = (encoding == SARA_R5_SMS_ENCODING_GSM7) ? 0x00 : ((encoding == SARA_R5_SMS_ENCODING_8BIT) ? 0x04 : 0x08); // Data coding scheme
+  tpdu[i++] = SARA_R5_SMS_VALIDITY_PERIOD;
+  size_t udlIndex = i++;
+  uint8_t *ud = &tpdu[i];
+  size_t udhLength = 0;
+  size_t udOctets;
+  uint8_t udl;
+
+  if (concatenated) // Concatenated short message, 8-bit reference
+  {
+    ud[0] = 5;
+    ud[1] = 0x00;
+    ud[2] = 3;
+    ud[3] = concatReference;
+    ud[4] = numSegments;
+    ud[5] = segment;
+    udhLength = 6;
+  }
+
+  size_t index = start;
+  if (encoding == SARA_R5_SMS_ENCODING_GSM7)
+  {
+    uint8_t septets[160];
+    size_t numSeptets = 0;
+    while ((index < end) && (numSeptets < sizeof(septets)))
+    {
+      int septet = gsm7FromUnicode(nextChar(data, end, &index, encoding));
+      if (septet < 0)
+        septet = '?';
+      if (septet > 0xFF)
+      {
+        if ((numSeptets + 2) > sizeof(septets))
+          break;
+        septets[numSeptets++] = 0x1B;
+      }
+      septets[numSeptets++] = septet & 0x7F;
+    }
+    size_t headerSeptets = ((udhLength * 8) + 6) / 7;
+    uint8_t fillBits = (headerSeptets * 7) - (udhLength * 8);
+    udOctets = udhLength + gsm7Pack(septets, numSeptets, &ud[udhLength], SARA_R5_SMS_MAX_USER_DATA_LENGTH - udhLength, fillBits);
+    udl = headerSeptets + numSeptets;
+  }
+  else if (encoding == SARA_R5_SMS_ENCODING_8BIT)
+  {
+    memcpy(&ud[udhLength], &data[start], end - start);
+    udOctets = udhLength + (end - start);
+    udl = udOctets;
+  }
+  else // UCS2
+  {
+    udOctets = udhLength;
+    while ((index < end) && ((udOctets + 2) <= SARA_R5_SMS_MAX_USER_DATA_LENGTH))
+    {
+      uint32_t c = nextChar(data, end, &index, encoding);
+      if (c > 0xFFFF)
+      {
+        if ((udOctets + 4) > SARA_R5_SMS_MAX_USER_DATA_LENGTH)
+          break;
+        c -= 0x10000;
+        uint16_t high = 0xD800 | (c >> 10);
+        ud[udOctets++] = high >> 8;
+        ud[udOctets++] = high & 0xFF;
+        c = 0xDC00 | (c & 0x3FF);
+      }
+      ud[udOctets++] = c >> 8;
+      ud[udOctets++] = c & 0xFF;
+    }
+    udl = udOctets;
+  }
+  tpdu[udlIndex] = udl;
+  i += udOctets;
+
+  if (pduHexSize < (((1 + i) * 2) + 1))
+    return -1;
+  const char hex[] = "0123456789ABCDEF";
+  *pduHex++ = '0'; // SCA length 0: use the service centre address stored in the SIM
+  *pduHex++ = '0';
+  for (size_t j = 0; j < i; j++)
+  {
+    *pduHex++ = hex[tpdu[j] >> 4];
+    *pduHex++ = hex[tpdu[j] & 0x0F];
+  }
+  *pduHex = '\0';
+  return (int)i;
+}
+
+bool SARA_R5_SMS_PDU::decode(const char *pduHex, SARA_R5_sms_pdu *pdu)
+{
+  uint8_t tpdu[SARA_R5_SMS_MAX_TPDU_LENGTH + 12]; // + SCA
+  size_t length = 0;
+
+  memset(pdu, 0, sizeof(SARA_R5_sms_pdu));
+
+  while ((pduHex[0] != '\0') && (pduHex[1] != '\0'))
+  {
+    int high = SARA_R5_hexNibble(pduHex[0]);
+    int low = SARA_R5_hexNibble(pduHex[1]);
+    if ((high < 0) || (low < 0) || (length >= sizeof(tpdu)))
+      return false;
+    tpdu[length++] = (high << 4) | low;
+    pduHex += 2;
+  }
+  if (length < 1)
+    return false;
+
+  size_t i = 1 + tpdu[0]; // Skip the SCA
+  if (i >= length)
+    return false;
+  uint8_t firstOctet = tpdu[i++];
+  pdu->type = (SARA_R5_sms_pdu_type_t)(firstOctet & 0x03);
+
+  if (pdu->type == SARA_R5_SMS_PDU_STATUS_REPORT)
+  {
+    if (i >= length)
+      return false;
+    pdu->messageReference = tpdu[i++];
+    if (!decodeAddress(tpdu, length, &i, pdu->address, sizeof(pdu->address)))
+      return false;
+    if ((i + 15) > length)
+      return false;
+    decodeTimestamp(&tpdu[i], pdu->timestamp);
+    decodeTimestamp(&tpdu[i + 7], pdu->dischargeTime);
+    pdu->status = tpdu[i + 14];
+    return true;
+  }
+
+  uint8_t dcs;
+  if (pdu->type == SARA_R5_SMS_PDU_DELIVER)
+  {
+    if (!decodeAddress(tpdu, length, &i, pdu->address, sizeof(pdu->address)))
+      return false;
+    if ((i + 9) > length) // PID, DCS, SCTS
+      return false;
+    dcs = tpdu[i + 1];
+    decodeTimestamp(&tpdu[i + 2], pdu->timestamp);
+    i += 9;
+  }
+  else if (pdu->type == SARA_R5_SMS_PDU_SUBMIT) // A stored outgoing message
+  {
+    if (i >= length)
+      return false;
+    pdu->messageReference = tpdu[i++];
+    if (!decodeAddress(tpdu, length, &i, pdu->address, sizeof(pdu->address)))
+      return false;
+    if ((i + 2) > length) // PID, DCS
+      return false;
+    dcs = tpdu[i + 1];
+    i += 2;
+    uint8_t vpf = (firstOctet >> 3) & 0x03;
+    if (vpf == 2)
+      i += 1; // Relative
+    else if (vpf != 0)
+      i += 7; // Enhanced or absolute
+  }
+  else
+    return false;
+
+  if (i >= length)
+    return false;
+  uint8_t udl = tpdu[i++];
+  const uint8_t *ud = &tpdu[i];
+  size_t udLength = length - i;
+
+  // Data coding scheme
+  pdu->encoding = SARA_R5_SMS_ENCODING_8BIT;
+  if ((dcs & 0x80) == 0) // General data coding
+  {
+    if ((dcs & 0x20) == 0) // Not compressed
+    {
+      uint8_t alphabet = (dcs >> 2) & 0x03;
+      if (alphabet == 1)
+        pdu->encoding = SARA_R5_SMS_ENCODING_8BIT;
+      else if (alphabet == 2)
+        pdu->encoding = SARA_R5_SMS_ENCODING_UCS2;
+      else
+        pdu->encoding = SARA_R5_SMS_ENCODING_GSM7;
+    }
+  }
+  else if ((dcs & 0xF0) == 0xF0)
+    pdu->encoding = (dcs & 0x04) ? SARA_R5_SMS_ENCODING_8BIT : SARA_R5_SMS_ENCODING_GSM7;
+  else if ((dcs & 0xF0) == 0xE0)
+    pdu->encoding = SARA_R5_SMS_ENCODING_UCS2;
+  else if (((dcs & 0xF0) == 0xC0) || ((dcs & 0xF0) == 0xD0))
+    pdu->encoding = SARA_R5_SMS_ENCODING_GSM7;
+
+  // User data header
+  size_t udhLength = 0;
+  if ((firstOctet & 0x40) && (udLength > 0))
+  {
+    udhLength = ud[0] + 1;
+    if (udhLength > udLength)
+      return false;
+    size_t j = 1;
+    while ((j + 1) < udhLength)
+    {
+      uint8_t iei = ud[j];
+      uint8_t iel = ud[j + 1];
+      if ((j + 2 + iel) > udhLength)
+        break;
+      if ((iei == 0x00) && (iel == 3)) // Concatenated short messages, 8-bit reference
+      {
+        pdu->concatenated = true;
+        pdu->concatReference = ud[j + 2];
+        pdu->concatTotal = ud[j + 3];
+        pdu->concatSequence = ud[j + 4];
+      }
+      else if ((iei == 0x08) && (iel == 4)) // Concatenated short messages, 16-bit reference
+      {
+        pdu->concatenated = true;
+        pdu->concatReference = (((uint16_t)ud[j + 2]) << 8) | ud[j + 3];
+        pdu->concatTotal = ud[j + 4];
+        pdu->concatSequence = ud[j + 5];
+      }
+      j += 2 + iel;
+    }
+  }
+
+  if (pdu->encoding == SARA_R5_SMS_ENCODING_GSM7)
+  {
+    size_t headerSeptets = ((udhLength * 8) + 6) / 7;
+    if (udl < headerSeptets)
+      return false;
+    uint8_t septets[160];
+    size_t numSeptets = udl - headerSeptets;
+    if (numSeptets > sizeof(septets))
+      numSeptets = sizeof(septets);
+    numSeptets = gsm7Unpack(&ud[udhLength], udLength - udhLength, septets, numSeptets, (headerSeptets * 7) - (udhLength * 8));
+    bool escaped = false;
+    for (size_t j = 0; j < numSeptets; j++)
+    {
+      if ((septets[j] == 0x1B) && (!escaped))
+      {
+        escaped = true;
+        continue;
+      }
+      appendUTF8(unicodeFromGSM7(septets[j], escaped), pdu);
+      escaped = false;
+    }
+  }
+  else
+  {
+    size_t numOctets = udl;
+    if (numOctets > udLength)
+      numOctets = udLength;
+    if (numOctets < udhLength)
+      return false;
+    if (pdu->encoding == SARA_R5_SMS_ENCODING_8BIT)
+    {
+      numOctets -= udhLength;
+      if (numOctets > SARA_R5_SMS_MAX_DECODED_LENGTH)
+      {
+        numOctets = SARA_R5_SMS_MAX_DECODED_LENGTH;
+        pdu->truncated = true;
+      }
+      memcpy(pdu->data, &ud[udhLength], numOctets);
+      pdu->dataLength = numOctets;
+    }
+    else // UCS2
+    {
+      for (size_t j = udhLength; (j + 1) < numOctets; j += 2)
+      {
+        uint32_t c = (((uint16_t)ud[j]) << 8) | ud[j + 1];
+        if ((c >= 0xD800) && (c <= 0xDBFF) && ((j + 3) < numOctets))
+        {
+          uint16_t low = (((uint16_t)ud[j + 2]) << 8) | ud[j + 3];
+          if ((low >= 0xDC00) && (low <= 0xDFFF))
+          {
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            j += 2;
+          }
+        }
+        appendUTF8(c, pdu);
+      }
+    }
+  }
+  pdu->data[pdu->dataLength] = '\0';
+  return true;
+}
+
+SARA_R5_SMS_Reassembler::SARA_R5_SMS_Reassembler(void)
+{
+  reset();
+}
+
+void SARA_R5_SMS_Reassembler::reset(void)
+{
+  for (uint8_t i = 0; i < SARA_R5_SMS_REASSEMBLY_SLOTS; i++)
+    _slots[i].inUse = false;
+  _partsDropped = 0;
+}
+
+void SARA_R5_SMS_Reassembler::freeSlot(SARA_R5_sms_reassembly_slot *slot, bool dropped)
+{
+  if (dropped)
+  {
+    for (uint8_t i = 0; i < slot->total; i++)
+    {
+      if (slot->received & (1UL << i))
+        _partsDropped++;
+    }
+  }
+  slot->inUse = false;
+}
+
+bool SARA_R5_SMS_Reassembler::add(const SARA_R5_sms_pdu *pdu, const uint8_t **message, size_t *length)
+{
+  if (!pdu->concatenated)
+  {
+    *message = pdu->data;
+    *length = pdu->dataLength;
+    return true;
+  }
+
+  if ((pdu->concatTotal > SARA_R5_SMS_REASSEMBLY_MAX_PARTS) || (pdu->concatSequence == 0) || (pdu->concatSequence > pdu->concatTotal))
+  {
+    _partsDropped++;
+    return false;
+  }
+
+  // Discard any expired messages, look for this message and for a free slot
+  SARA_R5_sms_reassembly_slot *slot = nullptr;
+  SARA_R5_sms_reassembly_slot *freeSlotPtr = nullptr;
+  SARA_R5_sms_reassembly_slot *oldest = nullptr;
+  for (uint8_t i = 0; i < SARA_R5_SMS_REASSEMBLY_SLOTS; i++)
+  {
+    SARA_R5_sms_reassembly_slot *s = &_slots[i];
+    if (s->inUse && ((millis() - s->startMillis) > SARA_R5_SMS_REASSEMBLY_TIMEOUT))
+      freeSlot(s, true);
+    if (!s->inUse)
+    {
+      if (freeSlotPtr == nullptr)
+        freeSlotPtr = s;
+      continue;
+    }
+    if ((s->reference == pdu->concatReference) && (s->total == pdu->concatTotal) && (strcmp(s->address, pdu->address) == 0))
+      slot = s;
+    if ((oldest == nullptr) || ((millis() - s->startMillis) > (millis() - oldest->startMillis)))
+      oldest = s;
+  }
+
+  if (slot == nullptr)
+  {
+    if (freeSlotPtr == nullptr) // Evict the oldest incomplete message
+    {
+      freeSlot(oldest, true);
+      freeSlotPtr = oldest;
+    }
+    slot = freeSlotPtr;
+    slot->inUse = true;
+    strncpy(slot->address, pdu->address, sizeof(slot->address) - 1);
+    slot->address[sizeof(slot->address) - 1] = '\0';
+    slot->reference = pdu->concatReference;
+    slot->total = pdu->concatTotal;
+    slot->received = 0;
+    slot->startMillis = millis();
+  }
+
+  uint8_t part = pdu->concatSequence - 1;
+  memcpy(&slot->data[part * SARA_R5_SMS_MAX_DECODED_LENGTH], pdu->data, pdu->dataLength);
+  slot->partLength[part] = pdu->dataLength;
+  slot->received |= 1UL << part;
+
+  uint32_t allParts = (slot->total >= 32) ? 0xFFFFFFFF : ((1UL << slot->total) - 1);
+  if (slot->received != allParts)
+    return false;
+
+  // Complete. Move the parts together. Each part moves towards the start of data, so memmove is safe
+  size_t total = 0;
+  for (uint8_t i = 0; i < slot->total; i++)
+  {
+    memmove(&slot->data[total], &slot->data[i * SARA_R5_SMS_MAX_DECODED_LENGTH], slot->partLength[i]);
+    total += slot->partLength[i];
+  }
+  slot->inUse = false;
+  *message = slot->data;
+  *length = total;
+  return true;
+}
+
+void SARA_R5_Event_Queue::reset(void)
+{
+  _head = 0;
+  _tail = 0;
+  _highWater = 0;
+  _dropped = 0;
+}
+
+// The atomic builtins (GCC and clang) order the record copy and the index update, and are lock-free for uint8_t on every target
+bool SARA_R5_Event_Queue::push(const SARA_R5_event &event)
+{
+  uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+  uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+  uint8_t used = (uint8_t)(head - tail);
+
+  if (used >= SARA_R5_EVENT_QUEUE_SIZE)
+  {
+    _dropped++;
+    return false;
+  }
+
+  _events[head & (SARA_R5_EVENT_QUEUE_SIZE - 1)] = event;
+  __atomic_store_n(&_head, (uint8_t)(head + 1), __ATOMIC_RELEASE); // Publish the record
+
+  if (used + 1 > _highWater)
+    _highWater = used + 1;
+  return true;
+}
+
+bool SARA_R5_Event_Queue::pop(SARA_R5_event &event)
+{
+  uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+  uint8_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+  if (head == tail)
+    return false;
+
+  event = _events[tail & (SARA_R5_EVENT_QUEUE_SIZE - 1)];
+  __atomic_store_n(&_tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE); // Free the slot
+  return true;
+}
+
+uint8_t SARA_R5_Event_Queue::count(void) const
+{
+  return (uint8_t)(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE));
+}
+
+void SARA_R5_Signal_Window::reset(void)
+{
+  _next = 0;
+  _count = 0;
+  _known = 0;
+  _sum = 0;
+  _minHead = 0;
+  _minCount = 0;
+  _maxHead = 0;
+  _maxCount = 0;
+}
+
+void SARA_R5_Signal_Window::add(uint8_t value)
+{
+  if (_count == SARA_R5_SIGNAL_HISTORY_SIZE)
+  {
+    // Evict the oldest value. If it is in either queue, it is at the front
+    uint8_t oldest = _values[_next];
+    if (oldest != SARA_R5_SIGNAL_UNKNOWN)
+    {
+      _sum -= oldest;
+      _known--;
+    }
+    if ((_minCount > 0) && (_minQueue[_minHead] == _next))
+    {
+      _minHead = (_minHead + 1) % SARA_R5_SIGNAL_HISTORY_SIZE;
+      _minCount--;
+    }
+    if ((_maxCount > 0) && (_maxQueue[_maxHead] == _next))
+    {
+      _maxHead = (_maxHead + 1) % SARA_R5_SIGNAL_HISTORY_SIZE;
+      _maxCount--;
+    }
+  }
+  else
+  {
+    _count++;
+  }
+
+  _values[_next] = value;
+
+  if (value != SARA_R5_SIGNAL_UNKNOWN)
+  {
+    _sum += value;
+    _known++;
+
+    // Drop the values which can no longer be the min (or max) and append the new one
+    while ((_minCount > 0) && (_values[_minQueue[(_minHead + _minCount - 1) % SARA_R5_SIGNAL_HISTORY_SIZE]] >= value))
+      _minCount--;
+    _minQueue[(_minHead + _minCount) % SARA_R5_SIGNAL_HISTORY_SIZE] = _next;
+    _minCount++;
+
+    while ((_maxCount > 0) && (_values[_maxQueue[(_maxHead + _maxCount - 1) % SARA_R5_SIGNAL_HISTORY_SIZE]] <= value))
+      _maxCount--;
+    _maxQueue[(_maxHead + _maxCount) % SARA_R5_SIGNAL_HISTORY_SIZE] = _next;
+    _maxCount++;
+  }
+
+  _next = (_next + 1) % SARA_R5_SIGNAL_HISTORY_SIZE;
+}
+
+uint8_t SARA_R5_Signal_Window::get(uint8_t age) const
+{
+  if (age >= _count)
+    return SARA_R5_SIGNAL_UNKNOWN;
+  return _values[(_next + SARA_R5_SIGNAL_HISTORY_SIZE - 1 - age) % SARA_R5_SIGNAL_HISTORY_SIZE];
+}
+
+bool SARA_R5_Signal_Window::getStats(SARA_R5_signal_stats &stats) const
+{
+  stats.samples = _known;
+  if (_known == 0)
+  {
+    stats.min = SARA_R5_SIGNAL_UNKNOWN;
+    stats.max = SARA_R5_SIGNAL_UNKNOWN;
+    stats.mean = 0.0;
+    return false;
+  }
+  stats.min = _values[_minQueue[_minHead]];
+  stats.max = _values[_maxQueue[_maxHead]];
+  stats.mean = (float)_sum / (float)_known;
+  return true;
+}
+
+// MD5 (RFC 1321)
+
+static const uint32_t SARA_R5_md5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+static const uint8_t SARA_R5_md5Shift[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21}; // Four per round
+
+void SARA_R5_MD5::begin(void)
+{
+  _state[0] = 0x67452301;
+  _state[1] = 0xefcdab89;
+  _state[2] = 0x98badcfe;
+  _state[3] = 0x10325476;
+  _length = 0;
+}
+
+void SARA_R5_MD5::update(const uint8_t *data, size_t length)
+{
+  while (length > 0)
+  {
+    uint8_t used = _length & 0x3F;
+    size_t copy = 64 - used;
+    if (copy > length)
+      copy = length;
+    memcpy(&_block[used], data, copy);
+    _length += copy;
+    data += copy;
+    length -= copy;
+    if ((_length & 0x3F) == 0)
+      transform();
+  }
+}
+
+void SARA_R5_MD5::finish(uint8_t digest[16])
+{
+  uint32_t bits = _length << 3;
+  uint8_t used = _length & 0x3F;
+
+  _block[used++] = 0x80;
+  if (used > 56)
+  {
+    memset(&_block[used], 0, 64 - used);
+    transform();
+    used = 0;
+  }
+  memset(&_block[used], 0, 56 - used);
+  for (int i = 0; i < 4; i++)
+    _block[56 + i] = (uint8_t)(bits >> (8 * i));
+  _block[60] = (uint8_t)(_length >> 29); // The top of the 64-bit bit count
+  _block[61] = _block[62] = _block[63] = 0;
+  transform();
+
+  for (int i = 0; i < 16; i++)
+    digest[i] = (uint8_t)(_state[i >> 2] >> (8 * (i & 3)));
+  begin();
+}
+
+void SARA_R5_MD5::finish(char *hex)
+{
+  uint8_t digest[16];
+  const char hexDigits[] = "0123456789abcdef";
+
+  finish(digest);
+  for (int i = 0; i < 16; i++)
+  {
+    hex[i * 2] = hexDigits[digest[i] >> 4];
+    hex[(i * 2) + 1] = hexDigits[digest[i] & 0x0F];
+  }
+  hex[32] = '\0';
+}
+
+void SARA_R5_MD5::transform(void)
+{
+  uint32_t m[16];
+  uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+
+  for (int i = 0; i < 16; i++)
+    m[i] = (uint32_t)_block[i * 4] | ((uint32_t)_block[(i * 4) + 1] << 8) | ((uint32_t)_block[(i * 4) + 2] << 16) | ((uint32_t)_block[(i * 4) + 3] << 24);
+
+  for (int i = 0; i < 64; i++)
+  {
+    uint32_t f;
+    uint8_t g;
+    if (i < 16)
+    {
+      f = (b & c) | (~b & d);
+      g = i;
+    }
+    else if (i < 32)
+    {
+      f = (d & b) | (~d & c);
+      g = ((5 * i) + 1) & 0x0F;
+    }
+    else if (i < 48)
+    {
+      f = b ^ c ^ d;
+      g = ((3 * i) + 5) & 0x0F;
+    }
+    else
+    {
+      f = c ^ (b | ~d);
+      g = (7 * i) & 0x0F;
+    }
+    uint32_t x = a + f + SARA_R5_md5K[i] + m[g];
+    uint8_t shift = SARA_R5_md5Shift[((i >> 4) << 2) + (i & 3)];
+    a = d;
+    d = c;
+    c = b;
+    b = b + ((x << shift) | (x >> (32 - shift)));
+  }
+
+  _state[0] += a;
+  _state[1] += b;
+  _state[2] += c;
+  _state[3] += d;
+}
@@ -72,6 +72,43 @@
 
 #include <IPAddress.h>
 
+// Thread safety. Define SARA_R5_THREAD_SAFE (as a build flag) when more than one task calls the library.
+// Commands are serialized by a recursive mutex and startRxTask polls for URCs from a dedicated task.
+// ESP32 uses FreeRTOS. Other platforms (e.g. host builds) use the standard library
+#ifdef SARA_R5_THREAD_SAFE
+#ifdef ARDUINO_ARCH_ESP32
+#define SARA_R5_THREAD_FREERTOS
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#endif
+#endif
+
+// Interrupt routines must be in IRAM on ESP32 and ESP8266
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#define SARA_R5_ISR_ATTR IRAM_ATTR
+#else
+#define SARA_R5_ISR_ATTR
+#endif
+
+// Compile-time log level. Debug messages above this level are removed by the compiler, together with their strings.
+// The library is compiled separately from the sketch, so set this with a build flag (e.g. -DSARA_R5_LOG_LEVEL=0),
+// not with a #define in the sketch. enableDebugging and enableAtDebugging still switch the remaining messages on at run time
+#define SARA_R5_LOG_LEVEL_NONE 0
+#define SARA_R5_LOG_LEVEL_ERROR 1 // Failures and unexpected responses only
+#define SARA_R5_LOG_LEVEL_DEBUG 2 // Everything, including the AT debugging
+#ifndef SARA_R5_LOG_LEVEL
+#define SARA_R5_LOG_LEVEL SARA_R5_LOG_LEVEL_DEBUG
+#endif
+#define SARA_R5_LOG_ERROR_ENABLED ((SARA_R5_LOG_LEVEL >= SARA_R5_LOG_LEVEL_ERROR) && (_printDebug == true))
+#define SARA_R5_LOG_DEBUG_ENABLED ((SARA_R5_LOG_LEVEL >= SARA_R5_LOG_LEVEL_DEBUG) && (_printDebug == true))
+#define SARA_R5_LOG_AT_ENABLED ((SARA_R5_LOG_LEVEL >= SARA_R5_LOG_LEVEL_DEBUG) && (true == _printAtDebug))
+
 #define SARA_R5_POWER_PIN -1 // Default to no pin
 #define SARA_R5_RESET_PIN -1
 
@@ -84,6 +121,7 @@
 #define SARA_R5_SET_BAUD_TIMEOUT 500
 #define SARA_R5_POWER_OFF_PULSE_PERIOD 3200 // Hold PWR_ON low for this long to power the module off
 #define SARA_R5_POWER_ON_PULSE_PERIOD 100 // Hold PWR_ON low for this long to power the module on (SARA-R510M8S)
+#define SARA_R5_RING_POLL_WINDOW 100 // After RI is asserted, keep polling for this many millis so the whole URC is read
 #define SARA_R5_RESET_PULSE_PERIOD 23000 // Used to perform an abrupt emergency hardware shutdown. 23 seconds... (Yes, really!)
 #define SARA_R5_POWER_OFF_TIMEOUT 40000 // Datasheet says 40 seconds...
 #define SARA_R5_IP_CONNECT_TIMEOUT 130000
@@ -126,10 +164,12 @@ const char SARA_R5_SEND_TEXT[] = "+CMGS";          // Send SMS message
 const char SARA_R5_NEW_MESSAGE_IND[] = "+CNMI";    // New [SMS] message indication
 const char SARA_R5_PREF_MESSAGE_STORE[] = "+CPMS"; // Preferred message storage
 const char SARA_R5_READ_TEXT_MESSAGE[] = "+CMGR";  // Read message
+const char SARA_R5_LIST_MESSAGES[] = "+CMGL";      // List messages
 const char SARA_R5_DELETE_MESSAGE[] = "+CMGD";     // Delete message
 // V24 control and V25ter (UART interface)
 const char SARA_R5_FLOW_CONTROL[] = "&K";   // Flow control
 const char SARA_R5_COMMAND_BAUD[] = "+IPR"; // Baud rate
+const char SARA_R5_UART_POWER_SAVING[] = "+UPSV"; // UART power saving
 // ### Packet switched data services
 const char SARA_R5_MESSAGE_PDP_DEF[] = "+CGDCONT";            // Packet switched Data Profile context definition
 const char SARA_R5_MESSAGE_PDP_CONFIG[] = "+UPSD";            // Packet switched Data Profile configuration
@@ -143,6 +183,7 @@ const char SARA_R5_COMMAND_GPIO[] = "+UGPIOC"; // GPIO Configuration
 const char SARA_R5_CREATE_SOCKET[] = "+USOCR";      // Create a new socket
 const char SARA_R5_CLOSE_SOCKET[] = "+USOCL";       // Close a socket
 const char SARA_R5_CONNECT_SOCKET[] = "+USOCO";     // Connect to server on socket
+const char SARA_R5_SECURE_SOCKET[] = "+USOSEC";     // Enable or disable SSL/TLS on a socket
 const char SARA_R5_WRITE_SOCKET[] = "+USOWR";       // Write data to a socket
 const char SARA_R5_WRITE_UDP_SOCKET[] = "+USOST";   // Write data to a UDP socket
 const char SARA_R5_READ_SOCKET[] = "+USORD";        // Read from a socket
@@ -152,6 +193,7 @@ const char SARA_R5_GET_ERROR[] = "+USOER";          // Get last socket error.
 const char SARA_R5_SOCKET_DIRECT_LINK[] = "+USODL"; // Set socket in Direct Link mode
 const char SARA_R5_SOCKET_CONTROL[] = "+USOCTL";    // Query the socket parameters
 const char SARA_R5_UD_CONFIGURATION[] = "+UDCONF";  // User Datagram Configuration
+const char SARA_R5_DNS_RESOLUTION[] = "+UDNSRN";    // Resolve name / IP number through DNS
 // ### Ping
 const char SARA_R5_PING_COMMAND[] = "+UPING"; // Ping
 // ### HTTP
@@ -205,6 +247,10 @@ const char SARA_R5_PING_COMMAND_URC[] = "+UUPING:";
 const char SARA_R5_REGISTRATION_STATUS_URC[] = "+CREG:";
 const char SARA_R5_EPSREGISTRATION_STATUS_URC[] = "+CEREG:";
 const char SARA_R5_FTP_COMMAND_URC[] = "+UUFTPCR:";
+const char SARA_R5_GNSS_ASSISTED_IND_URC[] = "+UUGIND:";
+const char SARA_R5_NEW_MESSAGE_STORED_URC[] = "+CMTI:";
+const char SARA_R5_NEW_MESSAGE_URC[] = "+CMT:";
+const char SARA_R5_MESSAGE_PDP_DEACTIVATED_URC[] = "+UUPSDD:";
 
 // ### Response
 const char SARA_R5_RESPONSE_MORE[] = "\n>";
@@ -227,8 +273,71 @@ const char ASCII_ESC = 0x1B;
 // This needs to be large enough to hold the response you're expecting plus and URC's that may arrive during the timeout
 #define minimumResponseAllocation 128
 
+#define SARA_R5_SMS_LIST_HEADER_LENGTH 128  // listSMS: maximum length of a +CMGL header line
+#define SARA_R5_SMS_LIST_MESSAGE_LENGTH 512 // listSMS: size of the message buffer. Messages are truncated to (SARA_R5_SMS_LIST_MESSAGE_LENGTH - SARA_R5_SMS_LIST_HEADER_LENGTH - 1) chars
+#define SARA_R5_NEW_SMS_QUEUE_SIZE 8 // The maximum number of +CMTI storage indexes waiting to be read
+#define SARA_R5_NEW_SMS_RETRIES 3 // The number of times a +CMTI message is read before it is left in storage
+#define SARA_R5_NEW_SMS_RETRY_INTERVAL 1000 // The interval between reads of a +CMTI message which could not be read (millis)
+
 #define SARA_R5_NUM_SOCKETS 6
 
+#define SARA_R5_NETWORK_STATE_REFRESH_INTERVAL 30000 // Default +CSQ / +CESQ refresh interval for the cached network state (millis)
+
+// Clock model
+#define SARA_R5_CLOCK_RESYNC_INTERVAL 3600000 // Default +CCLK resync interval (millis)
+#define SARA_R5_CLOCK_MAX_DRIFT_PPM 1000      // Larger drift estimates are ignored
+#define SARA_R5_CLOCK_DRIFT_UNCERTAINTY 20    // Only update the drift estimate when the sync uncertainty is below this many ppm
+#define SARA_R5_CLOCK_ANCHOR_MAX_AGE 2000000000UL // Move the drift anchor before millis() - anchor can wrap (millis)
+
+// SNTP client
+#define SARA_R5_SNTP_MAX_SERVERS 4
+#define SARA_R5_SNTP_PORT 123
+#define SARA_R5_SNTP_TIMEOUT 5000 // Wait this long for the responses (millis)
+#define SARA_R5_SNTP_PACKET_LENGTH 48
+
+typedef enum
+{
+  SARA_R5_SNTP_APPLY_NONE = 0,
+  SARA_R5_SNTP_APPLY_CLOCK_MODEL = 1, // setClockEpoch
+  SARA_R5_SNTP_APPLY_CCLK = 2         // setClock. The module clock is set to UTC (TZ 0)
+} SARA_R5_sntp_apply_t;
+
+// The local timestamps are host millis(), not module times. T1 is taken just before the +USOST command is sent,
+// T4 once the +UUSORF URC has been processed and the +USORF read has completed. So the delay includes the
+// AT command and serial latency in both directions as well as the network delay. That latency is not symmetric
+// (the receive side is usually longer), which biases epochMillis. The bias is within accuracyMillis
+struct SARA_R5_sntp_result
+{
+  uint64_t epochMillis;  // UTC (millis since 1970) at...
+  unsigned long localMillis; // ...this value of millis() (T4)
+  int32_t offsetMillis;  // Server time minus clock model time. 0 if the clock model was not valid
+  uint32_t delayMillis;  // Round trip delay (T4 - T1), less the server processing time. Includes the AT command and serial latency
+  uint16_t accuracyMillis; // Half the round trip delay, plus the server's root dispersion
+  uint8_t stratum;
+  IPAddress server;      // The server which was used (the one with the lowest delay)
+  uint8_t responses;     // The number of valid responses received
+};
+
+// DNS cache
+#ifndef SARA_R5_DNS_CACHE_SIZE
+#define SARA_R5_DNS_CACHE_SIZE 4 // The number of hostnames cached. The least recently used entry is replaced
+#endif
+#define SARA_R5_DNS_HOST_LENGTH 64 // Longer hostnames are not cached
+#define SARA_R5_DNS_CACHE_TTL 300000 // Time to live used by setDNSCacheTTL() (millis). +UDNSRN does not report the record TTL
+
+// Connection manager
+#define SARA_R5_CONNECTION_BACKOFF_MIN 1000   // The first retry is after 1 second...
+#define SARA_R5_CONNECTION_BACKOFF_MAX 64000  // ...doubling up to 64 seconds
+#define SARA_R5_CONNECTION_POLL_INTERVAL 5000 // Check the registration this often (the +CEREG URCs are usually faster)
+#define SARA_R5_CONNECTION_ACTIVATION_TIMEOUT 30000 // Wait this long for the +UUPSDA
+#ifndef SARA_R5_NUM_MANAGED_SOCKETS
+#define SARA_R5_NUM_MANAGED_SOCKETS 4
+#endif
+#define SARA_R5_MANAGED_SOCKET_HOST_LENGTH 64
+
+#define SARA_R5_NUM_LOCATION_REQUESTS 4 // The maximum number of queued asynchronous location requests
+#define SARA_R5_LOCATION_REQUEST_MARGIN 5000 // Allow this many millis on top of the +ULOC timeout for the +UULOC to arrive
+
 #define NUM_SUPPORTED_BAUD 6
 const unsigned long SARA_R5_SUPPORTED_BAUD[NUM_SUPPORTED_BAUD] =
     {
@@ -248,6 +357,22 @@ typedef enum
   SARA_R5_ENABLE_FLOW_CONTROL = 3
 } SARA_R5_flow_control_t;
 
+// UART power saving modes for AT+UPSV
+typedef enum
+{
+  SARA_R5_UPSV_DISABLED = 0,
+  SARA_R5_UPSV_TIMEOUT = 1, // The module sleeps after timeout frames of UART inactivity. Any character wakes it, but that character is lost
+  SARA_R5_UPSV_DTR = 3      // The module can sleep while DTR is OFF (high). The library drives DTR
+} SARA_R5_upsv_mode_t;
+
+#define SARA_R5_UPSV_DEFAULT_TIMEOUT 2000 // GSM frames (4.615ms). About 9.2s
+#define SARA_R5_UPSV_FRAME_MICROS 4615
+#define SARA_R5_UPSV_WAKE_MARGIN 100   // millis. Wake the module if it has been idle for longer than the timeout, less this margin
+#define SARA_R5_UPSV_WAKE_DELAY 5      // millis. Default wait after the wake character or asserting DTR
+#define SARA_R5_UPSV_WAKE_TIMEOUT 50   // millis. Timeout for each wake-up AT
+#define SARA_R5_UPSV_WAKE_RETRIES 3
+#define SARA_R5_UPSV_DTR_HOLD 50       // millis. DTR is released once the UART has been idle for this long
+
 // The standard Europe profile should be used as the basis for all other MNOs in Europe outside of Vodafone
 // and Deutsche Telekom. However, there may be changes that need to be applied to the module for proper
 // operation with any given European MNO such as attach type, RAT preference, band selection, etc. Please
@@ -286,7 +411,8 @@ typedef enum
   SARA_R5_ERROR_NO_RESPONSE,          // 5
   SARA_R5_ERROR_DEREGISTERED,         // 6
   SARA_R5_ERROR_ZERO_READ_LENGTH,     // 7
-  SARA_R5_ERROR_ERROR                 // 8
+  SARA_R5_ERROR_ERROR,                // 8
+  SARA_R5_ERROR_BUSY                  // 9 - e.g. an operator scan is in progress
 } SARA_R5_error_t;
 #define SARA_R5_SUCCESS SARA_R5_ERROR_SUCCESS
 
@@ -355,6 +481,19 @@ struct operator_stats
   uint8_t act;
 };
 
+// Fixed-size operator details, as reported by startOperatorScan
+struct SARA_R5_operator
+{
+  uint8_t stat;       // 0: unknown, 1: available, 2: current, 3: forbidden
+  char longOp[25];
+  char shortOp[11];
+  unsigned long numOp; // Numeric PLMN (MCC and MNC), e.g. 310410
+  uint8_t mncDigits;   // 2 or 3
+  uint8_t act;
+};
+
+#define SARA_R5_OPERATOR_SCAN_LINE_LENGTH 128 // Holds one operator tuple, or one URC line received during the scan
+
 typedef struct ext_signal_quality_ {
     unsigned int rxlev;
     unsigned int ber;
@@ -364,6 +503,25 @@ typedef struct ext_signal_quality_ {
     unsigned int rsrp;
 } signal_quality;
 
+// Cached network state. Updated from the +CREG / +CEREG URCs (and query responses) and the +CSQ / +CESQ refreshes
+struct SARA_R5_network_state
+{
+  SARA_R5_registration_status_t status;    // +CREG
+  unsigned int lac;
+  uint32_t ci;
+  int act;                                 // Access technology. -1 if not known
+  unsigned long statusMillis;              // millis() when the +CREG state was last updated. 0 if never
+  SARA_R5_registration_status_t epsStatus; // +CEREG
+  unsigned int tac;
+  uint32_t epsCi;
+  int epsAct;
+  unsigned long epsStatusMillis;
+  int rssi;                                // +CSQ <rssi>: 0-31, 99 = not known
+  unsigned long rssiMillis;
+  signal_quality signal;                   // +CESQ
+  unsigned long signalMillis;
+};
+
 typedef enum
 {
   SARA_R5_TCP = 6,
@@ -391,6 +549,22 @@ typedef enum
   SARA_R5_MESSAGE_FORMAT_TEXT = 1
 } SARA_R5_message_format_t;
 
+typedef enum
+{
+  SARA_R5_SMS_STATUS_REC_UNREAD = 0,
+  SARA_R5_SMS_STATUS_REC_READ,
+  SARA_R5_SMS_STATUS_STO_UNSENT,
+  SARA_R5_SMS_STATUS_STO_SENT,
+  SARA_R5_SMS_STATUS_ALL
+} SARA_R5_sms_status_t;
+
+typedef enum
+{
+  SARA_R5_NEW_SMS_INDICATION_NONE = 0,   // No new message indication
+  SARA_R5_NEW_SMS_INDICATION_STORED = 1, // +CMTI: the message is stored and its index is indicated
+  SARA_R5_NEW_SMS_INDICATION_DIRECT = 2  // +CMT: the message is routed directly to the host without being stored
+} SARA_R5_new_sms_indication_t;
+
 typedef enum
 {
   SARA_R5_UTIME_MODE_STOP = 0,
@@ -570,6 +744,15 @@ typedef enum
   SARA_R5_PSD_ACTION_DEACTIVATE
 } SARA_R5_pdp_actions_t;
 
+typedef enum
+{
+  SARA_R5_CONNECTION_STOPPED = 0,
+  SARA_R5_CONNECTION_REGISTERING, // Waiting for network registration
+  SARA_R5_CONNECTION_ACTIVATING,  // Waiting for the PSD profile to be activated (+UUPSDA)
+  SARA_R5_CONNECTION_CONNECTED,   // The data path is up. The managed sockets are (re)opened
+  SARA_R5_CONNECTION_BACKOFF      // Waiting before the next attempt
+} SARA_R5_connection_state_t;
+
 typedef enum
 {
   SARA_R5_SEC_PROFILE_PARAM_CERT_VAL_LEVEL = 0,
@@ -583,8 +766,19 @@ typedef enum
   SARA_R5_SEC_PROFILE_PARAM_PSK,
   SARA_R5_SEC_PROFILE_PARAM_PSK_IDENT,
   SARA_R5_SEC_PROFILE_PARAM_SNI,
+  SARA_R5_SEC_PROFILE_PARAM_TLS_SESSION_RESUMPTION = 13, // Not supported by all firmware versions
 } SARA_R5_sec_profile_parameter_t;
 
+// One setting of a security profile, for applySecurityProfile
+struct SARA_R5_sec_profile_setting
+{
+  SARA_R5_sec_profile_parameter_t parameter;
+  int value;          // Used if string is nullptr
+  const char *string; // e.g. the internal name of a certificate, or the server hostname
+};
+
+#define SARA_R5_SEC_PROFILE_FINGERPRINT_PREFIX "secprf" // applySecurityProfile stores the profile fingerprint in secprf<profile>.md5
+
 typedef enum
 {
   SARA_R5_SEC_PROFILE_CERTVAL_OPCODE_NO = 0,
@@ -610,8 +804,13 @@ typedef enum
 typedef enum
 {
     SARA_R5_SEC_MANAGER_OPCODE_IMPORT = 0,
+    SARA_R5_SEC_MANAGER_OPCODE_LIST = 3,
+    SARA_R5_SEC_MANAGER_OPCODE_MD5 = 4,
 } SARA_R5_sec_manager_opcode_t;
 
+#define SARA_R5_SEC_MANAGER_CHUNK_LENGTH 64 // Certificates and keys are streamed to the module in chunks of this many bytes
+#define SARA_R5_SEC_MANAGER_MD5_LENGTH 33   // MD5 as 32 hex digits, plus the NULL
+
 typedef enum
 {
     SARA_R5_SEC_MANAGER_ROOTCA = 0,
@@ -635,6 +834,475 @@ typedef enum
   //DEEP_LOW_POWER_STATE = 127 // Not supported on SARA-R5
 } SARA_R5_functionality_t;
 
+// RTCM3 framing
+// RTCM3 frames are: preamble (0xD3), 6 reserved bits + 10-bit length, payload (0-1023 bytes), 24-bit CRC-24Q
+#define SARA_R5_RTCM3_PREAMBLE 0xD3
+#define SARA_R5_RTCM3_HEADER_LENGTH 3
+#define SARA_R5_RTCM3_CRC_LENGTH 3
+#define SARA_R5_RTCM3_MAX_PAYLOAD_LENGTH 1023
+#define SARA_R5_RTCM3_MAX_FRAME_LENGTH (SARA_R5_RTCM3_HEADER_LENGTH + SARA_R5_RTCM3_MAX_PAYLOAD_LENGTH + SARA_R5_RTCM3_CRC_LENGTH)
+#define SARA_R5_RTCM3_MAX_MSG_TYPES 24   // The number of message types we keep statistics for
+#define SARA_R5_RTCM3_MAX_FILTER_TYPES 16 // The maximum number of message types in the filter
+
+struct SARA_R5_rtcm3_msg_stats
+{
+  uint16_t type;            // RTCM3 message type (e.g. 1005, 1077)
+  uint32_t count;           // Number of valid frames received with this type
+  unsigned long lastMillis; // millis() when the last valid frame of this type was received
+};
+
+// Reassembles RTCM3 frames from arbitrary chunks of data (e.g. +USORD reads) and checks the CRC-24Q.
+// Only complete, valid (and not filtered) frames are passed to the frame callback.
+class SARA_R5_RTCM3_Framer
+{
+public:
+  SARA_R5_RTCM3_Framer(void);
+  ~SARA_R5_RTCM3_Framer(void);
+
+  bool begin(void); // Allocate the frame buffer. Returns false if there is not enough memory
+  void reset(void); // Discard any partial frame and clear the statistics
+
+  void setFrameCallback(void (*frameCallback)(const uint8_t *frame, uint16_t length, void *context), void *context = nullptr);
+
+  // Only forward frames with these message types. Call with numTypes = 0 to forward all message types
+  bool setMessageFilter(const uint16_t *types, uint8_t numTypes);
+
+  // Push received data into the framer. Frames can be split across calls. Returns the number of frames forwarded
+  uint16_t process(const uint8_t *data, size_t length);
+
+  // Statistics
+  uint32_t framesForwarded(void) { return _framesForwarded; }
+  uint32_t framesFiltered(void) { return _framesFiltered; }
+  uint32_t crcErrors(void) { return _crcErrors; }
+  uint32_t bytesDiscarded(void) { return _bytesDiscarded; }
+  uint8_t numMessageTypes(void) { return _numStats; }
+  const SARA_R5_rtcm3_msg_stats *messageStats(uint8_t index); // Returns nullptr if index is out of range
+  uint32_t messageCount(uint16_t type);
+  unsigned long messageAge(uint16_t type); // Milliseconds since the last frame of this type. 0xFFFFFFFF if never seen
+
+  // CRC-24Q (as used by RTCM3 and SBAS). Nibble-table driven
+  static uint32_t crc24q(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+protected:
+  uint8_t *_frame = nullptr; // Allocated in begin
+  uint16_t _frameLength = 0; // Number of bytes currently held in _frame
+
+  void (*_frameCallback)(const uint8_t *, uint16_t, void *) = nullptr;
+  void *_frameCallbackContext = nullptr;
+
+  uint16_t _filter[SARA_R5_RTCM3_MAX_FILTER_TYPES];
+  uint8_t _numFilter = 0;
+
+  SARA_R5_rtcm3_msg_stats _stats[SARA_R5_RTCM3_MAX_MSG_TYPES];
+  uint8_t _numStats = 0;
+
+  uint32_t _framesForwarded = 0;
+  uint32_t _framesFiltered = 0;
+  uint32_t _crcErrors = 0;
+  uint32_t _bytesDiscarded = 0;
+
+  uint16_t parseFrames(void); // Extract all of the complete frames held in _frame
+  void discardBytes(uint16_t num); // Remove num bytes from the start of _frame
+  void updateStats(uint16_t type);
+  bool passesFilter(uint16_t type);
+};
+
+// SMS PDU mode (3GPP TS 23.040)
+#define SARA_R5_SMS_MAX_USER_DATA_LENGTH 140 // octets
+#define SARA_R5_SMS_MAX_TPDU_LENGTH 164      // TPDU header (up to 24 octets) + user data
+#define SARA_R5_SMS_MAX_PDU_HEX_LENGTH (((1 + SARA_R5_SMS_MAX_TPDU_LENGTH) * 2) + 1) // SCA octet + TPDU as hex, plus the NULL
+#ifndef SARA_R5_SMS_MAX_DECODED_LENGTH
+#define SARA_R5_SMS_MAX_DECODED_LENGTH 256 // Decoded user data: UTF-8 for GSM 7-bit and UCS2, raw bytes for 8-bit data
+#endif
+#define SARA_R5_SMS_VALIDITY_PERIOD 0xA7 // Relative validity period used for SMS-SUBMIT. 0xA7 = 24 hours
+#ifndef SARA_R5_SMS_REASSEMBLY_SLOTS
+#define SARA_R5_SMS_REASSEMBLY_SLOTS 2 // The number of concatenated messages which can be reassembled at the same time
+#endif
+#ifndef SARA_R5_SMS_REASSEMBLY_MAX_PARTS
+#define SARA_R5_SMS_REASSEMBLY_MAX_PARTS 4 // The maximum number of parts in a reassembled message (up to 32)
+#endif
+#define SARA_R5_SMS_REASSEMBLY_TIMEOUT 300000 // Discard incomplete concatenated messages after this many millis
+
+typedef enum
+{
+  SARA_R5_SMS_ENCODING_GSM7 = 0, // GSM 7-bit default alphabet (data is UTF-8 text)
+  SARA_R5_SMS_ENCODING_8BIT,     // 8-bit binary data
+  SARA_R5_SMS_ENCODING_UCS2      // UCS2 (data is UTF-8 text)
+} SARA_R5_sms_encoding_t;
+
+typedef enum
+{
+  SARA_R5_SMS_PDU_DELIVER = 0,
+  SARA_R5_SMS_PDU_SUBMIT = 1,
+  SARA_R5_SMS_PDU_STATUS_REPORT = 2
+} SARA_R5_sms_pdu_type_t;
+
+struct SARA_R5_sms_pdu
+{
+  SARA_R5_sms_pdu_type_t type;
+  char address[21];         // Originator (DELIVER), destination (SUBMIT) or recipient (STATUS-REPORT)
+  char timestamp[21];       // Service centre time stamp "yy/MM/dd,hh:mm:ss+zz" (DELIVER and STATUS-REPORT)
+  uint8_t messageReference; // SUBMIT and STATUS-REPORT
+  uint8_t status;           // STATUS-REPORT: TP-Status. 0x00 = delivered
+  char dischargeTime[21];   // STATUS-REPORT: delivery (discharge) time
+  SARA_R5_sms_encoding_t encoding;
+  bool concatenated;        // true if this is one part of a concatenated message
+  uint16_t concatReference;
+  uint8_t concatTotal;
+  uint8_t concatSequence;   // 1 to concatTotal
+  bool truncated;           // true if the decoded data did not fit in data
+  uint16_t dataLength;
+  uint8_t data[SARA_R5_SMS_MAX_DECODED_LENGTH + 1]; // NULL-terminated for convenience
+};
+
+// Allocation-free SMS PDU encoder / decoder
+class SARA_R5_SMS_PDU
+{
+public:
+  // Return the number of segments needed to send length bytes of data (UTF-8 text for GSM 7-bit and UCS2). 0 if too long.
+  // A single message carries 160 GSM 7-bit / 70 UCS2 chars or 140 bytes. Concatenated parts carry 153 / 67 / 134.
+  static uint8_t segmentsNeeded(const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding);
+
+  // Encode segment (1 to segmentsNeeded) of data as an SMS-SUBMIT PDU in hex (including the SCA "00"), ready for +CMGS.
+  // pduHexSize should be at least SARA_R5_SMS_MAX_PDU_HEX_LENGTH. Returns the TPDU length for +CMGS, or -1 on error.
+  static int encodeSubmit(char *pduHex, size_t pduHexSize, const char *destination,
+                          const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding,
+                          uint8_t segment = 1, uint8_t concatReference = 0, bool statusReport = false);
+
+  // Decode a hex PDU - as returned by +CMGR, +CMGL and +CMT in PDU mode - starting with the SCA
+  static bool decode(const char *pduHex, SARA_R5_sms_pdu *pdu);
+
+  // true if all of the text can be encoded with the GSM 7-bit default alphabet and extension table
+  static bool isGSM7(const uint8_t *text, size_t length);
+
+  // Pack / unpack GSM 7-bit septets. fillBits is the number of padding bits after a user data header
+  static size_t gsm7Pack(const uint8_t *septets, size_t numSeptets, uint8_t *dest, size_t destSize, uint8_t fillBits = 0); // Returns the number of octets
+  static size_t gsm7Unpack(const uint8_t *src, size_t srcLength, uint8_t *septets, size_t numSeptets, uint8_t fillBits = 0); // Returns the number of septets
+
+protected:
+  static bool segmentBounds(const uint8_t *data, size_t length, SARA_R5_sms_encoding_t encoding,
+                            uint8_t segment, size_t *start, size_t *end, uint8_t *numSegments);
+  static uint32_t nextChar(const uint8_t *data, size_t length, size_t *index, SARA_R5_sms_encoding_t encoding);
+  static uint8_t charCost(uint32_t c, SARA_R5_sms_encoding_t encoding); // In septets, UCS2 units or octets
+  static int gsm7FromUnicode(uint32_t c);                  // Returns the septet, 0x1Bxx for the extension table, or -1
+  static uint32_t unicodeFromGSM7(uint8_t septet, bool escaped);
+  static void appendUTF8(uint32_t c, SARA_R5_sms_pdu *pdu);
+  static size_t encodeAddress(const char *address, uint8_t *dest);
+  static bool decodeAddress(const uint8_t *tpdu, size_t length, size_t *index, char *dest, size_t destSize);
+  static void decodeTimestamp(const uint8_t *src, char *dest);
+};
+
+// Reassembles concatenated messages from their decoded parts using a fixed number of slots
+class SARA_R5_SMS_Reassembler
+{
+public:
+  SARA_R5_SMS_Reassembler(void);
+  void reset(void);
+
+  // Add a decoded message. Returns true when a complete message is available. message and length then point to the
+  // user data, which remains valid until the next call to add. Messages which are not concatenated are returned immediately.
+  bool add(const SARA_R5_sms_pdu *pdu, const uint8_t **message, size_t *length);
+
+  uint32_t partsDropped(void) { return _partsDropped; } // Parts which could not be stored (too many parts, evicted, expired)
+
+protected:
+  struct SARA_R5_sms_reassembly_slot
+  {
+    bool inUse;
+    char address[21];
+    uint16_t reference;
+    uint8_t total;
+    uint32_t received; // Bit n is set when part n+1 has been received
+    unsigned long startMillis;
+    uint16_t partLength[SARA_R5_SMS_REASSEMBLY_MAX_PARTS];
+    uint8_t data[SARA_R5_SMS_REASSEMBLY_MAX_PARTS * SARA_R5_SMS_MAX_DECODED_LENGTH];
+  };
+  SARA_R5_sms_reassembly_slot _slots[SARA_R5_SMS_REASSEMBLY_SLOTS];
+  uint32_t _partsDropped = 0;
+
+  void freeSlot(SARA_R5_sms_reassembly_slot *slot, bool dropped);
+};
+
+// Signal quality history
+#ifndef SARA_R5_SIGNAL_HISTORY_SIZE
+#define SARA_R5_SIGNAL_HISTORY_SIZE 32 // The number of samples kept (up to 255)
+#endif
+#define SARA_R5_SIGNAL_HISTORY_INTERVAL 60000 // Default sample interval (millis)
+#define SARA_R5_SIGNAL_UNKNOWN 255 // +CESQ: not known or not detectable
+
+typedef enum
+{
+  SARA_R5_SIGNAL_RSRP = 0, // +CESQ <rsrp>: 0-97. dBm = value - 141
+  SARA_R5_SIGNAL_RSRQ      // +CESQ <rsrq>: 0-34. dB = (value / 2) - 20
+} SARA_R5_signal_metric_t;
+
+struct SARA_R5_signal_sample
+{
+  unsigned long millis; // millis() when the sample was taken
+  uint8_t rsrp;         // SARA_R5_SIGNAL_UNKNOWN if not known
+  uint8_t rsrq;
+};
+
+struct SARA_R5_signal_stats
+{
+  uint8_t min;     // In +CESQ units. Higher is better
+  uint8_t max;
+  float mean;
+  uint8_t samples; // The number of known samples the statistics are based on
+};
+
+// Rolling min / max / mean of the last SARA_R5_SIGNAL_HISTORY_SIZE values of one metric.
+// add and getStats are O(1) (amortized for add): the min and max are kept at the front of monotonic queues
+class SARA_R5_Signal_Window
+{
+public:
+  SARA_R5_Signal_Window(void) { reset(); }
+  void reset(void);
+  void add(uint8_t value); // SARA_R5_SIGNAL_UNKNOWN values are stored but excluded from the statistics
+  uint8_t get(uint8_t age) const; // age 0 is the newest value
+  uint8_t count(void) const { return _count; }
+  bool getStats(SARA_R5_signal_stats &stats) const; // Returns false if there are no known values
+
+protected:
+  uint8_t _values[SARA_R5_SIGNAL_HISTORY_SIZE];
+  uint8_t _next;  // Where the next value will be written
+  uint8_t _count;
+  uint8_t _known; // The number of values which are not SARA_R5_SIGNAL_UNKNOWN
+  uint16_t _sum;  // Sum of the known values
+
+  // Indexes into _values, oldest first. _values is increasing along _minQueue and decreasing along _maxQueue
+  uint8_t _minQueue[SARA_R5_SIGNAL_HISTORY_SIZE];
+  uint8_t _minHead, _minCount;
+  uint8_t _maxQueue[SARA_R5_SIGNAL_HISTORY_SIZE];
+  uint8_t _maxHead, _maxCount;
+};
+
+// URC event queue. When enabled, the URCs are decoded into events instead of calling the callbacks from inside bufferedPoll.
+// The sketch removes them with readEvent, or calls the callbacks at its own pace with dispatchEvents
+#ifndef SARA_R5_EVENT_QUEUE_SIZE
+#define SARA_R5_EVENT_QUEUE_SIZE 16 // Must be a power of two, up to 128
+#endif
+#if (SARA_R5_EVENT_QUEUE_SIZE > 128) || ((SARA_R5_EVENT_QUEUE_SIZE & (SARA_R5_EVENT_QUEUE_SIZE - 1)) != 0)
+#error SARA_R5_EVENT_QUEUE_SIZE must be a power of two, up to 128
+#endif
+#define SARA_R5_EVENT_HOST_LENGTH 32 // Ping host names are truncated to fit, including the NULL
+
+typedef enum
+{
+  SARA_R5_EVENT_SOCKET_DATA = 0, // +UUSORD / +UUSORF. The data has not been read. dispatchEvents reads it for the socket read callbacks
+  SARA_R5_EVENT_SOCKET_LISTEN,   // +UUSOLI
+  SARA_R5_EVENT_SOCKET_CLOSED,   // +UUSOCL
+  SARA_R5_EVENT_SIM_STATE,       // +UUSIMSTAT
+  SARA_R5_EVENT_PSD_ACTION,      // +UUPSDA
+  SARA_R5_EVENT_HTTP_RESULT,     // +UUHTTPCR
+  SARA_R5_EVENT_MQTT_RESULT,     // +UUMQTTC
+  SARA_R5_EVENT_FTP_RESULT,      // +UUFTPCR
+  SARA_R5_EVENT_PING,            // +UUPING
+  SARA_R5_EVENT_REGISTRATION,    // +CREG
+  SARA_R5_EVENT_EPS_REGISTRATION // +CEREG
+} SARA_R5_event_type_t;
+
+struct SARA_R5_event
+{
+  SARA_R5_event_type_t type;
+  unsigned long millis; // millis() when the URC was processed
+  union
+  {
+    struct
+    {
+      int socket;
+      int length;
+      bool udp; // Read with +USORF
+    } socketData;
+    struct
+    {
+      int listenSocket;
+      uint8_t localIP[4];
+      unsigned int listenPort;
+      int socket;
+      uint8_t remoteIP[4];
+      unsigned int port;
+    } socketListen;
+    struct
+    {
+      int socket;
+    } socketClosed;
+    struct
+    {
+      SARA_R5_sim_states_t state;
+    } simState;
+    struct
+    {
+      int result;
+      uint8_t ip[4];
+    } psdAction;
+    struct
+    {
+      int profile;
+      int command;
+      int result;
+    } http;
+    struct
+    {
+      int command;
+      int result;
+    } result; // MQTT and FTP
+    struct
+    {
+      int retry;
+      int size;
+      char host[SARA_R5_EVENT_HOST_LENGTH];
+      uint8_t ip[4];
+      int ttl;
+      long rtt;
+    } ping;
+    struct
+    {
+      SARA_R5_registration_status_t status;
+      unsigned int lac; // TAC for +CEREG
+      unsigned long ci;
+      int act;
+    } registration;
+  };
+};
+
+// Lock-free single-producer / single-consumer ring. The producer (bufferedPoll) only writes _head
+// and the consumer only writes _tail, so each side can run in a different task without a mutex
+class SARA_R5_Event_Queue
+{
+public:
+  SARA_R5_Event_Queue(void) { reset(); }
+  void reset(void); // Not safe while the producer or consumer is running
+  bool push(const SARA_R5_event &event); // Returns false (and counts the drop) if the queue is full
+  bool pop(SARA_R5_event &event); // Returns false if the queue is empty
+  uint8_t count(void) const;
+  uint8_t highWater(void) const { return _highWater; }
+  uint32_t dropped(void) const { return _dropped; }
+
+protected:
+  SARA_R5_event _events[SARA_R5_EVENT_QUEUE_SIZE];
+  uint8_t _head; // Incremented by push. The indexes run freely and are masked on use
+  uint8_t _tail; // Incremented by pop
+  uint8_t _highWater;
+  uint32_t _dropped;
+};
+
+// Per-command statistics. Define SARA_R5_ENABLE_COMMAND_STATS (as a build flag) to include them
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+#ifndef SARA_R5_COMMAND_STATS_SIZE
+#define SARA_R5_COMMAND_STATS_SIZE 16 // The number of command prefixes tracked. Further prefixes share the last entry ("*")
+#endif
+#define SARA_R5_COMMAND_STATS_PREFIX_LENGTH 12 // e.g. "+USOWR>", plus the NULL
+#define SARA_R5_COMMAND_STATS_BUCKETS 16 // Latency buckets: <1ms, 1ms, 2-3ms, 4-7ms, ... >=16384ms
+
+struct SARA_R5_command_stats
+{
+  char prefix[SARA_R5_COMMAND_STATS_PREFIX_LENGTH]; // The command up to the '=' or '?'. A trailing '>' is the response after a data prompt
+  uint32_t count;
+  uint32_t errors;   // ERROR (or +CME ERROR etc.) responses
+  uint32_t timeouts; // The expected response did not arrive in time
+  uint32_t totalMillis;
+  uint32_t maxMillis;
+  uint16_t histogram[SARA_R5_COMMAND_STATS_BUCKETS]; // Saturates at 65535
+};
+#endif
+
+// Heap tracking. Define SARA_R5_HEAP_TRACKING (as a build flag) to account for the buffers from sara_r5_calloc_char
+#ifdef SARA_R5_HEAP_TRACKING
+#ifndef SARA_R5_HEAP_TRACKING_TAGS
+#define SARA_R5_HEAP_TRACKING_TAGS 32 // The number of call sites tracked. Further call sites share the last entry ("*")
+#endif
+#define SARA_R5_HEAP_HEADER_LENGTH 8 // Each allocation is preceded by its length, tag and a guard. Keeps the buffer 8-byte aligned
+#define SARA_R5_HEAP_GUARD 0x5A35
+
+struct SARA_R5_heap_tag
+{
+  const char *tag; // The name of the function which made the allocation
+  uint32_t allocations;
+  uint32_t frees;
+  size_t currentBytes;
+  size_t peakBytes;
+};
+
+struct SARA_R5_heap_stats
+{
+  size_t currentBytes; // Requested bytes. Excludes the headers and any heap overhead
+  size_t peakBytes;
+  uint32_t allocations;
+  uint32_t frees;
+  uint32_t failures;  // calloc returned nullptr
+  uint32_t badFrees;  // The guard was missing: a double free, or memory which did not come from sara_r5_calloc_char. Not freed
+};
+#endif
+
+// AT trace ring
+#ifndef SARA_R5_AT_TRACE_DEFAULT_SIZE
+#define SARA_R5_AT_TRACE_DEFAULT_SIZE 1024 // Bytes
+#endif
+#define SARA_R5_AT_TRACE_MIN_SIZE 256
+#define SARA_R5_AT_TRACE_HEADER_LENGTH 5     // Direction and length, then millis
+#define SARA_R5_AT_TRACE_MAX_RECORD_DATA 127 // The most data bytes in one record
+#define SARA_R5_AT_TRACE_RX 0x80             // Set in the header of records received from the module
+#define SARA_R5_AT_TRACE_COALESCE 5          // Bytes in the same direction within this many millis share a record
+
+// Compact MD5 (RFC 1321). Used to compare certificates and keys with the MD5 reported by the security manager
+class SARA_R5_MD5
+{
+public:
+  SARA_R5_MD5(void) { begin(); }
+  void begin(void);
+  void update(const uint8_t *data, size_t length);
+  void finish(uint8_t digest[16]);
+  void finish(char *hex); // hex is SARA_R5_SEC_MANAGER_MD5_LENGTH. Lower case
+
+protected:
+  uint32_t _state[4];
+  uint32_t _length; // Bytes hashed so far
+  uint8_t _block[64];
+  void transform(void);
+};
+
+#ifdef SARA_R5_THREAD_SAFE
+#ifndef SARA_R5_RX_TASK_STACK_SIZE
+#define SARA_R5_RX_TASK_STACK_SIZE 4096 // Bytes (FreeRTOS only). The callbacks run on the RX task
+#endif
+#ifndef SARA_R5_RX_TASK_PRIORITY
+#define SARA_R5_RX_TASK_PRIORITY 1 // FreeRTOS only
+#endif
+
+// Recursive, so the library can call itself (and callbacks can call the library) while the mutex is held
+class SARA_R5_Mutex
+{
+public:
+  SARA_R5_Mutex(void);
+  ~SARA_R5_Mutex(void);
+  void lock(void);
+  void unlock(void);
+
+protected:
+#ifdef SARA_R5_THREAD_FREERTOS
+  SemaphoreHandle_t _handle;
+#else
+  std::recursive_mutex _mutex;
+#endif
+};
+
+// Holds the mutex until it goes out of scope
+class SARA_R5_Lock_Guard
+{
+public:
+  SARA_R5_Lock_Guard(SARA_R5_Mutex &mutex) : _mutex(mutex) { _mutex.lock(); }
+  ~SARA_R5_Lock_Guard(void) { _mutex.unlock(); }
+
+protected:
+  SARA_R5_Mutex &_mutex;
+};
+
+#define SARA_R5_LOCK() SARA_R5_Lock_Guard _saraLockGuard(_mutex)
+#else
+#define SARA_R5_LOCK()
+#endif
+
 class SARA_R5 : public Print
 {
 public:
@@ -654,6 +1322,32 @@ public:
   void enableDebugging(Print &debugPort = Serial); //Turn on debug printing. If user doesn't specify then Serial will be used.
   void enableAtDebugging(Print &debugPort = Serial); //Turn on AT debug printing. If user doesn't specify then Serial will be used.
 
+  // AT trace: records the AT traffic in a RAM ring instead of printing it, so timing is not disturbed. When the ring is full the oldest records are discarded.
+  // Each record is a header byte (SARA_R5_AT_TRACE_RX | data length), millis as a little-endian uint32_t, then the data
+  bool enableAtTrace(size_t size = SARA_R5_AT_TRACE_DEFAULT_SIZE); // Returns false if the ring could not be allocated
+  void disableAtTrace(void);
+  void clearAtTrace(void);
+  size_t dumpAtTrace(Print &out, bool clear = true); // Print the records as text. Returns the number of records printed
+  size_t readAtTrace(uint8_t *dest, size_t size);    // Remove whole binary records from the ring (e.g. from a low-priority task). Returns the number of bytes copied
+  uint32_t getAtTraceDropped(void) { return _atTraceDropped; } // The number of records discarded because the ring was full
+
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  // Counts, errors, timeouts and a log2 latency histogram for each command prefix, from sendCommandWithResponse and waitForResponse
+  uint8_t getStatsCount(void) { return _numCommandStats; }
+  const SARA_R5_command_stats *getStats(uint8_t index); // Returns nullptr if index is out of range
+  void clearStats(void);
+  void dumpStats(Print &out);
+#endif
+
+#ifdef SARA_R5_HEAP_TRACKING
+  // Current and peak bytes allocated through sara_r5_calloc_char, overall and for each calling function
+  const SARA_R5_heap_stats *getHeapStats(void) { return &_heapStats; }
+  uint8_t getHeapTagCount(void) { return _numHeapTags; }
+  const SARA_R5_heap_tag *getHeapTag(uint8_t index); // Returns nullptr if index is out of range
+  void resetHeapPeak(void); // Set the peaks to the current values. The counts are not changed
+  void dumpHeapStats(Print &out);
+#endif
+
   // Invert the polarity of the power pin - if required
   // Normally the SARA's power pin is pulled low and released to toggle the power
   // But the Asset Tracker needs this to be pulled high and released instead
@@ -677,6 +1371,41 @@ public:
   // Retained for backward-compatibility and just in case you do want to (temporarily) ignore any data in the backlog
   bool poll(void);
 
+#ifdef SARA_R5_THREAD_SAFE
+  // Every command holds the mutex from sending the command to reading the response, so each caller gets its own response.
+  // Hold it across several calls (e.g. socketOpen then socketConnect) with lock and unlock. Calls can be nested
+  void lock(void) { _mutex.lock(); }
+  void unlock(void) { _mutex.unlock(); }
+
+  // The RX task calls bufferedPoll every intervalMillis, so URCs are processed without the sketch polling.
+  // The callbacks are called from the RX task. Returns false if begin has not been called or the task could not be started
+  bool startRxTask(unsigned long intervalMillis = 10);
+  void stopRxTask(void); // Waits for the task to finish - unless called from a callback on the RX task itself
+  bool rxTaskRunning(void);
+#endif
+
+  // Backlog overflow detection. Characters which arrive while a command is in progress are saved in the backlog for bufferedPoll.
+  // If the backlog is full they are discarded - and any URCs (e.g. +UUSORD) in them are lost.
+  // The callback is called from bufferedPoll after an overflow, with the number of bytes dropped since the last call.
+  // recoverFromOverflow (which can be called from the callback) checks every socket for stranded data and reads it via the socket read callbacks
+  void setBacklogOverflowCallback(void (*overflowCallback)(size_t dropped, void *context), void *context = nullptr);
+  uint32_t getBacklogOverflowCount(void) { return _backlogOverflows; } // The number of overflows. Each overflow can drop many bytes
+  uint32_t getBacklogBytesDropped(void) { return _backlogBytesDropped; }
+  int getBacklogHighWater(void) { return _backlogHighWater; } // The most bytes held in the backlog (of _RXBuffSize)
+  void resetBacklogStats(void);
+  SARA_R5_error_t recoverFromOverflow(void);
+
+  // URC event queue. While it is enabled, the URCs listed in SARA_R5_event_type_t are queued instead of calling their callbacks from bufferedPoll.
+  // Internal state (e.g. the network state, the connection manager and managed sockets) is still updated immediately.
+  // Data for the library's own sockets (SNTP and the RTCM framing socket) is read immediately, not queued.
+  // Events are discarded (and counted) when the queue is full
+  void enableEventQueue(bool enable = true); // Enabling or disabling clears the queue
+  bool readEvent(SARA_R5_event &event); // Returns false if there are no events
+  uint8_t dispatchEvents(uint8_t maxEvents = SARA_R5_EVENT_QUEUE_SIZE); // Call the callbacks for the queued events. Returns the number dispatched
+  uint8_t getEventCount(void) { return _eventQueue.count(); }
+  uint8_t getEventQueueHighWater(void) { return _eventQueue.highWater(); }
+  uint32_t getEventsDropped(void) { return _eventQueue.dropped(); }
+
   // Callbacks (called during polling)
   void setSocketListenCallback(void (*socketListenCallback)(int, IPAddress, unsigned int, int, IPAddress, unsigned int)); // listen Socket, local IP Address, listen Port, socket, remote IP Address, port
   // This is the original read socket callback - called when a +UUSORD or +UUSORF URC is received
@@ -693,12 +1422,37 @@ public:
   void setHTTPCommandCallback(void (*httpCommandRequestCallback)(int profile, int command, int result));
   void setMQTTCommandCallback(void (*mqttCommandRequestCallback)(int command, int result));
   void setFTPCommandCallback(void (*ftpCommandRequestCallback)(int command, int result));
+  void setRTCMFrameCallback(void (*rtcmFrameCallback)(const uint8_t *frame, uint16_t length, void *context), void *context = nullptr);
+  // newSMSCallback is called for each new message: from bufferedPoll after reading a +CMTI message from storage,
+  // or directly for a +CMT message (index is -1). The strings are only valid during the callback.
+  // In PDU mode, from and dateTime are empty and message is the hex PDU. Decode it with SARA_R5_SMS_PDU::decode.
+  // If deleteAfterRead is true, stored messages are deleted once the callback returns.
+  // A message which cannot be read is tried SARA_R5_NEW_SMS_RETRIES times. After that it is left in storage for listSMS.
+  void setNewSMSCallback(void (*newSMSCallback)(int index, const char *from, const char *dateTime, const char *message, size_t length, void *context),
+                         void *context = nullptr, bool deleteAfterRead = false);
 
   SARA_R5_error_t setRegistrationCallback(void (*registrationCallback)(SARA_R5_registration_status_t status,
                                                                        unsigned int lac, unsigned int ci, int Act));
   SARA_R5_error_t setEpsRegistrationCallback(void (*epsRegistrationCallback)(SARA_R5_registration_status_t status,
                                                                             unsigned int tac, unsigned int ci, int Act));
 
+  // The same callbacks with a context pointer, which is passed back unchanged. Use it to reach a C++ object or one of several modules
+  // without globals, e.g. setMQTTCommandCallback([](int command, int result, void *context) { ((App *)context)->onMQTT(command, result); }, this);
+  // (a lambda without captures converts to a function pointer). Setting either version of a callback replaces the other
+  void setSocketListenCallback(void (*socketListenCallback)(int listenSocket, IPAddress localIP, unsigned int listenPort, int socket, IPAddress remoteIP, unsigned int port, void *context), void *context);
+  void setSocketReadCallback(void (*socketReadCallback)(int socket, String data, void *context), void *context);
+  void setSocketReadCallbackPlus(void (*socketReadCallbackPlus)(int socket, const char *data, int length, IPAddress remoteAddress, int remotePort, void *context), void *context);
+  void setSocketCloseCallback(void (*socketCloseCallback)(int socket, void *context), void *context);
+  void setGpsReadCallback(void (*gpsRequestCallback)(ClockData time, PositionData gps, SpeedData spd, unsigned long uncertainty, void *context), void *context);
+  void setSIMstateReportCallback(void (*simStateReportCallback)(SARA_R5_sim_states_t state, void *context), void *context);
+  void setPSDActionCallback(void (*psdActionRequestCallback)(int result, IPAddress ip, void *context), void *context);
+  void setPingCallback(void (*pingRequestCallback)(int retry, int p_size, String remote_hostname, IPAddress ip, int ttl, long rtt, void *context), void *context);
+  void setHTTPCommandCallback(void (*httpCommandRequestCallback)(int profile, int command, int result, void *context), void *context);
+  void setMQTTCommandCallback(void (*mqttCommandRequestCallback)(int command, int result, void *context), void *context);
+  void setFTPCommandCallback(void (*ftpCommandRequestCallback)(int command, int result, void *context), void *context);
+  SARA_R5_error_t setRegistrationCallback(void (*registrationCallback)(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act, void *context), void *context);
+  SARA_R5_error_t setEpsRegistrationCallback(void (*epsRegistrationCallback)(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act, void *context), void *context);
+
   // Direct write/print to cell serial port
   virtual size_t write(uint8_t c);
   virtual size_t write(const char *str);
@@ -735,11 +1489,41 @@ public:
   SARA_R5_error_t setUtimeConfiguration(int32_t offsetNanoseconds = 0, int32_t offsetSeconds = 0); // +UTIMECFG
   SARA_R5_error_t getUtimeConfiguration(int32_t *offsetNanoseconds, int32_t *offsetSeconds);
 
+  // Clock model - once synced, the time is calculated from millis() without any AT commands.
+  // The numeric clock() updates the model each time it is called. The millis() drift is estimated against an anchor sync
+  // (normally the first), so the estimate gets better as time passes. With +CCLK (about 1s uncertainty) it takes about 14 hours
+  // to reach SARA_R5_CLOCK_DRIFT_UNCERTAINTY. More accurate syncs (setClockEpoch from NTP or GNSS) are quicker.
+  SARA_R5_error_t syncClock(void); // Sync from +CCLK now (+CCLK has a resolution of one second)
+  void setClockEpoch(uint32_t epochSeconds, uint16_t milliseconds = 0, uint16_t accuracyMillis = 0); // Sync from another source: NTP, GNSS, +UTIME etc.
+  void setClockResyncInterval(unsigned long intervalMillis = SARA_R5_CLOCK_RESYNC_INTERVAL); // Resync from +CCLK in bufferedPoll. 0 = never
+  bool clockValid(void) { return _clockValid; }
+  uint32_t getEpoch(void); // UTC seconds since 1970-01-01. 0 if the model has not been synced
+  uint64_t getEpochMillis(void);
+  int32_t getClockDrift(void) { return _clockDriftPPM; } // Estimated millis() error in ppm (positive: millis() is slow)
+  uint16_t getClockAccuracy(void) { return _clockAccuracy; } // The uncertainty of the last sync (millis)
+  static uint32_t dateToEpoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
   // Network service AT commands
   int8_t rssi(void); // Receive signal strength
   SARA_R5_error_t getExtSignalQuality(signal_quality& signal_quality);
 
   SARA_R5_registration_status_t registration(bool eps = true);
+
+  // Cached network state
+  // setNetworkStateRefresh: refresh the signal quality (+CSQ and +CESQ) from bufferedPoll every refreshInterval millis (0 = never).
+  // If registrationURCs is true, the +CREG and +CEREG URCs are enabled and the registration state is read once.
+  // registration, rssi and getExtSignalQuality update the cached state too.
+  SARA_R5_error_t setNetworkStateRefresh(unsigned long refreshInterval = SARA_R5_NETWORK_STATE_REFRESH_INTERVAL, bool registrationURCs = true);
+  const SARA_R5_network_state *getNetworkState(void) { return &_networkState; } // No AT commands are sent
+  bool isRegistered(void); // From the cached state: true if registered (home or roaming) for CS or EPS
+
+  // Signal quality history
+  // setSignalHistoryInterval: sample +CESQ from bufferedPoll every intervalMillis (0 = stop sampling)
+  void setSignalHistoryInterval(unsigned long intervalMillis = SARA_R5_SIGNAL_HISTORY_INTERVAL);
+  void clearSignalHistory(void);
+  uint8_t getSignalHistoryCount(void) { return _signalRSRP.count(); }
+  bool getSignalSample(uint8_t age, SARA_R5_signal_sample &sample); // age 0 is the newest sample
+  bool getSignalStats(SARA_R5_signal_metric_t metric, SARA_R5_signal_stats &stats); // Over the whole history. No AT commands are sent
   bool setNetworkProfile(mobile_network_operator_t mno, bool autoReset = false, bool urcNotification = false);
   mobile_network_operator_t getNetworkProfile(void);
   typedef enum
@@ -777,7 +1561,15 @@ public:
   SARA_R5_error_t enterPPP(uint8_t cid = 1, char dialing_type_char = 0,
                            unsigned long dialNumber = 99, SARA_R5_l2p_t l2p = L2P_DEFAULT);
 
-  uint8_t getOperators(struct operator_stats *op, int maxOps = 3);
+  uint8_t getOperators(struct operator_stats *op, int maxOps = 3); // Blocks until the scan is complete (up to 3 minutes)
+  // Non-blocking operator scan (+COPS=?). The operators are parsed as they arrive and are passed to the callback
+  // from bufferedPoll, one at a time, with count = the number found so far and result = SARA_R5_ERROR_SUCCESS.
+  // When the scan is complete, the callback is called with oper = nullptr, the total count and the result.
+  // While the scan is in progress, other commands fail with SARA_R5_ERROR_BUSY
+  SARA_R5_error_t startOperatorScan(void (*operatorCallback)(const SARA_R5_operator *oper, uint8_t count, SARA_R5_error_t result, void *context),
+                                    void *context = nullptr);
+  SARA_R5_error_t cancelOperatorScan(void); // Abort the scan and wait for the module to respond. The callback is not called
+  bool operatorScanInProgress(void) { return _operatorScanActive; }
   SARA_R5_error_t registerOperator(struct operator_stats oper);
   SARA_R5_error_t automaticOperatorSelection();
   SARA_R5_error_t getOperator(String *oper);
@@ -786,8 +1578,24 @@ public:
   // SMS -- Short Messages Service
   SARA_R5_error_t setSMSMessageFormat(SARA_R5_message_format_t textMode = SARA_R5_MESSAGE_FORMAT_TEXT);
   SARA_R5_error_t sendSMS(String number, String message);
+  // Send data in PDU mode, split into concatenated parts if required. The message format is restored to text mode afterwards if needed.
+  // For GSM 7-bit and UCS2, data is UTF-8 text. Set statusReport to request a delivery status report.
+  SARA_R5_error_t sendSMSPDU(const char *destination, const uint8_t *data, size_t length,
+                             SARA_R5_sms_encoding_t encoding = SARA_R5_SMS_ENCODING_GSM7, bool statusReport = false);
   SARA_R5_error_t getPreferredMessageStorage(int *used, int *total, String memory = "ME");
   SARA_R5_error_t readSMSmessage(int location, String *unread, String *from, String *dateTime, String *message);
+  // Read the message at location as a hex PDU (PDU mode only). Decode it with SARA_R5_SMS_PDU::decode
+  // pduHexSize should be at least SARA_R5_SMS_MAX_PDU_HEX_LENGTH. status (optional) is the +CMGR <stat>
+  SARA_R5_error_t readSMSmessagePDU(int location, char *pduHex, size_t pduHexSize, int *status = nullptr);
+  // listSMS reads all of the messages which match filter using a single +CMGL. smsCallback is called once for each message.
+  // from, dateTime and message point into the library's buffers and are only valid during the callback.
+  // Do not send AT commands from inside the callback - the +CMGL response is still being read.
+  // In PDU mode, from and dateTime are empty and message contains the hex-encoded PDU.
+  SARA_R5_error_t listSMS(SARA_R5_sms_status_t filter,
+                          void (*smsCallback)(int index, SARA_R5_sms_status_t status, const char *from, const char *dateTime,
+                                              const char *message, size_t length, void *context),
+                          void *context = nullptr);
+  SARA_R5_error_t setNewSMSIndication(SARA_R5_new_sms_indication_t indication = SARA_R5_NEW_SMS_INDICATION_STORED); // +CNMI
   SARA_R5_error_t deleteSMSmessage(int location, int deleteFlag = 0); // Default to deleting the single message at the specified location
   SARA_R5_error_t deleteReadSMSmessages(void)           { return (deleteSMSmessage( 1, 1 )); }; // Delete all the read messages from preferred storage
   SARA_R5_error_t deleteReadSentSMSmessages(void)       { return (deleteSMSmessage( 1, 2 )); }; // Delete the read and sent messages from preferred storage
@@ -798,6 +1606,17 @@ public:
   SARA_R5_error_t setBaud(unsigned long baud);
   SARA_R5_error_t setFlowControl(SARA_R5_flow_control_t value = SARA_R5_ENABLE_FLOW_CONTROL);
 
+  // UART power saving. With SARA_R5_UPSV_TIMEOUT the library tracks the UART idle time. When the module could be asleep,
+  // sendCommand first wakes it: a wake character, wakeDelay, then AT until OK (retried if the first character is lost).
+  // Commands sent while the module is known to be awake have no extra latency.
+  // With SARA_R5_UPSV_DTR, dtrPin is driven low before each command and released from bufferedPoll when the UART is idle
+  SARA_R5_error_t setUartPowerSaving(SARA_R5_upsv_mode_t mode, uint16_t timeout = SARA_R5_UPSV_DEFAULT_TIMEOUT, int dtrPin = -1);
+  SARA_R5_error_t getUartPowerSaving(SARA_R5_upsv_mode_t *mode, uint16_t *timeout = nullptr); // Queries the module
+  void setUartWakeDelay(unsigned long wakeDelay) { _upsvWakeDelay = wakeDelay; } // millis. Lower is faster. Raise it if wakeModule needs retries
+  SARA_R5_error_t wakeModule(void); // Called by sendCommand. Can be called early to hide the wake-up time
+  uint32_t getUartWakeCount(void) { return _upsvWakes; }
+  uint32_t getUartWakeRetries(void) { return _upsvWakeRetries; } // Wake-up ATs which were not answered
+
   // GPIO
   // GPIO pin map
   typedef enum
@@ -849,11 +1668,23 @@ public:
   SARA_R5_error_t setGpioMode(SARA_R5_gpio_t gpio, SARA_R5_gpio_mode_t mode, int value = 0);
   SARA_R5_gpio_mode_t getGpioMode(SARA_R5_gpio_t gpio);
 
+  // Ring indicator wake. The module GPIO is set to RING_INDICATION and ringPin is attached to an interrupt on the falling edge (RI is active low).
+  // Call ringPoll instead of bufferedPoll: it only polls after RI has been asserted, or while data is waiting, so the processor can sleep between URCs.
+  // Only one SARA_R5 can use the ring indicator, because the interrupt routine has no argument.
+  // Asynchronous requests (e.g. CellLocate and SNTP) time out from bufferedPoll, so call it occasionally while they are pending
+  SARA_R5_error_t enableRingIndicator(SARA_R5_gpio_t gpio, int ringPin);
+  void disableRingIndicator(void); // Detaches the interrupt. The module GPIO is not changed
+  bool ringPending(void); // True if ringPoll has work to do. When false, it is safe to sleep until the next interrupt
+  bool ringPoll(void); // Calls bufferedPoll if ringPending. Returns true if a URC was handled
+  uint32_t getRingCount(void) { return _ringCount; } // The number of RI interrupts
+
   // IP Transport Layer
   int socketOpen(SARA_R5_socket_protocol_t protocol, unsigned int localPort = 0); // Open a socket. Returns the socket number.
   SARA_R5_error_t socketClose(int socket, unsigned long timeout = SARA_R5_2_MIN_TIMEOUT); // Close the socket
   SARA_R5_error_t socketConnect(int socket, const char *address, unsigned int port); // TCP - connect to a remote IP Address using the specified port. Not required for UDP sockets.
   SARA_R5_error_t socketConnect(int socket, IPAddress address, unsigned int port);
+  SARA_R5_error_t socketSetSecure(int socket, bool secure, int secprofile = 0); // Call before socketConnect to use SSL/TLS with the chosen security profile
+  unsigned long socketGetConnectTime(int socket); // Duration of the last successful socketConnect in millis, including the TLS handshake on secure sockets
   // Write data to the specified socket. Works with binary data - but you must specify the data length when using the const char * version
   // Works with both TCP and UDP sockets - but socketWriteUDP is preferred for UDP and doesn't require socketOpen to be called first
   SARA_R5_error_t socketWrite(int socket, const char *str, int len = -1);
@@ -896,6 +1727,20 @@ public:
   SARA_R5_error_t querySocketRemoteIPAddress(int socket, IPAddress *address, int *port);
   SARA_R5_error_t querySocketStatusTCP(int socket, SARA_R5_tcp_socket_status_t *status);
   SARA_R5_error_t querySocketOutUnackData(int socket, uint32_t *total);
+  // DNS resolution using +UDNSRN, with an optional cache. The cache is disabled (TTL 0) until setDNSCacheTTL is called.
+  // While it is enabled, socketConnect and socketWriteUDP resolve hostnames through the cache and send the IP address to the module.
+  // Set the TTL to 0 to disable it again (the module then resolves hostnames itself)
+  // Sockets made secure with socketSetSecure always connect by hostname, so the module can use it for SNI and hostname validation
+  SARA_R5_error_t resolve(const char *host, IPAddress *address, bool useCache = true);
+  void setDNSCacheTTL(unsigned long ttlMillis = SARA_R5_DNS_CACHE_TTL);
+  void clearDNSCache(void);
+  // RTCM3 framing
+  // Data received on the framing socket is reassembled into complete RTCM3 frames and CRC-24Q checked.
+  // Only complete, valid frames are passed to the RTCM frame callback - ready to be pushed to the GNSS.
+  // The socket read callbacks are not called for the framing socket. Call with socket = -1 to disable framing.
+  SARA_R5_error_t setRTCMFramingSocket(int socket);
+  SARA_R5_error_t setRTCMMessageFilter(const uint16_t *types, uint8_t numTypes); // Only forward these message types. numTypes = 0 forwards all types
+  SARA_R5_RTCM3_Framer *getRTCMFramer(void) { return _rtcmFramer; } // Access the framer statistics. nullptr if framing has not been enabled
   // Return the most recent socket error
   int socketGetLastError();
   // Return the remote IP Address from the most recent socket listen indication (socket connection)
@@ -905,6 +1750,15 @@ public:
   // Ping
   SARA_R5_error_t ping(String remote_host, int retry = 4, int p_size = 32, unsigned long timeout = 5000, int ttl = 32);
 
+  // SNTP
+  // Send a request to each server (up to SARA_R5_SNTP_MAX_SERVERS) using a new UDP socket. The responses are read via the +UUSORF URCs.
+  // When all servers have responded, or after SARA_R5_SNTP_TIMEOUT, the response with the lowest round trip delay is used.
+  // apply is a combination of SARA_R5_sntp_apply_t. The callback is called from bufferedPoll
+  SARA_R5_error_t sntpRequest(const char *const *servers, uint8_t numServers, uint8_t apply,
+                              void (*sntpCallback)(SARA_R5_error_t result, const SARA_R5_sntp_result *sntp, void *context),
+                              void *context = nullptr);
+  bool sntpRequestPending(void) { return _sntpSocket >= 0; }
+
   // HTTP
   SARA_R5_error_t resetHTTPprofile(int profile);                          // Reset the HTTP profile. Note: The configured HTTP profile parameters are not saved in the non volatile memory.
   SARA_R5_error_t setHTTPserverIPaddress(int profile, IPAddress address); // Default: empty string
@@ -950,6 +1804,23 @@ public:
   SARA_R5_error_t configSecurityProfileString(int secprofile, SARA_R5_sec_profile_parameter_t parameter, String value);
   SARA_R5_error_t configSecurityProfile(int secprofile, SARA_R5_sec_profile_parameter_t parameter, int value);
   SARA_R5_error_t setSecurityManager(SARA_R5_sec_manager_opcode_t opcode, SARA_R5_sec_manager_parameter_t parameter, String name, String data);
+  // Security profiles are kept in the module's NVM. applySecurityProfile hashes the settings and compares the hash with the fingerprint file
+  // written last time. If they match, nothing else is sent. Otherwise the profile is reset, every setting is written and the fingerprint is saved.
+  // written (optional) returns true if the settings had to be written
+  SARA_R5_error_t applySecurityProfile(int secprofile, const SARA_R5_sec_profile_setting *settings, uint8_t numSettings, bool *written = nullptr);
+  SARA_R5_error_t forgetSecurityProfile(int secprofile); // Delete the fingerprint so the next applySecurityProfile writes every setting
+  SARA_R5_error_t enableTLSSessionResumption(int secprofile, bool enable = true); // Returns SARA_R5_ERROR_ERROR if the firmware does not support it
+  // Stream certificates and keys into the security manager in SARA_R5_SEC_MANAGER_CHUNK_LENGTH chunks, so the object is never held in RAM.
+  // The data is hashed as it is sent and checked against the MD5 reported by the module. md5 (optional) returns it
+  SARA_R5_error_t importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, Stream &data, size_t length, char *md5 = nullptr);
+  // Import from memory. The import is skipped if skipIfIdentical is true and the module already holds an object with the same MD5
+  SARA_R5_error_t importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, const uint8_t *data, size_t length, bool skipIfIdentical = true);
+  // Import using a reader (e.g. for SD or external flash). readChunk copies up to size bytes, starting at offset, into buffer and returns the number copied.
+  // With skipIfIdentical the data is read twice: once to hash it and again to send it, only if the module's copy is different
+  SARA_R5_error_t importSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, size_t length,
+                                       size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context = nullptr,
+                                       bool skipIfIdentical = true);
+  SARA_R5_error_t getSecurityObjectMD5(SARA_R5_sec_manager_parameter_t parameter, const char *name, char *md5); // md5 is SARA_R5_SEC_MANAGER_MD5_LENGTH
 
   // Packet Switched Data
   // Configure the PDP using +UPSD. See SARA_R5_pdp_configuration_parameter_t for the list of parameters: protocol, APN, username, DNS, etc.
@@ -961,6 +1832,21 @@ public:
   SARA_R5_error_t activatePDPcontext(bool status, int cid = -1);                // Activates or deactivates the specified PDP context. Default to all (cid = -1)
   SARA_R5_error_t getNetworkAssignedIPAddress(int profile, IPAddress *address); // Get the dynamic IP address assigned during PDP context activation
 
+  // Connection manager - brings up and maintains the data path from bufferedPoll:
+  // waits for registration, activates the PSD profile and (re)opens the managed sockets.
+  // Retries use exponential backoff (SARA_R5_CONNECTION_BACKOFF_MIN to _MAX). Loss of registration or +UUPSDD triggers an immediate re-attach.
+  // If apn is not nullptr, it is set for cid and the PSD profile is mapped to cid before starting.
+  SARA_R5_error_t startConnectionManager(const char *apn = nullptr, int profile = 0, int cid = 1);
+  void stopConnectionManager(bool deactivate = true); // Closes the managed sockets and (optionally) deactivates the PSD profile
+  SARA_R5_connection_state_t getConnectionState(void) { return _connectionState; }
+  void setConnectionStateCallback(void (*connectionStateCallback)(SARA_R5_connection_state_t state, void *context), void *context = nullptr);
+  // Managed sockets are opened (and TCP sockets connected) when the data path is up, and reopened after a loss or a remote close.
+  // The callback is called with the new socket number, or -1 when the socket is lost. Returns the id (or -1 if there are no free slots)
+  int addManagedSocket(SARA_R5_socket_protocol_t protocol, const char *host, unsigned int port,
+                       void (*socketCallback)(int id, int socket, void *context), void *context = nullptr);
+  void removeManagedSocket(int id); // Closes the socket if it is open
+  int getManagedSocket(int id); // Returns the socket number, or -1 if it is not open
+
   // GPS
   typedef enum
   {
@@ -980,7 +1866,9 @@ public:
     GNSS_AIDING_MODE_ASSISTNOW_ONLINE = 4,
     GNSS_AIDING_MODE_ASSISTNOW_AUTONOMOUS = 8
   } gnss_aiding_mode_t;
-  bool isGPSon(void);
+  // isGPSon returns the GNSS power state cached from our own +UGPS commands and the +UUGIND URC.
+  // The module is only queried (+UGPS?) if the state is unknown (after begin, reset, power off, +CFUN etc.) or forceRefresh is true.
+  bool isGPSon(bool forceRefresh = false);
   SARA_R5_error_t gpsPower(bool enable = true,
                            gnss_system_t gnss_sys = GNSS_SYSTEM_GPS,
                            gnss_aiding_mode_t gnss_aiding = GNSS_AIDING_MODE_AUTOMATIC);
@@ -1000,6 +1888,20 @@ public:
 
   SARA_R5_error_t gpsRequest(unsigned int timeout, uint32_t accuracy, bool detailed = true, unsigned int sensor = 3);
 
+  // Asynchronous location requests (CellLocate / hybrid positioning)
+  // gpsRequestAsync queues a +ULOC request and returns immediately. The requests are sent one at a time by bufferedPoll,
+  // the next one as soon as the previous +UULOC arrives. locationCallback is called exactly once for each request:
+  // with SARA_R5_ERROR_SUCCESS and the location when the +UULOC arrives; or with SARA_R5_ERROR_TIMEOUT if
+  // timeout (seconds) + SARA_R5_LOCATION_REQUEST_MARGIN passes first; or with the error if +ULOC fails.
+  // context is passed back to the callback unchanged.
+  // Returns a request ID (>= 0) which can be passed to gpsRequestCancel, or -1 if the queue is full.
+  int gpsRequestAsync(unsigned int timeout, uint32_t accuracy,
+                      void (*locationCallback)(SARA_R5_error_t result, ClockData time, PositionData gps, SpeedData spd,
+                                               unsigned long uncertainty, void *context),
+                      void *context = nullptr, bool detailed = true, unsigned int sensor = 3);
+  SARA_R5_error_t gpsRequestCancel(int requestID); // The callback is not called for a cancelled request
+  uint8_t gpsRequestsPending(void); // Return the number of queued (or in-progress) location requests
+
   //CellLocate
   SARA_R5_error_t gpsAidingServerConf(const char *primaryServer, const char *secondaryServer, const char *authToken,
                                       unsigned int days = 14, unsigned int period = 4, unsigned int resolution = 1,
@@ -1035,6 +1937,32 @@ protected:
   Print *_debugAtPort;      //The stream to send debug messages to if enabled. Usually Serial.
   bool _printAtDebug = false; //Flag to print debugging variables
 
+  uint8_t *_atTrace = nullptr; // AT trace ring
+  size_t _atTraceSize = 0;
+  size_t _atTraceHead = 0;      // Where the next byte will be written
+  size_t _atTraceTail = 0;      // The start of the oldest record
+  size_t _atTraceUsed = 0;
+  size_t _atTraceLast = 0;      // The start of the newest record
+  bool _atTraceOpen = false;    // True if data can be added to the newest record
+  unsigned long _atTraceLastMillis = 0;
+  uint32_t _atTraceDropped = 0;
+  void traceAt(bool rx, const uint8_t *data, size_t length);
+  void traceDropOldest(void);
+
+#ifdef SARA_R5_ENABLE_COMMAND_STATS
+  SARA_R5_command_stats _commandStats[SARA_R5_COMMAND_STATS_SIZE];
+  uint8_t _numCommandStats = 0;
+  char _statsPrefix[SARA_R5_COMMAND_STATS_PREFIX_LENGTH] = {0}; // The prefix of the last command sent
+  void recordCommandStats(bool dataPhase, unsigned long elapsed, SARA_R5_error_t result);
+#endif
+
+#ifdef SARA_R5_HEAP_TRACKING
+  SARA_R5_heap_stats _heapStats = {0, 0, 0, 0, 0, 0};
+  SARA_R5_heap_tag _heapTags[SARA_R5_HEAP_TRACKING_TAGS];
+  uint8_t _numHeapTags = 0;
+  uint8_t heapTagIndex(const char *tag);
+#endif
+
   int _powerPin;
   int _resetPin;
   bool _invertPowerPin = false;
@@ -1047,6 +1975,20 @@ protected:
   bool _bufferedPollReentrant = false; // Prevent reentry of bufferedPoll - just in case it gets called from a callback
   bool _pollReentrant = false; // Prevent reentry of poll - just in case it gets called from a callback
 
+#ifdef SARA_R5_THREAD_SAFE
+  SARA_R5_Mutex _mutex; // Serializes the commands and the polling
+  unsigned long _rxTaskInterval = 10;
+#ifdef SARA_R5_THREAD_FREERTOS
+  TaskHandle_t volatile _rxTaskHandle = nullptr; // Cleared by the task when it exits
+  volatile bool _rxTaskStop = false;
+  static void rxTask(void *parameter);
+#else
+  std::thread _rxThread;
+  std::atomic<bool> _rxTaskStop{false};
+  void rxTask(void);
+#endif
+#endif
+
   #define _RXBuffSize 2056
   const unsigned long _rxWindowMillis = 2; // 1ms is not quite long enough for a single char at 9600 baud. millis roll over much less often than micros. See notes in .cpp re. ESP32!
   char *_saraRXBuffer; // Allocated in SARA_R5::begin
@@ -1054,6 +1996,39 @@ protected:
   char *_saraResponseBacklog;
   int _saraResponseBacklogLength = 0; // The backlog could contain binary data so we can't use strlen to find its length
 
+  uint32_t _backlogOverflows = 0;
+  uint32_t _backlogBytesDropped = 0;
+  int _backlogHighWater = 0;
+  size_t _backlogDroppedPending = 0; // Bytes dropped since the overflow callback was last called
+  void (*_backlogOverflowCallback)(size_t, void *) = nullptr;
+  void *_backlogOverflowCallbackContext = nullptr;
+  void backlogOverflow(size_t dropped);
+  void updateBacklogHighWater(void) { if (_saraResponseBacklogLength > _backlogHighWater) _backlogHighWater = _saraResponseBacklogLength; }
+  void processBacklogOverflow(void);
+
+  SARA_R5_upsv_mode_t _upsvMode = SARA_R5_UPSV_DISABLED;
+  unsigned long _upsvSleepMillis = 0; // The UART idle time after which the module could be asleep
+  unsigned long _upsvWakeDelay = SARA_R5_UPSV_WAKE_DELAY;
+  int _dtrPin = -1;
+  bool _dtrAsserted = false;
+  bool _upsvWaking = false; // Prevent recursion: wakeModule sends AT
+  unsigned long _uartActivityMillis = 0; // millis() when a character was last sent or received
+  uint32_t _upsvWakes = 0;
+  uint32_t _upsvWakeRetries = 0;
+  void processUartPowerSaving(void);
+
+  int _ringPin = -1;
+  volatile bool _ringFlag = false; // Set by the interrupt routine
+  volatile uint32_t _ringCount = 0;
+  unsigned long _ringMillis = 0; // When ringPoll last saw the flag
+  static SARA_R5 *_ringInstance;
+  static void ringISR(void);
+
+  bool _eventQueueEnabled = false;
+  SARA_R5_Event_Queue _eventQueue;
+  void queueEvent(SARA_R5_event &event);
+  bool isInternalSocket(int socket); // The SNTP and RTCM framing sockets are always read immediately - never queued
+
   void (*_socketListenCallback)(int, IPAddress, unsigned int, int, IPAddress, unsigned int);
   void (*_socketReadCallback)(int, String);
   void (*_socketReadCallbackPlus)(int, const char *, int, IPAddress, int); // socket, data, length, remoteAddress, remotePort
@@ -1067,9 +2042,98 @@ protected:
   void (*_ftpCommandRequestCallback)(int, int);
   void (*_registrationCallback)(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act);
   void (*_epsRegistrationCallback)(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act);
+  // The context versions of the callbacks. Only one version of each is set
+  void (*_socketListenContextCallback)(int, IPAddress, unsigned int, int, IPAddress, unsigned int, void *) = nullptr;
+  void *_socketListenCallbackContext = nullptr;
+  void (*_socketReadContextCallback)(int, String, void *) = nullptr;
+  void *_socketReadCallbackContext = nullptr;
+  void (*_socketReadPlusContextCallback)(int, const char *, int, IPAddress, int, void *) = nullptr;
+  void *_socketReadPlusCallbackContext = nullptr;
+  void (*_socketCloseContextCallback)(int, void *) = nullptr;
+  void *_socketCloseCallbackContext = nullptr;
+  void (*_gpsRequestContextCallback)(ClockData, PositionData, SpeedData, unsigned long, void *) = nullptr;
+  void *_gpsRequestCallbackContext = nullptr;
+  void (*_simStateReportContextCallback)(SARA_R5_sim_states_t, void *) = nullptr;
+  void *_simStateReportCallbackContext = nullptr;
+  void (*_psdActionRequestContextCallback)(int, IPAddress, void *) = nullptr;
+  void *_psdActionRequestCallbackContext = nullptr;
+  void (*_pingRequestContextCallback)(int, int, String, IPAddress, int, long, void *) = nullptr;
+  void *_pingRequestCallbackContext = nullptr;
+  void (*_httpCommandRequestContextCallback)(int, int, int, void *) = nullptr;
+  void *_httpCommandRequestCallbackContext = nullptr;
+  void (*_mqttCommandRequestContextCallback)(int, int, void *) = nullptr;
+  void *_mqttCommandRequestCallbackContext = nullptr;
+  void (*_ftpCommandRequestContextCallback)(int, int, void *) = nullptr;
+  void *_ftpCommandRequestCallbackContext = nullptr;
+  void (*_registrationContextCallback)(SARA_R5_registration_status_t, unsigned int, unsigned int, int, void *) = nullptr;
+  void *_registrationCallbackContext = nullptr;
+  void (*_epsRegistrationContextCallback)(SARA_R5_registration_status_t, unsigned int, unsigned int, int, void *) = nullptr;
+  void *_epsRegistrationCallbackContext = nullptr;
+
+  SARA_R5_error_t enableRegistrationURC(bool eps); // +CREG=2 or +CEREG=2
+  // Call whichever version of the callback has been set
+  bool socketReadCallbackSet(void);
+  void callSocketReadCallbacks(int socket, const char *data, int length, IPAddress remoteAddress, int remotePort);
+  void callSocketListenCallback(int listenSocket, IPAddress localIP, unsigned int listenPort, int socket, IPAddress remoteIP, unsigned int port);
+  void callSocketCloseCallback(int socket);
+  void callGpsRequestCallback(ClockData time, PositionData gps, SpeedData spd, unsigned long uncertainty);
+  void callSIMstateReportCallback(SARA_R5_sim_states_t state);
+  void callPSDActionCallback(int result, IPAddress ip);
+  void callPingCallback(int retry, int p_size, String remote_hostname, IPAddress ip, int ttl, long rtt);
+  void callHTTPCommandCallback(int profile, int command, int result);
+  void callMQTTCommandCallback(int command, int result);
+  void callFTPCommandCallback(int command, int result);
+  void callRegistrationCallback(SARA_R5_registration_status_t status, unsigned int lac, unsigned int ci, int Act);
+  void callEpsRegistrationCallback(SARA_R5_registration_status_t status, unsigned int tac, unsigned int ci, int Act);
 
 
   int _lastSocketProtocol[SARA_R5_NUM_SOCKETS]; // Record the protocol for each socket to avoid having to call querySocketType in parseSocketReadIndication
+  unsigned long _socketConnectTime[SARA_R5_NUM_SOCKETS]; // Duration of the last successful socketConnect
+  bool _socketSecure[SARA_R5_NUM_SOCKETS]; // Set by socketSetSecure. socketConnect passes the hostname to the module for SNI and certificate checks
+
+  typedef enum
+  {
+    SARA_R5_GNSS_POWER_UNKNOWN = -1,
+    SARA_R5_GNSS_POWER_OFF = 0,
+    SARA_R5_GNSS_POWER_ON
+  } SARA_R5_gnss_power_state_t;
+  SARA_R5_gnss_power_state_t _gnssPowerState = SARA_R5_GNSS_POWER_UNKNOWN; // Updated by our own +UGPS commands and +UUGIND
+
+  struct SARA_R5_location_request
+  {
+    int id;
+    bool active;    // true once the +ULOC has been sent
+    bool cancelled; // Cancelled while active. We still need to wait for the +UULOC (or the deadline) before sending the next request
+    unsigned int timeout;
+    uint32_t accuracy;
+    bool detailed;
+    unsigned int sensor;
+    unsigned long startTime; // millis when the +ULOC was sent
+    void (*callback)(SARA_R5_error_t, ClockData, PositionData, SpeedData, unsigned long, void *);
+    void *context;
+  };
+  SARA_R5_location_request _locationRequests[SARA_R5_NUM_LOCATION_REQUESTS]; // FIFO. The active request is always [0]
+  uint8_t _numLocationRequests = 0;
+  int _nextLocationRequestID = 0;
+  uint8_t _legacyLocationRequests = 0; // +ULOCs sent by gpsRequest whose +UULOC has not arrived yet
+  unsigned long _legacyLocationDeadline = 0; // millis. Stop waiting for them after this
+
+  SARA_R5_RTCM3_Framer *_rtcmFramer; // Allocated by setRTCMFramingSocket
+  int _rtcmFramingSocket = -1;
+  void (*_rtcmFrameCallback)(const uint8_t *, uint16_t, void *);
+  void *_rtcmFrameCallbackContext;
+
+  void (*_newSMSCallback)(int, const char *, const char *, const char *, size_t, void *);
+  void *_newSMSCallbackContext;
+  bool _newSMSDeleteAfterRead = false;
+  int _newSMSIndexes[SARA_R5_NEW_SMS_QUEUE_SIZE]; // Ring buffer of +CMTI storage indexes
+  uint8_t _newSMSHead = 0;
+  uint8_t _numNewSMS = 0;
+  uint8_t _newSMSRetries = 0; // The number of failed reads of _newSMSIndexes[_newSMSHead]
+  unsigned long _newSMSRetryMillis = 0;
+  bool _cmtPending = false; // true when a +CMT header has been received. The next line is the message
+  char _cmtFrom[25];
+  char _cmtDateTime[25];
 
   typedef enum
   {
@@ -1098,6 +2162,16 @@ protected:
   // Send a command -- prepend AT if at is true
   void sendCommand(const char *command, bool at);
 
+  // Read one line of a response into dest (without the CR LF). Excess chars are discarded. Returns SARA_R5_ERROR_TIMEOUT
+  // if no char arrives for timeout millis
+  SARA_R5_error_t readResponseLine(char *dest, size_t destSize, size_t *length, unsigned long timeout);
+
+  SARA_R5_message_format_t _smsMessageFormat = SARA_R5_MESSAGE_FORMAT_TEXT; // Set by setSMSMessageFormat
+  uint8_t _smsConcatReference = 0; // Incremented for each message sent by sendSMSPDU
+
+  // Split a comma-separated list of (optionally quoted) fields in place. Returns the number of fields
+  int splitFields(char *str, char **fields, int maxFields);
+
   const int _saraR5maxSocketRead = 1024; // The limit on bytes that can be read in a single read
 
   SARA_R5_error_t parseSocketReadIndication(int socket, int length);
@@ -1105,6 +2179,16 @@ protected:
   SARA_R5_error_t parseSocketListenIndication(int listeningSocket, IPAddress localIP, unsigned int listeningPort, int socket, IPAddress remoteIP, unsigned int port);
   SARA_R5_error_t parseSocketCloseIndication(String *closeIndication);
 
+  SARA_R5_error_t streamSecurityObject(SARA_R5_sec_manager_parameter_t parameter, const char *name, size_t length,
+                                       size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context,
+                                       char *md5);
+  SARA_R5_error_t hashSecurityObject(size_t length, size_t (*readChunk)(uint8_t *buffer, size_t offset, size_t size, void *context), void *context,
+                                     char *md5);
+  void securityProfileFingerprint(const SARA_R5_sec_profile_setting *settings, uint8_t numSettings, char *md5);
+  static size_t readStreamChunk(uint8_t *buffer, size_t offset, size_t size, void *context);
+  static size_t readMemoryChunk(uint8_t *buffer, size_t offset, size_t size, void *context);
+  void appendToBacklog(const char *line, size_t length); // Save a line which is not part of a response (e.g. a URC) for bufferedPoll
+
   // UART Functions
   size_t hwPrint(const char *s);
   size_t hwWriteData(const char *buff, int len);
@@ -1118,11 +2202,149 @@ protected:
 
   SARA_R5_error_t autobaud(unsigned long desiredBaud);
 
+#ifdef SARA_R5_HEAP_TRACKING
+  // __builtin_FUNCTION (GCC and clang) tags each allocation with the name of the calling function
+  char *sara_r5_calloc_char(size_t num, const char *tag = __builtin_FUNCTION());
+#else
   char *sara_r5_calloc_char(size_t num);
+#endif
+  void sara_r5_free(void *ptr); // Use this to free memory from sara_r5_calloc_char
 
   bool processURCEvent(const char *event);
   void pruneBacklog(void);
 
+  // Asynchronous tasks - called by bufferedPoll after the URCs have been processed
+  void processAsyncTasks(void);
+  void processLocationRequests(void);
+  void processNewSMS(void);
+  void dequeueNewSMS(void);
+  void processNetworkState(void);
+  void processSignalHistory(void);
+
+  // SNTP
+  struct SARA_R5_sntp_server
+  {
+    IPAddress address;
+    unsigned long sentMillis;
+    uint32_t tag;     // Sent in the transmit timestamp. The server returns it in the originate timestamp
+    bool responded;
+    SARA_R5_sntp_result result;
+  };
+  SARA_R5_sntp_server _sntpServers[SARA_R5_SNTP_MAX_SERVERS];
+  uint8_t _sntpNumServers = 0;
+  int _sntpSocket = -1; // -1 if no request is in progress
+  uint8_t _sntpApply = 0;
+  unsigned long _sntpStartMillis = 0;
+  void (*_sntpCallback)(SARA_R5_error_t, const SARA_R5_sntp_result *, void *) = nullptr;
+  void *_sntpCallbackContext = nullptr;
+  void processSNTPResponse(const uint8_t *packet, int length, IPAddress remoteAddress);
+  void processSNTP(void); // Check for completion or timeout
+  void completeSNTP(void);
+
+  // Clock model
+  bool _clockValid = false;
+  uint64_t _clockBaseEpochMillis = 0; // The epoch at the last sync...
+  unsigned long _clockBaseMillis = 0; // ...and millis() at the last sync
+  int32_t _clockDriftPPM = 0;
+  bool _clockDriftValid = false;
+  uint64_t _clockAnchorEpochMillis = 0; // The sync the drift is measured against. Later syncs do not move it...
+  unsigned long _clockAnchorMillis = 0;
+  uint16_t _clockAnchorAccuracy = 0;
+  bool _clockAnchorValid = false;
+  void setClockAnchor(uint64_t epochMillis, uint16_t accuracyMillis, unsigned long atMillis);
+  uint16_t _clockAccuracy = 0;
+  unsigned long _clockResyncInterval = 0;
+  bool _clockResyncAttempted = false;
+  unsigned long _clockResyncAttemptMillis = 0;
+  void syncClockModel(uint64_t epochMillis, uint16_t accuracyMillis, unsigned long atMillis);
+  void processClockModel(void);
+
+  // DNS cache
+  struct SARA_R5_dns_cache_entry
+  {
+    bool inUse;
+    char host[SARA_R5_DNS_HOST_LENGTH];
+    IPAddress address;
+    unsigned long resolvedMillis;
+    unsigned long lastUsedMillis;
+  };
+  SARA_R5_dns_cache_entry _dnsCache[SARA_R5_DNS_CACHE_SIZE];
+  unsigned long _dnsCacheTTL = 0; // Disabled until setDNSCacheTTL is called
+  SARA_R5_dns_cache_entry *findDNSCacheEntry(const char *host); // Returns nullptr if host is not cached or has expired
+  void removeDNSCacheEntry(const char *host);
+  // If host is a hostname and the cache is enabled, resolve it and copy the IP address into ipString (16 chars)
+  bool resolveForSocket(const char *host, char *ipString);
+
+  // Connection manager
+  struct SARA_R5_managed_socket
+  {
+    bool inUse;
+    SARA_R5_socket_protocol_t protocol;
+    char host[SARA_R5_MANAGED_SOCKET_HOST_LENGTH];
+    unsigned int port;
+    int socket; // -1 if not open
+    unsigned long retryMillis; // millis() of the last failed open
+    unsigned long backoff;
+    void (*callback)(int, int, void *);
+    void *context;
+  };
+  SARA_R5_managed_socket _managedSockets[SARA_R5_NUM_MANAGED_SOCKETS];
+  SARA_R5_connection_state_t _connectionState = SARA_R5_CONNECTION_STOPPED;
+  int _connectionProfile = 0;
+  unsigned long _connectionStateMillis = 0; // millis() when the state was entered or last polled
+  unsigned long _connectionBackoff = SARA_R5_CONNECTION_BACKOFF_MIN;
+  int _connectionActivationResult = -1; // From +UUPSDA. -1 if not received yet
+  bool _connectionLost = false;         // Set by +UUPSDD
+  void (*_connectionStateCallback)(SARA_R5_connection_state_t, void *) = nullptr;
+  void *_connectionStateCallbackContext = nullptr;
+  void processConnectionManager(void);
+  void setConnectionState(SARA_R5_connection_state_t state);
+  void connectionFailed(void); // Back off before the next attempt
+  void connectionLost(void);   // Mark the managed sockets as closed and re-attach
+  void openManagedSockets(void);
+  void closeManagedSocket(int id, bool close);
+  void managedSocketClosed(int socket); // +UUSOCL
+
+  // Operator scan
+  bool _operatorScanActive = false;
+  bool _operatorScanCancelled = false;
+  bool _operatorScanInList = false;   // Reading the +COPS: line
+  bool _operatorScanInTuple = false;  // Between ( and )
+  bool _operatorScanInQuotes = false;
+  unsigned long _operatorScanStart = 0;
+  unsigned long _operatorScanTimeout = 0;
+  uint8_t _operatorScanCount = 0;
+  char _operatorScanLine[SARA_R5_OPERATOR_SCAN_LINE_LENGTH];
+  size_t _operatorScanLineLength = 0;
+  void (*_operatorScanCallback)(const SARA_R5_operator *, uint8_t, SARA_R5_error_t, void *) = nullptr;
+  void *_operatorScanCallbackContext = nullptr;
+  void processOperatorScan(void); // Read and parse the scan response. Returns when no more data is available
+  void processOperatorScanLine(void);
+  void processOperatorTuple(void);
+  void completeOperatorScan(SARA_R5_error_t result);
+  static void getOperatorsCallback(const SARA_R5_operator *oper, uint8_t count, SARA_R5_error_t result, void *context);
+
+  SARA_R5_Signal_Window _signalRSRP;
+  SARA_R5_Signal_Window _signalRSRQ;
+  unsigned long _signalMillis[SARA_R5_SIGNAL_HISTORY_SIZE];
+  uint8_t _signalMillisNext = 0;
+  unsigned long _signalHistoryInterval = 0;
+  unsigned long _signalHistoryLastSample = 0;
+  bool _signalHistorySampled = false;
+
+  SARA_R5_network_state _networkState;
+  unsigned long _networkStateRefreshInterval = 0;
+  unsigned long _networkStateLastRefresh = 0;
+  bool _networkStateRefreshed = false;
+  void resetNetworkState(void);
+  SARA_R5_error_t enableRegistrationURCs(void); // +CREG=2 and +CEREG=2
+  // Parse the body of a +CREG / +CEREG URC or query response and update the network state.
+  // Returns the number of fields found after the (optional) <n>: <stat>,<lac/tac>,<ci>,<AcT>
+  int parseRegistrationStatus(const char *ptr, bool eps, bool *queryResponse, SARA_R5_registration_status_t *status,
+                              unsigned int *area, unsigned long *ci, int *act);
+  void completeLocationRequest(SARA_R5_error_t result, ClockData *clck, PositionData *gps, SpeedData *spd, unsigned long uncertainty);
+  SARA_R5_error_t sendLocationRequest(unsigned int timeout, uint32_t accuracy, bool detailed, unsigned int sensor); // +ULOC
+
   // GPS Helper functions
   char *readDataUntil(char *destination, unsigned int destSize, char *source, char delimiter);
   bool parseGPRMCString(char *rmcString, PositionData *pos, ClockData *clk, SpeedData *spd);